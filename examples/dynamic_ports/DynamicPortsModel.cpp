@@ -167,6 +167,9 @@ nodeData(NodeId nodeId, NodeRole role) const
       result = QVariant::fromValue(_nodeWidgets[nodeId]);
       break;
     }
+
+    case NodeRole::WidgetSize:
+      break;
   }
 
   return result;
@@ -223,6 +226,9 @@ setNodeData(NodeId   nodeId,
 
     case NodeRole::Widget:
       break;
+
+    case NodeRole::WidgetSize:
+      break;
   }
 
   return result;
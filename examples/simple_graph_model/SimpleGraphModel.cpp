@@ -150,6 +150,9 @@ nodeData(NodeId nodeId, NodeRole role) const
     case NodeRole::Widget:
       result = QVariant();
       break;
+
+    case NodeRole::WidgetSize:
+      break;
   }
 
   return result;
@@ -206,6 +209,9 @@ setNodeData(NodeId   nodeId,
 
     case NodeRole::Widget:
       break;
+
+    case NodeRole::WidgetSize:
+      break;
   }
 
   return result;
@@ -4,6 +4,7 @@
 
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 #include <QtCore/QObject>
 #include <QtCore/QVariant>
@@ -77,6 +78,21 @@ public:
   NodeId
   addNode(QString const nodeType = QString()) = 0;
 
+  /// @brief Returns an id which no node uses yet.
+  /**
+   * No node uses the returned id or any larger id. The ids are not reserved,
+   * calling the function again before a node is inserted returns the same
+   * id. Pasted nodes take consecutive ids starting from here before they are
+   * restored with `loadNodes`.
+   *
+   * The default implementation returns the next id after the largest
+   * existing one, which visits all nodes. Models with their own id counter
+   * should reimplement it.
+   */
+  virtual
+  NodeId
+  newNodeId() const;
+
   /// Model decides if a conection with a given connection Id possible.
   /**
    * The default implementation compares corresponding data types.
@@ -230,6 +246,18 @@ public:
   void
   loadNode(QJsonObject const &) {}
 
+  /// Restores a group of nodes and then the connections between them.
+  /**
+   * The default implementation calls `loadNode` and `addConnection` for each
+   * item. Models may reimplement it to do work once per group instead of
+   * once per item. The creation signals are emitted per item in any case,
+   * the scene builds its graphics objects from them.
+   */
+  virtual
+  void
+  loadNodes(std::vector<QJsonObject> const &  nodesJson,
+            std::vector<ConnectionId> const & connectionIds);
+
   virtual
   QJsonObject
   saveConnection(ConnectionId const & connId) const = 0;
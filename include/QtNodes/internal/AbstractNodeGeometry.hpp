@@ -7,6 +7,8 @@
 #include <QSize>
 #include <QTransform>
 
+class QWidget;
+
 namespace QtNodes
 {
 
@@ -88,6 +90,20 @@ public:
   QRect
   resizeHandleRect(NodeId const nodeId) const = 0;
 
+protected:
+  /// Size of the embedded widget, an invalid size if there is none.
+  /**
+   * Asks for `NodeRole::WidgetSize`, so widgets which are embedded lazily are
+   * not created for the layout. Models not providing the role, and models
+   * without a size hint, are asked for the widget itself.
+   */
+  QSize
+  widgetSize(NodeId const nodeId) const;
+
+  /// The embedded widget, `nullptr` as long as only its size hint is known.
+  QWidget *
+  createdWidget(NodeId const nodeId) const;
+
 protected:
   AbstractGraphModel & _graphModel;
 };
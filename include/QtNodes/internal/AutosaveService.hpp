@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include "Export.hpp"
+#include "GraphSnapshot.hpp"
+
+class QTimer;
+
+namespace QtNodes
+{
+
+class DataFlowGraphModel;
+
+/// Periodically writes a DataFlowGraphModel to a file in the background.
+/**
+ * On each tick the service takes a `DataFlowGraphModel::snapshot()` on the
+ * GUI thread, which costs only the nodes changed since the previous tick.
+ * The JSON conversion and the file writing run on a worker thread. The file
+ * is written through QSaveFile, so it is replaced atomically and a crash in
+ * the middle of a save leaves the previous version intact.
+ *
+ * Nothing is written while the graph stays unchanged since the last
+ * successful save. A tick arriving while the previous save is still running
+ * is skipped.
+ */
+class NODE_EDITOR_PUBLIC AutosaveService : public QObject
+{
+  Q_OBJECT
+
+public:
+  AutosaveService(DataFlowGraphModel & graphModel,
+                  QObject *            parent = nullptr);
+
+  /// Waits for the running save to finish.
+  ~AutosaveService();
+
+public:
+  void
+  setFilePath(QString const & filePath);
+
+  QString
+  filePath() const { return _filePath; }
+
+  /// Time between two saves, 60 s by default.
+  void
+  setInterval(int const msec);
+
+  int
+  interval() const;
+
+  bool
+  isActive() const;
+
+  /// `true` while a worker thread is writing the file.
+  bool
+  isSaving() const { return _saving; }
+
+public Q_SLOTS:
+  void
+  start();
+
+  void
+  stop();
+
+  /// Starts a background save right away if the graph has changed.
+  void
+  saveNow();
+
+Q_SIGNALS:
+  void
+  saved(QString const & filePath);
+
+  void
+  saveFailed(QString const & filePath, QString const & errorString);
+
+private:
+  void
+  onSaveFinished(GraphSnapshot const & snapshot,
+                 QString const &       filePath,
+                 QString const &       errorString);
+
+private:
+  DataFlowGraphModel & _graphModel;
+
+  QTimer * _timer;
+
+  QString _filePath;
+
+  bool _saving;
+
+  /// The graph as it was written by the last successful save.
+  GraphSnapshot _savedSnapshot;
+
+  QString _savedFilePath;
+
+  /// Own pool, so the destructor waits only for our task.
+  QThreadPool _threadPool;
+};
+
+}
@@ -1,23 +1,30 @@
 #pragma once
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QUuid>
 #include <QtWidgets/QGraphicsScene>
 #include <QtWidgets/QMenu>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "AbstractGraphModel.hpp"
 #include "AbstractNodeGeometry.hpp"
 #include "ConnectionIdHash.hpp"
+#include "ConnectionIdMap.hpp"
 #include "Definitions.hpp"
 #include "Export.hpp"
 
 #include "QUuidStdHash.hpp"
 
 
+class QTimer;
 class QUndoStack;
 
 namespace QtNodes
@@ -26,8 +33,12 @@ namespace QtNodes
 class AbstractGraphModel;
 class AbstractNodePainter;
 class ConnectionGraphicsObject;
+class ConnectionLayer;
 class NodeGraphicsObject;
+class NodeSpatialIndex;
 class NodeStyle;
+class UndoCommand;
+class UndoMemoryBudget;
 
 /// An instance of QGraphicsScene, holds connections and nodes.
 class NODE_EDITOR_PUBLIC BasicGraphicsScene : public QGraphicsScene
@@ -60,6 +71,63 @@ public:
 
   QUndoStack& undoStack();
 
+  /// Number of most recent undo steps kept uncompressed.
+  /**
+   * Snapshots of older delete commands are compressed with qCompress. They
+   * are rarely undone, and decompression costs much less than the memory.
+   * The default depth is 8, a negative value disables the compression.
+   * Setting the depth compresses every command already behind it.
+   */
+  void
+  setUndoCompressionDepth(int const depth);
+
+  int
+  undoCompressionDepth() const { return _undoCompressionDepth; }
+
+  /// Approximate number of bytes held by the commands of the undo stack.
+  /**
+   * The commands report their usage on creation, spilling and restoring,
+   * the call costs nothing. Commands pushed by the application which are
+   * not derived from UndoCommand are not counted.
+   */
+  std::size_t
+  undoStackMemoryUsage() const;
+
+  struct UndoMemoryStatistics
+  {
+    /// All the commands on the stack.
+    int commandCount = 0;
+
+    /// Commands whose content lives in the spill file.
+    int spilledCommandCount = 0;
+
+    /// Bytes held in memory, see `undoStackMemoryUsage()`.
+    std::size_t memoryUsage = 0;
+
+    /// Bytes of the spilled commands.
+    qint64 spilledBytes = 0;
+
+    /// Size of the spill file, including the records of dropped commands.
+    qint64 spillFileSize = 0;
+  };
+
+  /// Limits the memory held by the undo history.
+  /**
+   * When the history grows past `bytes`, the oldest commands are written to
+   * a temporary file and read back when they are undone or redone. Only the
+   * commands holding graph snapshots (deletions and pastes) are spilled, the
+   * small ones stay in memory, as do the commands right around the undo
+   * index. 0, the default, means no limit.
+   */
+  void
+  setUndoMemoryBudget(std::size_t const bytes);
+
+  std::size_t
+  undoMemoryBudget() const;
+
+  UndoMemoryStatistics
+  undoMemoryStatistics() const;
+
 public:
   /// Creates a "draft" instance of ConnectionGraphicsObject.
   /**
@@ -85,6 +153,18 @@ public:
   void
   clearScene();
 
+  /// Defers the graphics objects of new nodes and connections.
+  /**
+   * Between the calls the scene only records the ids announced by the
+   * model. `endBatchInsertion` creates all the objects in one pass and
+   * repaints every affected node once. The calls could be nested.
+   */
+  void
+  beginBatchInsertion();
+
+  void
+  endBatchInsertion();
+
 public:
   /// @returns NodeGraphicsObject associated with the given nodeId.
   /**
@@ -102,8 +182,207 @@ public:
 
   Qt::Orientation orientation() const { return _orientation; }
 
+  /// Brings the node above all the others, e.g. when it is hovered.
+  /**
+   * Only one node is raised at a time, the previously raised one goes back
+   * to the common level. No collision query is involved.
+   */
+  void
+  raiseNode(NodeId const nodeId);
+
   void setOrientation(Qt::Orientation const orientation);
 
+public:
+  /// Enables painting of all idle connections by a single scene-level item.
+  /**
+   * Connections which are neither selected nor hovered are merged into
+   * batches of one color and painted in a few passes. Individual connection objects
+   * are still used for the interaction. The mode is off by default.
+   */
+  void
+  setBatchedConnectionPainting(bool const enabled);
+
+  bool
+  batchedConnectionPainting() const;
+
+  /// @returns the layer painting idle connections or `nullptr`.
+  ConnectionLayer *
+  connectionLayer() const;
+
+public:
+  /// Skips repositioning connections which stay out of all views.
+  /**
+   * When the nodes of such a connection move, the connection is only marked
+   * stale and keeps its old geometry. It is repositioned once a view shows
+   * its old or new place, see `updateStaleConnections()`. Long connections
+   * across the canvas then cost nothing while offscreen nodes are edited.
+   * The mode is off by default.
+   */
+  void
+  setConnectionCulling(bool const enabled);
+
+  bool
+  connectionCulling() const { return _connectionCulling; }
+
+  /// Union of the scene areas shown by the visible views.
+  /**
+   * The rect is cached until `invalidateVisibleSceneRect()`. It is empty
+   * while no view is visible, connections are not culled then.
+   */
+  QRectF
+  visibleSceneRect() const;
+
+  /// Called by GraphicsView when it scrolls, zooms, is shown or hidden.
+  void
+  invalidateVisibleSceneRect() { _visibleSceneRectValid = false; }
+
+  /// Called by ConnectionGraphicsObject when it skips repositioning.
+  void
+  markConnectionStale(ConnectionId const connectionId);
+
+  /// Repositions the stale connections which could appear in `sceneRect`.
+  /**
+   * Called by GraphicsView when its visible part of the scene changes.
+   */
+  void
+  updateStaleConnections(QRectF const & sceneRect);
+
+public:
+  /// Caps the number of idle node and connection objects kept for reuse.
+  /**
+   * Objects of deleted nodes and connections wait in a pool and are bound to
+   * the next created ones, which saves their allocation and setup in undo
+   * and redo or cut and paste. The limit applies to each kind of object.
+   * The default is 256, 0 disables the pools.
+   */
+  void
+  setGraphicsObjectPoolLimit(std::size_t const limit);
+
+  std::size_t
+  graphicsObjectPoolLimit() const { return _graphicsObjectPoolLimit; }
+
+public:
+  /// Embeds node widgets only while the nodes are visible in some view.
+  /**
+   * Offscreen nodes show a snapshot of their widget or an outline of it. The
+   * QGraphicsProxyWidget is created when the node becomes visible or hovered
+   * and is released after the node has been out of all views for a while.
+   * The widget itself is created only then, offscreen nodes are laid out with
+   * `NodeDelegateModel::embeddedWidgetSizeHint()`. Delegates without a size
+   * hint have their widget created with the node. The mode is off by default.
+   */
+  void
+  setLazyWidgetEmbedding(bool const enabled);
+
+  bool
+  lazyWidgetEmbedding() const { return _lazyWidgetEmbedding; }
+
+  /// Called by GraphicsView when its visible part of the scene changes.
+  void
+  scheduleWidgetEmbeddingUpdate();
+
+  /// Called by NodeGraphicsObject when it has created its proxy widget.
+  void
+  onNodeWidgetEmbedded(NodeId const nodeId);
+
+public:
+  /// Selected nodes, kept up to date by the node objects.
+  /**
+   * Unlike `QGraphicsScene::selectedItems()` the set is not rebuilt on each
+   * call and needs no casts, commands iterate it in O(selected).
+   */
+  std::unordered_set<NodeId> const &
+  selectedNodeIds() const { return _selectedNodes; }
+
+  std::unordered_set<ConnectionId> const &
+  selectedConnectionIds() const { return _selectedConnections; }
+
+  /// Called by NodeGraphicsObject when its selection state changes.
+  void
+  onNodeSelectionChanged(NodeId const nodeId, bool const selected);
+
+  /// Called by ConnectionGraphicsObject when its selection state changes.
+  void
+  onConnectionSelectionChanged(ConnectionId const connectionId,
+                               bool const         selected);
+
+  /// @returns nodes whose bounding rectangles intersect `sceneRect`.
+  /**
+   * The query is answered by a grid of node rectangles and does not scan the
+   * whole scene, see also `updateNodeIndex()`.
+   */
+  std::vector<NodeId>
+  nodesInRect(QRectF const & sceneRect) const;
+
+  /// Stores the current scene rectangle of the node in the spatial index.
+  /**
+   * Called whenever a node object moves or changes its size.
+   */
+  void
+  updateNodeIndex(NodeGraphicsObject const & ngo);
+
+  /// @returns the topmost node whose bounding rectangle contains the point.
+  NodeGraphicsObject *
+  nodeGraphicsObjectAt(QPointF const & scenePoint);
+
+  /// Port found by `locatePort()`.
+  struct PortLocation
+  {
+    NodeId nodeId = InvalidNodeId;
+
+    PortIndex portIndex = InvalidPortIndex;
+
+    /// Port anchor in scene coordinates.
+    QPointF scenePos;
+  };
+
+  /// @returns the port of `portType` nearest to `scenePoint` within `radius`.
+  /**
+   * Candidate nodes come from the node grid. Anchors of their ports are kept
+   * in scene coordinates until the node moves or changes, so a query during a
+   * connection drag neither maps points into node coordinates nor asks the
+   * geometry for each port. Ports rejected by `accept` are skipped. The
+   * `nodeId` of the result is `InvalidNodeId` when no port is found.
+   */
+  PortLocation
+  locatePort(QPointF const &                               scenePoint,
+             PortType const                                portType,
+             qreal const                                   radius,
+             std::function<bool(NodeId, PortIndex)> const & accept = nullptr);
+
+  /// Distance within which a dragged connection end snaps to a port.
+  /**
+   * The default is twice the connection point diameter of the node style.
+   */
+  void
+  setPortSnapRadius(qreal const radius);
+
+  qreal
+  portSnapRadius() const { return _portSnapRadius; }
+
+public:
+  /// Sets how often the connections of moved nodes are repositioned.
+  /**
+   * Moving a node only marks it. Its connections follow once the interval,
+   * 16 ms by default, has passed since the first mark, so a drag repositions
+   * them about once per frame and the views repaint them together with the
+   * nodes. A connection between two moved nodes is repositioned once. Zero
+   * repositions the connections right on every move.
+   */
+  void
+  setConnectionUpdateInterval(int const msec);
+
+  int
+  connectionUpdateInterval() const { return _connectionUpdateInterval; }
+
+  /// Marks the connections of the node for repositioning.
+  void
+  scheduleConnectionUpdate(NodeId const nodeId);
+
+  /// Repositions the connections of all marked nodes right away.
+  void
+  flushConnectionUpdates();
+
 public:
   /// Can @return an instance of the scene context menu in subclass.
   /**
@@ -143,6 +422,12 @@ Q_SIGNALS:
   nodeContextMenu(NodeId const nodeId, QPointF const pos);
 
 private:
+  /// Commands report their memory usage through `undoMemory()`.
+  friend class UndoCommand;
+
+  UndoMemoryBudget &
+  undoMemory() { return *_undoMemory; }
+
   /// @brief Creates Node and Connection graphics objects.
   /**
    * Function is used to populate an empty scene in the constructor. We
@@ -157,6 +442,41 @@ private:
   updateAttachedNodes(ConnectionId const connectionId,
                       PortType const portType);
 
+  /// Port anchors of the node in scene coordinates, computed on first use.
+  std::vector<QPointF> const &
+  portAnchors(NodeId const nodeId, PortType const portType);
+
+  /// Takes an object from the pool or creates a new one.
+  std::unique_ptr<NodeGraphicsObject>
+  acquireNodeGraphicsObject(NodeId const nodeId);
+
+  std::unique_ptr<ConnectionGraphicsObject>
+  acquireConnectionGraphicsObject(ConnectionId const connectionId);
+
+  /// Removes the object from the scene and keeps it for reuse.
+  void
+  releaseNodeGraphicsObject(std::unique_ptr<NodeGraphicsObject> ngo);
+
+  void
+  releaseConnectionGraphicsObject(std::unique_ptr<ConnectionGraphicsObject> cgo);
+
+  /// Embeds widgets of visible nodes and releases long invisible ones.
+  void
+  updateWidgetEmbedding();
+
+  /// Compresses commands which became older than the compression depth.
+  void
+  compressUndoHistory(int const index);
+
+  /// Deletes all node and connection objects.
+  /**
+   * Items added to the scene by the user are kept. The connection layer is
+   * deleted too, callers which keep the scene in use restore it with
+   * `setBatchedConnectionPainting()`.
+   */
+  void
+  detachAllGraphicsObjects();
+
 public Q_SLOTS:
   /// Slot called when the `connectionId` is erased form the AbstractGraphModel.
   void
@@ -191,11 +511,19 @@ private:
   std::unordered_map<NodeId, UniqueNodeGraphicsObject>
     _nodeGraphicsObjects;
 
-  std::unordered_map<ConnectionId,
-                     UniqueConnectionGraphicsObject>
+  ConnectionIdMap<UniqueConnectionGraphicsObject>
     _connectionGraphicsObjects;
 
 
+  /// Idle objects removed from the scene and waiting for reuse.
+  std::vector<UniqueNodeGraphicsObject> _nodeGraphicsObjectPool;
+
+  std::vector<UniqueConnectionGraphicsObject> _connectionGraphicsObjectPool;
+
+  std::size_t _graphicsObjectPoolLimit;
+
+  std::unique_ptr<ConnectionLayer> _connectionLayer;
+
   std::unique_ptr<ConnectionGraphicsObject> _draftConnection;
 
   std::unique_ptr<AbstractNodeGeometry> _nodeGeometry;
@@ -204,7 +532,66 @@ private:
 
   QUndoStack* _undoStack;
 
+  int _undoCompressionDepth;
+
+  int _lastUndoIndex;
+
+  /// Memory reported by the commands and the spilling policy.
+  std::unique_ptr<UndoMemoryBudget> _undoMemory;
+
   Qt::Orientation _orientation;
+
+  bool _lazyWidgetEmbedding;
+
+  QTimer * _widgetEmbeddingTimer;
+
+  QElapsedTimer _widgetEmbeddingClock;
+
+  int _batchInsertionDepth;
+
+  std::vector<NodeId> _batchedNodes;
+
+  std::vector<ConnectionId> _batchedConnections;
+
+  int _connectionUpdateInterval;
+
+  QTimer * _connectionUpdateTimer;
+
+  /// The node raised by `raiseNode()`.
+  NodeId _topNodeId;
+
+  std::unordered_set<NodeId> _selectedNodes;
+
+  std::unordered_set<ConnectionId> _selectedConnections;
+
+  std::unique_ptr<NodeSpatialIndex> _nodeIndex;
+
+  /// Cached port anchors keyed by the node id and the port type.
+  std::unordered_map<std::uint64_t, std::vector<QPointF>> _portAnchors;
+
+  qreal _portSnapRadius;
+
+  bool _connectionCulling;
+
+  mutable QRectF _visibleSceneRect;
+
+  mutable bool _visibleSceneRectValid;
+
+  /// Connections which skipped repositioning while out of all views.
+  std::unordered_set<ConnectionId> _staleConnections;
+
+  /// Moved nodes whose connections are not repositioned yet.
+  std::unordered_set<NodeId> _nodesWithMovedConnections;
+
+  /// Connections of the moved nodes, dropped once they change.
+  std::unordered_map<NodeId, std::vector<ConnectionId>> _movedNodeConnections;
+
+  /// Nodes with embedded widgets which are out of all views, in ms since start.
+  std::unordered_map<NodeId, qint64> _widgetOffscreenSince;
+
+  /// Nodes with embedded widgets while the lazy embedding is on, so updates
+  /// visit only them and the visible nodes.
+  std::unordered_set<NodeId> _embeddedWidgetNodes;
 };
 
 
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "Export.hpp"
+#include "NodeData.hpp"
+
+namespace QtNodes
+{
+
+/**
+ * NodeData holding a raw memory block, i.e. an image frame or a sample array.
+ *
+ * The memory is reference-counted and copy-on-write. Copies of a
+ * BufferNodeData share the same block, so a downstream node could take the
+ * upstream data without copying it.
+ *
+ * Data arriving at an input port is shared by the upstream node and by every
+ * other node connected to the same output, all of them holding the same
+ * `std::shared_ptr<NodeData>`. A node wanting to modify it passes its pointer
+ * to the static `detach()`, which returns a buffer safe to write to: the
+ * same object if nobody else refers to it or to its memory, a private copy
+ * otherwise.
+ *
+ * The address returned by `constData()` and `data()` is always aligned to
+ * `alignment()` bytes.
+ */
+class NODE_EDITOR_PUBLIC BufferNodeData : public NodeData
+{
+public:
+  /// Enough for any SIMD register and a cache line.
+  static constexpr std::size_t DefaultAlignment = 64;
+
+  /// Read-only window into a buffer which keeps the memory alive.
+  class NODE_EDITOR_PUBLIC View
+  {
+  public:
+    View() = default;
+
+    void const *
+    data() const { return _data; }
+
+    template<typename T>
+    T const *
+    dataAs() const { return static_cast<T const *>(_data); }
+
+    std::size_t
+    size() const { return _size; }
+
+    bool
+    isEmpty() const { return _size == 0; }
+
+  private:
+    friend class BufferNodeData;
+
+    std::shared_ptr<void const> _storage;
+
+    void const * _data = nullptr;
+
+    std::size_t _size = 0;
+  };
+
+public:
+  /// Allocates `size` uninitialized bytes.
+  BufferNodeData(NodeDataType type,
+                 std::size_t  size,
+                 std::size_t  alignment = DefaultAlignment);
+
+  /// Shares the memory of `other` and reports it under another data `type`.
+  BufferNodeData(NodeDataType          type,
+                 BufferNodeData const& other);
+
+  BufferNodeData(BufferNodeData const&) = default;
+
+  BufferNodeData &
+  operator=(BufferNodeData const&) = default;
+
+public:
+  NodeDataType
+  type() const override { return _type; }
+
+public:
+  std::size_t
+  size() const;
+
+  std::size_t
+  alignment() const;
+
+  /**
+   * @returns `true` if another BufferNodeData or a View refers to the memory.
+   * Owners of this very object are not taken into account.
+   */
+  bool
+  isShared() const;
+
+  void const *
+  constData() const;
+
+  /**
+   * Detaches from the other owners first if the memory is shared. Writing
+   * is only safe if the caller is the sole owner of this object, e.g. when
+   * it has just created it or obtained it from the static `detach()`.
+   */
+  void *
+  data();
+
+  template<typename T>
+  T const *
+  constDataAs() const { return static_cast<T const *>(constData()); }
+
+  template<typename T>
+  T *
+  dataAs() { return static_cast<T *>(data()); }
+
+  /// Read-only view sharing the memory of this buffer.
+  View
+  view() const;
+
+  /**
+   * Allocates a private copy of the memory if it is shared. Does nothing
+   * otherwise. As `data()`, this does not protect other owners of the
+   * object.
+   */
+  void
+  detach();
+
+  /**
+   * Takes over `buffer` and returns a buffer the caller may write to.
+   *
+   * The object is returned as is when the moved-in pointer was its only
+   * owner and its memory is not shared. Otherwise the result is a new
+   * object with a private copy of the memory, leaving the data seen by the
+   * other owners untouched.
+   */
+  static
+  std::shared_ptr<BufferNodeData>
+  detach(std::shared_ptr<BufferNodeData> && buffer);
+
+  /**
+   * Same for data received through `NodeDelegateModel::setInData`.
+   * @returns `nullptr` if `data` is not a BufferNodeData; `data` is left
+   * untouched then.
+   */
+  static
+  std::shared_ptr<BufferNodeData>
+  detach(std::shared_ptr<NodeData> && data);
+
+private:
+  struct Storage;
+
+  NodeDataType _type;
+
+  std::shared_ptr<Storage> _storage;
+};
+
+}
@@ -65,21 +65,46 @@ public:
   setEndPoint(PortType portType, QPointF const &point);
 
   /// Updates the position of both ends
+  /**
+   * With connection culling enabled in the scene, a connection which stays
+   * out of all views is only marked stale and keeps its old geometry.
+   */
   void
   move();
 
+  /// Scene rectangle containing the connection once it is moved.
+  /**
+   * Estimated from the attached nodes without recomputing the geometry.
+   */
+  QRectF
+  estimatedSceneBounds() const;
+
   ConnectionState const &
   connectionState() const;
 
   ConnectionState &
   connectionState();
 
+  /// Resets the interaction state before the object is pooled by the scene.
+  void
+  detachFromConnection();
+
+  /// Reinitializes a pooled object for `connectionId`.
+  /**
+   * The object must already be added to a BasicGraphicsScene.
+   */
+  void
+  attachToConnection(ConnectionId const connectionId);
+
 protected:
   void
   paint(QPainter * painter,
         QStyleOptionGraphicsItem const * option,
         QWidget *  widget = 0) override;
 
+  QVariant
+  itemChange(GraphicsItemChange change, const QVariant &value) override;
+
   void
   mousePressEvent(QGraphicsSceneMouseEvent * event) override;
 
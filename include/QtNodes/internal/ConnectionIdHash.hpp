@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <tuple>
+#include <utility>
 
 #include "Definitions.hpp"
 
@@ -16,6 +19,59 @@ hash_combine(std::size_t& seed, const T& v, Rest... rest)
 }
 
 
+namespace QtNodes
+{
+
+/// ConnectionId packed into two 64-bit words, out side first.
+struct PackedConnectionId
+{
+  std::uint64_t out;
+  std::uint64_t in;
+};
+
+
+inline
+PackedConnectionId
+packConnectionId(ConnectionId const & id)
+{
+  return PackedConnectionId{
+    (static_cast<std::uint64_t>(id.outNodeId) << 32) | id.outPortIndex,
+    (static_cast<std::uint64_t>(id.inNodeId) << 32) | id.inPortIndex};
+}
+
+
+/**
+ * Finalizer of SplitMix64. Every input bit affects every output bit, so
+ * sequential node ids and small port indices spread over all the buckets.
+ * `std::hash<unsigned>` is the identity on common standard libraries and
+ * combining such values leaves most of them in a few buckets.
+ */
+inline
+std::uint64_t
+mixHash(std::uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+
+  return x;
+}
+
+
+inline
+std::uint64_t
+hashConnectionId(ConnectionId const & id)
+{
+  PackedConnectionId const packed = packConnectionId(id);
+
+  return mixHash(mixHash(packed.out) ^ packed.in);
+}
+
+}
+
+
 namespace std
 {
 template<>
@@ -25,13 +81,7 @@ struct hash<QtNodes::ConnectionId>
   std::size_t
   operator()(QtNodes::ConnectionId const& id) const
   {
-    std::size_t h = 0;
-    hash_combine(h,
-                 id.outNodeId,
-                 id.outPortIndex,
-                 id.inNodeId,
-                 id.inPortIndex);
-    return h;
+    return static_cast<std::size_t>(QtNodes::hashConnectionId(id));
   }
 
 };
@@ -44,11 +94,10 @@ struct hash<std::pair<QtNodes::NodeId, QtNodes::PortIndex>>
   std::size_t
   operator()(std::pair<QtNodes::NodeId, QtNodes::PortIndex> const & nodePort) const
   {
-    std::size_t h = 0;
-    hash_combine(h,
-                 nodePort.first,
-                 nodePort.second);
-    return h;
+    std::uint64_t const packed =
+      (static_cast<std::uint64_t>(nodePort.first) << 32) | nodePort.second;
+
+    return static_cast<std::size_t>(QtNodes::mixHash(packed));
   }
 
 };
@@ -66,14 +115,13 @@ struct hash<std::tuple<QtNodes::NodeId,
   std::size_t
   operator()(Key const &key) const
   {
-    std::size_t h = 0;
-    hash_combine(h,
-                 std::get<0>(key),
-                 std::get<1>(key),
-                 std::get<2>(key));
-    return h;
+    std::uint64_t const packed =
+      (static_cast<std::uint64_t>(std::get<0>(key)) << 32) | std::get<2>(key);
+
+    return static_cast<std::size_t>(
+      QtNodes::mixHash(QtNodes::mixHash(packed) ^
+                       static_cast<std::uint64_t>(std::get<1>(key))));
   }
 
 };
 }
-
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+
+namespace QtNodes
+{
+
+/**
+ * Open-addressing hash map from ConnectionId to `T`.
+ *
+ * The slots live in one array probed linearly from the position given by
+ * `hashConnectionId()`. A lookup touches one or two adjacent slots instead of
+ * chasing the bucket list of `std::unordered_map`, and an insertion does not
+ * allocate until the table grows. Erasing shifts the following entries back,
+ * so there are no tombstones.
+ *
+ * The interface follows the subset of `std::unordered_map` used in the
+ * library. Unlike there, insertions and erasures invalidate all iterators and
+ * references to the values.
+ */
+template<typename T>
+class ConnectionIdMap
+{
+public:
+  using value_type = std::pair<ConnectionId, T>;
+
+private:
+  struct Slot
+  {
+    bool occupied = false;
+
+    value_type entry;
+  };
+
+  template<typename SlotType, typename ValueType>
+  class Iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = ValueType;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = ValueType *;
+    using reference         = ValueType &;
+
+    Iterator(SlotType * slot, SlotType * end)
+      : _slot(slot)
+      , _end(end)
+    {
+      skipEmpty();
+    }
+
+    /// Conversion from the mutable iterator.
+    template<typename OtherSlot, typename OtherValue>
+    Iterator(Iterator<OtherSlot, OtherValue> const & other)
+      : _slot(other._slot)
+      , _end(other._end)
+    {}
+
+    reference
+    operator*() const { return _slot->entry; }
+
+    pointer
+    operator->() const { return &_slot->entry; }
+
+    Iterator &
+    operator++()
+    {
+      ++_slot;
+      skipEmpty();
+
+      return *this;
+    }
+
+    bool
+    operator==(Iterator const & other) const { return _slot == other._slot; }
+
+    bool
+    operator!=(Iterator const & other) const { return _slot != other._slot; }
+
+  private:
+    void
+    skipEmpty()
+    {
+      while (_slot != _end && !_slot->occupied)
+        ++_slot;
+    }
+
+  private:
+    template<typename, typename>
+    friend class Iterator;
+
+    friend class ConnectionIdMap;
+
+    SlotType * _slot;
+    SlotType * _end;
+  };
+
+public:
+  using iterator       = Iterator<Slot, value_type>;
+  using const_iterator = Iterator<Slot const, value_type const>;
+
+public:
+  std::size_t
+  size() const { return _size; }
+
+  bool
+  empty() const { return _size == 0; }
+
+  iterator
+  begin() { return iterator(slotsBegin(), slotsEnd()); }
+
+  iterator
+  end() { return iterator(slotsEnd(), slotsEnd()); }
+
+  const_iterator
+  begin() const { return const_iterator(slotsBegin(), slotsEnd()); }
+
+  const_iterator
+  end() const { return const_iterator(slotsEnd(), slotsEnd()); }
+
+  iterator
+  find(ConnectionId const & key)
+  {
+    std::size_t const index = indexOf(key);
+
+    return index == NoIndex ? end() : iterator(&_slots[index], slotsEnd());
+  }
+
+  const_iterator
+  find(ConnectionId const & key) const
+  {
+    std::size_t const index = indexOf(key);
+
+    return index == NoIndex ? end() : const_iterator(&_slots[index], slotsEnd());
+  }
+
+  std::size_t
+  count(ConnectionId const & key) const { return indexOf(key) == NoIndex ? 0 : 1; }
+
+  /// Inserts a default constructed value if the key is missing.
+  T &
+  operator[](ConnectionId const & key)
+  {
+    std::size_t index = indexOf(key);
+
+    if (index != NoIndex)
+      return _slots[index].entry.second;
+
+    // Keeps the load factor at 3/4 at most.
+    if (4 * (_size + 1) > 3 * _slots.size())
+      rehash(_slots.empty() ? MinSlotCount : 2 * _slots.size());
+
+    index = probeStart(key);
+
+    while (_slots[index].occupied)
+      index = (index + 1) & mask();
+
+    _slots[index].occupied = true;
+    _slots[index].entry    = value_type(key, T());
+
+    ++_size;
+
+    return _slots[index].entry.second;
+  }
+
+  void
+  erase(const_iterator const position)
+  {
+    eraseAt(static_cast<std::size_t>(position._slot - slotsBegin()));
+  }
+
+  std::size_t
+  erase(ConnectionId const & key)
+  {
+    std::size_t const index = indexOf(key);
+
+    if (index == NoIndex)
+      return 0;
+
+    eraseAt(index);
+
+    return 1;
+  }
+
+  void
+  clear()
+  {
+    std::vector<Slot>().swap(_slots);
+    _size = 0;
+  }
+
+private:
+  static constexpr std::size_t NoIndex = static_cast<std::size_t>(-1);
+
+  static constexpr std::size_t MinSlotCount = 16;
+
+  Slot *
+  slotsBegin() { return _slots.data(); }
+
+  Slot *
+  slotsEnd() { return _slots.data() + _slots.size(); }
+
+  Slot const *
+  slotsBegin() const { return _slots.data(); }
+
+  Slot const *
+  slotsEnd() const { return _slots.data() + _slots.size(); }
+
+  std::size_t
+  mask() const { return _slots.size() - 1; }
+
+  std::size_t
+  probeStart(ConnectionId const & key) const
+  {
+    return static_cast<std::size_t>(hashConnectionId(key)) & mask();
+  }
+
+  std::size_t
+  indexOf(ConnectionId const & key) const
+  {
+    if (_size == 0)
+      return NoIndex;
+
+    std::size_t index = probeStart(key);
+
+    while (_slots[index].occupied)
+    {
+      if (_slots[index].entry.first == key)
+        return index;
+
+      index = (index + 1) & mask();
+    }
+
+    return NoIndex;
+  }
+
+  void
+  eraseAt(std::size_t hole)
+  {
+    _slots[hole].occupied = false;
+    _slots[hole].entry    = value_type();
+
+    --_size;
+
+    // Moves back every following entry whose probe sequence crosses the hole.
+    std::size_t index = (hole + 1) & mask();
+
+    while (_slots[index].occupied)
+    {
+      std::size_t const start = probeStart(_slots[index].entry.first);
+
+      bool const crossesHole = ((index - start) & mask()) >= ((index - hole) & mask());
+
+      if (crossesHole)
+      {
+        _slots[hole] = std::move(_slots[index]);
+
+        _slots[index].occupied = false;
+        _slots[index].entry    = value_type();
+
+        hole = index;
+      }
+
+      index = (index + 1) & mask();
+    }
+  }
+
+  void
+  rehash(std::size_t const slotCount)
+  {
+    std::vector<Slot> oldSlots(slotCount);
+
+    // The new, empty table goes in place, the entries are moved over from the old one.
+    oldSlots.swap(_slots);
+
+    for (Slot & slot : oldSlots)
+    {
+      if (!slot.occupied)
+        continue;
+
+      std::size_t index = probeStart(slot.entry.first);
+
+      while (_slots[index].occupied)
+        index = (index + 1) & mask();
+
+      _slots[index] = std::move(slot);
+    }
+  }
+
+private:
+  /// Power of two in size.
+  std::vector<Slot> _slots;
+
+  std::size_t _size = 0;
+};
+
+
+template<typename T>
+constexpr std::size_t ConnectionIdMap<T>::NoIndex;
+
+template<typename T>
+constexpr std::size_t ConnectionIdMap<T>::MinSlotCount;
+
+}
@@ -1,16 +1,23 @@
 #pragma once
 
+#include "ConnectionIdMap.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "DenseNodeMap.hpp"
+#include "GraphSnapshot.hpp"
 #include "NodeDelegateModelRegistry.hpp"
 #include "AbstractGraphModel.hpp"
 #include "StyleCollection.hpp"
 #include "Serializable.hpp"
+#include "SmallVector.hpp"
 
 #include "Export.hpp"
 
 #include <QJsonObject>
+#include <QtCore/QPointer>
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace QtNodes
 {
@@ -46,15 +53,27 @@ public:
               PortType  portType,
               PortIndex portIndex) const override;
 
+  /**
+   * Looks for exactly this connection, i.e. both of its ports must match.
+   * An unrelated connection leaving the same output port does not count.
+   */
   bool
   connectionExists(ConnectionId const connectionId) const override;
 
   NodeId
   addNode(QString const nodeType) override;
 
+  NodeId
+  newNodeId() const override { return _nextNodeId; }
+
   bool
   connectionPossible(ConnectionId const connectionId) const override;
 
+  /**
+   * Connections are stored by their nodes, so the call does nothing and
+   * emits no signal if either node does not exist. Adding a connection
+   * twice stores it once.
+   */
   void
   addConnection(ConnectionId const connectionId) override;
 
@@ -101,6 +120,14 @@ public:
   void
   loadNode(QJsonObject const & nodeJson) override;
 
+  /**
+   * Data is propagated once per output port after all the connections are
+   * in place, instead of once per added connection.
+   */
+  void
+  loadNodes(std::vector<QJsonObject> const &  nodesJson,
+            std::vector<ConnectionId> const & connectionIds) override;
+
   void
   load(QJsonObject const &json) override;
 
@@ -110,6 +137,24 @@ public:
   void
   loadConnection(QJsonObject const & connJson) override;
 
+  /// Captures the current state of the graph.
+  /**
+   * The model keeps the snapshot maps up to date on every change, so the
+   * call only re-saves the delegates which signalled new data since the
+   * previous snapshot. Everything else is shared with the older snapshots.
+   */
+  GraphSnapshot
+  snapshot() const;
+
+  /// Makes the next snapshot re-save the internal data of the node.
+  /**
+   * Delegates are re-saved after emitting `dataUpdated` or receiving input
+   * data. The function is needed only for delegates whose saved state
+   * changes otherwise.
+   */
+  void
+  invalidateSnapshot(NodeId const nodeId);
+
   /**
    * Fetches the NodeDelegateModel for the given `nodeId` and tries to cast the
    * stored pointer to the given type
@@ -118,15 +163,28 @@ public:
   NodeDelegateModelType*
   delegateModel(NodeId const nodeId)
   {
-    auto it = _models.find(nodeId);
-    if (it == _models.end())
+    NodeEntry * entry = _nodes.find(nodeId);
+    if (!entry)
       return nullptr;
 
-    auto model = dynamic_cast<NodeDelegateModelType*>(it->second.get());
+    auto model = dynamic_cast<NodeDelegateModelType*>(entry->model.get());
 
     return model;
   }
 
+protected:
+  /**
+   * Typed counterpart of `setPortData(..., PortRole::Data)`. Both the data
+   * propagation and `setPortData` deliver input data through this function,
+   * so derived models observing or filtering incoming data override it
+   * instead of `setPortData`. The pointer reaches the delegate without
+   * QVariant boxing.
+   */
+  virtual void
+  setInPortData(NodeId const              nodeId,
+                PortIndex const           portIndex,
+                std::shared_ptr<NodeData> data);
+
 Q_SIGNALS:
   void
   inPortDataWasSet(NodeId const,
@@ -134,8 +192,46 @@ Q_SIGNALS:
                    PortIndex const);
 
 private:
-  NodeId
-  newNodeId() { return _nextNodeId++; }
+  /// One side of a connection, as seen from the node storing it.
+  struct PortEdge
+  {
+    PortType portType;
+
+    PortIndex portIndex;
+
+    NodeId otherNodeId;
+
+    PortIndex otherPortIndex;
+  };
+
+  /// Everything the model stores per node, kept contiguously.
+  struct NodeEntry
+  {
+    std::unique_ptr<NodeDelegateModel> model;
+
+    NodeGeometryData geometry;
+
+    /// Set once `NodeRole::Widget` has been queried.
+    mutable QPointer<QWidget> widget;
+
+    /**
+     * Port types returned by the delegate, with their handles interned.
+     * Filled when a type is first queried and dropped on `nodeUpdated`.
+     */
+    mutable std::vector<NodeDataType> inTypes;
+
+    mutable std::vector<NodeDataType> outTypes;
+
+    /// Set while the internal data in the snapshot may be outdated.
+    mutable bool snapshotDirty = false;
+
+    /**
+     * Connections of both port types sorted by port, then by the other side.
+     * A connection is stored by both of its nodes. Most nodes have one input
+     * and one output connection, which fit into the inline storage.
+     */
+    SmallVector<PortEdge, 2> edges;
+  };
 
   /**
    * The function could be used when we restore nodes from some file
@@ -149,6 +245,19 @@ private:
     _nextNodeId = std::max(_nextNodeId, restoredNodeId + 1);
   }
 
+  /// Returns the cached type of the port, filling the cache when needed.
+  NodeDataType
+  portDataType(NodeEntry const & entry,
+               PortType const    portType,
+               PortIndex const   portIndex) const;
+
+  /// Stores the edges and notifies about the connection, nothing else.
+  /**
+   * @returns `false` if either node does not exist.
+   */
+  bool
+  insertConnection(ConnectionId const connectionId);
+
 private Q_SLOTS:
   /**
    * Fuction is called in three cases:
@@ -170,24 +279,115 @@ private Q_SLOTS:
   propagateEmptyDataTo(NodeId const    nodeId,
                        PortIndex const portIndex);
 
+  /**
+   * The port types of the node may have changed, so the cached port types
+   * and the converters resolved for its connections are dropped. They are
+   * looked up again when next queried or when the next data is sent.
+   */
+  void
+  onNodeUpdated(NodeId const nodeId);
+
+private:
+  /**
+   * Runs the converter resolved for the connection if its ports have
+   * different data types. The result is cached until the upstream node
+   * produces a new data object, the cache does not keep the source alive.
+   * Without a registered converter the data is passed through unchanged.
+   */
+  std::shared_ptr<NodeData>
+  convertedPortData(ConnectionId const        connectionId,
+                    std::shared_ptr<NodeData> outData);
+
+  /// Looks up the port types and the converter of the connection once.
+  /**
+   * Called when the connection is stored, see `insertConnection()`, so
+   * that propagation only compares the cached handles.
+   */
+  void
+  resolveConversion(ConnectionId const connectionId);
+
+  /**
+   * Creates a NodeDataChannel for a connection between two streaming ports
+   * and hands it to both delegates.
+   * @returns `false` for regular snapshot connections.
+   */
+  bool
+  openChannel(ConnectionId const connectionId);
+
+  /// Closes and detaches the channel of a streaming connection.
+  bool
+  closeChannel(ConnectionId const connectionId);
+
+  /// @returns `nullptr` for unknown nodes.
+  NodeDelegateModel *
+  delegate(NodeId const nodeId) const
+  {
+    NodeEntry const * entry = _nodes.find(nodeId);
+
+    return entry ? entry->model.get() : nullptr;
+  }
+
+  /// Edges attached to the given port, an empty range for unknown nodes.
+  std::pair<PortEdge const *, PortEdge const *>
+  portEdges(NodeId const    nodeId,
+            PortType const  portType,
+            PortIndex const portIndex) const;
+
+  /// Copies the position and size of the node to the snapshot geometry.
+  void
+  updateSnapshotGeometry(NodeId const nodeId);
+
+  /// Queues the internal data of the node for the next `snapshot()`.
+  /**
+   * Called whenever data reaches or leaves a delegate, so marking a node
+   * which is already queued costs only a flag test.
+   */
+  void
+  markSnapshotDirty(NodeId const nodeId, NodeEntry const & entry) const;
+
 private:
   std::shared_ptr<NodeDelegateModelRegistry> _registry;
 
   NodeId _nextNodeId;
 
-  std::unordered_map<NodeId,
-                     std::unique_ptr<NodeDelegateModel>>
-  _models;
+  DenseNodeMap<NodeEntry> _nodes;
+
+  /// Port types of a connection, its converter and the last conversion result.
+  struct ConvertedData
+  {
+    NodeDataTypeHandle outType = InvalidNodeDataTypeHandle;
+    NodeDataTypeHandle inType  = InvalidNodeDataTypeHandle;
+
+    /// Empty for equal types or if no converter is registered.
+    NodeDelegateModelRegistry::TypeConverter converter;
+
+    /// Identifies the source without keeping it alive. The control block
+    /// outlives the object, so a new object can't be mistaken for it.
+    std::weak_ptr<NodeData> source;
+    NodeData const * sourcePointer = nullptr;
+
+    std::shared_ptr<NodeData> result;
+  };
 
-  using ConnectivityKey =
-    std::tuple<NodeId, PortType, PortIndex>;
+  ConnectionIdMap<ConvertedData>
+  _convertedData;
 
-  std::unordered_map<ConnectivityKey,
-                     std::unordered_set<std::pair<NodeId, PortIndex>>>
-  _connectivity;
+  ConnectionIdMap<std::shared_ptr<NodeDataChannel>>
+  _channels;
 
-  mutable std::unordered_map<NodeId, NodeGeometryData>
-  _nodeGeometryData;
+  /// Internal data is written lazily by `snapshot()`.
+  mutable GraphSnapshot::NodeMap _snapshotNodes;
+
+  GraphSnapshot::GeometryMap _snapshotGeometry;
+
+  GraphSnapshot::ConnectionMap _snapshotConnections;
+
+  /// Nodes whose internal data in `_snapshotNodes` may be outdated.
+  /**
+   * Deleted nodes are not taken out. `snapshot()` skips every id whose
+   * entry is gone or no longer flagged.
+   */
+  mutable std::vector<NodeId> _snapshotDirtyNodes;
 };
 
 
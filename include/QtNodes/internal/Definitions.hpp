@@ -30,6 +30,7 @@ enum class NodeRole
   InPortCount      = 7, ///< `unsigned int`
   OutPortCount     = 9, ///< `unsigned int`
   Widget           = 10, ///< Optional `QWidget*` or `nullptr`
+  WidgetSize       = 11, ///< Hinted `QSize` of a widget not created yet, or invalid
 };
 Q_ENUM_NS(NodeRole)
 
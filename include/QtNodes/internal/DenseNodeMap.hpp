@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Definitions.hpp"
+
+namespace QtNodes
+{
+
+/**
+ * Map from NodeId to `T` keeping the values in one contiguous array.
+ *
+ * Node ids are handed out by a counter, so they are mostly small and dense.
+ * A slot table indexed directly by the id points into the dense array of
+ * entries, and a lookup is two array reads without hashing. Ids far above
+ * the number of entries, i.e. restored from a file with large gaps, are kept
+ * in a small hash map instead, so the slot table stays proportional to the
+ * entry count.
+ *
+ * Erasing moves the last entry into the freed place, iteration therefore
+ * visits the entries in an unspecified order. Pointers to the values are
+ * invalidated by insertions and erasures.
+ */
+template<typename T>
+class DenseNodeMap
+{
+public:
+  struct Entry
+  {
+    NodeId id;
+    T      value;
+  };
+
+  using iterator       = typename std::vector<Entry>::iterator;
+  using const_iterator = typename std::vector<Entry>::const_iterator;
+
+public:
+  std::size_t
+  size() const { return _entries.size(); }
+
+  bool
+  empty() const { return _entries.empty(); }
+
+  iterator
+  begin() { return _entries.begin(); }
+
+  iterator
+  end() { return _entries.end(); }
+
+  const_iterator
+  begin() const { return _entries.begin(); }
+
+  const_iterator
+  end() const { return _entries.end(); }
+
+  bool
+  contains(NodeId const id) const { return indexOf(id) != NoIndex; }
+
+  /// @returns `nullptr` if there is no entry for the id.
+  T *
+  find(NodeId const id)
+  {
+    std::uint32_t const index = indexOf(id);
+
+    return index == NoIndex ? nullptr : &_entries[index].value;
+  }
+
+  T const *
+  find(NodeId const id) const
+  {
+    std::uint32_t const index = indexOf(id);
+
+    return index == NoIndex ? nullptr : &_entries[index].value;
+  }
+
+  /// Inserts the value or replaces the existing one.
+  T &
+  insert(NodeId const id, T value)
+  {
+    std::uint32_t const index = indexOf(id);
+
+    if (index != NoIndex)
+    {
+      _entries[index].value = std::move(value);
+
+      return _entries[index].value;
+    }
+
+    auto const newIndex = static_cast<std::uint32_t>(_entries.size());
+
+    _entries.push_back(Entry{id, std::move(value)});
+
+    setIndex(id, newIndex);
+
+    return _entries.back().value;
+  }
+
+  /// @returns `true` if the entry existed.
+  bool
+  erase(NodeId const id)
+  {
+    std::uint32_t const index = indexOf(id);
+
+    if (index == NoIndex)
+      return false;
+
+    std::uint32_t const lastIndex = static_cast<std::uint32_t>(_entries.size() - 1);
+
+    if (index != lastIndex)
+    {
+      _entries[index] = std::move(_entries[lastIndex]);
+
+      setIndex(_entries[index].id, index);
+    }
+
+    _entries.pop_back();
+
+    clearIndex(id);
+
+    return true;
+  }
+
+  void
+  clear()
+  {
+    _entries.clear();
+    _slots.clear();
+    _farSlots.clear();
+  }
+
+  void
+  reserve(std::size_t const size)
+  {
+    _entries.reserve(size);
+  }
+
+private:
+  static constexpr std::uint32_t NoIndex = 0xFFFFFFFFu;
+
+  /// Minimal reach of the slot table, in ids.
+  static constexpr std::size_t MinSlotCount = 1024;
+
+  std::uint32_t
+  indexOf(NodeId const id) const
+  {
+    if (id < _slots.size())
+      return _slots[id];
+
+    if (_farSlots.empty())
+      return NoIndex;
+
+    auto it = _farSlots.find(id);
+
+    return it == _farSlots.end() ? NoIndex : it->second;
+  }
+
+  void
+  setIndex(NodeId const id, std::uint32_t const index)
+  {
+    if (id < _slots.size())
+    {
+      _slots[id] = index;
+      return;
+    }
+
+    // The table may cover up to a few times more ids than there are entries.
+    std::size_t const reach = std::max(MinSlotCount, 4 * _entries.size());
+
+    if (static_cast<std::size_t>(id) >= reach)
+    {
+      _farSlots[id] = index;
+      return;
+    }
+
+    std::size_t const newSize =
+      std::min(reach, std::max(static_cast<std::size_t>(id) + 1, 2 * _slots.size()));
+
+    _slots.resize(newSize, NoIndex);
+
+    _slots[id] = index;
+
+    // Far ids now covered by the table move into it.
+    for (auto it = _farSlots.begin(); it != _farSlots.end();)
+    {
+      if (it->first < _slots.size())
+      {
+        _slots[it->first] = it->second;
+        it = _farSlots.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  void
+  clearIndex(NodeId const id)
+  {
+    if (id < _slots.size())
+      _slots[id] = NoIndex;
+    else
+      _farSlots.erase(id);
+  }
+
+private:
+  std::vector<Entry> _entries;
+
+  /// Dense index of the entry for each id, `NoIndex` for absent ids.
+  std::vector<std::uint32_t> _slots;
+
+  std::unordered_map<NodeId, std::uint32_t> _farSlots;
+};
+
+
+template<typename T>
+constexpr std::uint32_t DenseNodeMap<T>::NoIndex;
+
+template<typename T>
+constexpr std::size_t DenseNodeMap<T>::MinSlotCount;
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QtCore/QFile>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include "Export.hpp"
+#include "GraphSnapshot.hpp"
+
+class QTimer;
+
+namespace QtNodes
+{
+
+class DataFlowGraphModel;
+
+/// Journaled persistence of a DataFlowGraphModel.
+/**
+ * The document is kept as a base ".flow" file and an append-only sidecar
+ * log next to it ("<document>.journal"). Every flush appends the changes
+ * made since the previous flush as one binary frame: added and removed
+ * nodes and connections, new node positions and new internal data. Moving
+ * one node costs a few dozen bytes regardless of the document size.
+ *
+ * `compact()` rewrites the base file from a snapshot and empties the log.
+ * It runs on an explicit save and whenever the log outgrows the compaction
+ * threshold.
+ *
+ * `open()` loads the base file and replays the log, which restores the
+ * graph after a crash. A frame torn by the crash is detected by its checksum
+ * and ignored. The records are idempotent, so replaying a log already merged
+ * into the base file by an interrupted compaction is harmless.
+ */
+class NODE_EDITOR_PUBLIC GraphJournal : public QObject
+{
+  Q_OBJECT
+
+public:
+  GraphJournal(DataFlowGraphModel & graphModel,
+               QObject *            parent = nullptr);
+
+  /// Flushes the pending changes.
+  ~GraphJournal();
+
+public:
+  /// Loads the document and its journal into the model.
+  /**
+   * The model is expected to be empty. A missing base file is treated as an
+   * empty document. @returns `false` if the files could not be opened, the
+   * base file is not a valid document or the log file is not a journal; the
+   * model and `documentPath()` are left untouched and nothing is written
+   * then.
+   */
+  bool
+  open(QString const & documentPath);
+
+  void
+  close();
+
+  bool
+  isOpen() const { return _journal.isOpen(); }
+
+  QString
+  documentPath() const { return _documentPath; }
+
+  QString
+  journalPath() const;
+
+  /// Time between two flushes, 1 s by default.
+  void
+  setFlushInterval(int const msec);
+
+  int
+  flushInterval() const;
+
+  /// Journal size triggering the compaction, 16 MB by default.
+  void
+  setCompactionThreshold(qint64 const bytes);
+
+  qint64
+  compactionThreshold() const { return _compactionThreshold; }
+
+  qint64
+  journalSize() const;
+
+public Q_SLOTS:
+  /// Appends the changes since the previous flush to the journal.
+  bool
+  flush();
+
+  /// Writes the whole graph to the base file and empties the journal.
+  bool
+  compact();
+
+Q_SIGNALS:
+  void
+  compacted();
+
+  void
+  writeFailed(QString const & errorString);
+
+private:
+  /// Applies the journal frames to the model.
+  void
+  replay(QByteArray const & journalContent);
+
+  bool
+  writeHeader();
+
+private:
+  DataFlowGraphModel & _graphModel;
+
+  QTimer * _flushTimer;
+
+  QString _documentPath;
+
+  QFile _journal;
+
+  qint64 _compactionThreshold;
+
+  /// The graph as it is stored by the base file and the journal.
+  GraphSnapshot _journaledSnapshot;
+};
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
+
+#include <vector>
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "PersistentHashMap.hpp"
+
+namespace QtNodes
+{
+
+/// Changes between two snapshots of one graph, see `GraphSnapshot::diff`.
+struct GraphSnapshotDiff
+{
+  std::vector<NodeId> addedNodes;
+  std::vector<NodeId> removedNodes;
+
+  /// Nodes with new internal data, position or size.
+  std::vector<NodeId> changedNodes;
+
+  std::vector<ConnectionId> addedConnections;
+  std::vector<ConnectionId> removedConnections;
+
+  bool
+  isEmpty() const
+  {
+    return addedNodes.empty() && removedNodes.empty() &&
+           changedNodes.empty() && addedConnections.empty() &&
+           removedConnections.empty();
+  }
+};
+
+
+/**
+ * Immutable state of a DataFlowGraphModel at some moment.
+ *
+ * The snapshot consists of three PersistentHashMap instances shared with the
+ * model and with all the other snapshots, see `DataFlowGraphModel::snapshot`.
+ * Holding a snapshot costs only the parts of the graph changed afterwards.
+ *
+ * Snapshots do not refer to the model and could be copied to and read from
+ * any thread, i.e. for exporting the graph in the background.
+ */
+class NODE_EDITOR_PUBLIC GraphSnapshot
+{
+public:
+  struct NodeGeometry
+  {
+    QPointF pos;
+    QSize   size;
+
+    bool
+    operator==(NodeGeometry const & other) const
+    {
+      return pos == other.pos && size == other.size;
+    }
+  };
+
+  /// Output of `NodeDelegateModel::save()`, the "internal-data" JSON.
+  using NodeMap = PersistentHashMap<NodeId, QJsonObject>;
+
+  using GeometryMap = PersistentHashMap<NodeId, NodeGeometry>;
+
+  /// Only the keys are used.
+  using ConnectionMap = PersistentHashMap<ConnectionId, bool>;
+
+public:
+  /// An empty graph.
+  GraphSnapshot() = default;
+
+  GraphSnapshot(NodeMap       nodes,
+                GeometryMap   geometry,
+                ConnectionMap connections);
+
+public:
+  NodeMap const &
+  nodes() const { return _nodes; }
+
+  GeometryMap const &
+  geometry() const { return _geometry; }
+
+  ConnectionMap const &
+  connections() const { return _connections; }
+
+  bool
+  nodeExists(NodeId const nodeId) const { return _nodes.contains(nodeId); }
+
+  bool
+  connectionExists(ConnectionId const & connectionId) const
+  {
+    return _connections.contains(connectionId);
+  }
+
+  /// @returns an empty object for unknown nodes.
+  QJsonObject
+  nodeInternalData(NodeId const nodeId) const;
+
+  QPointF
+  nodePosition(NodeId const nodeId) const;
+
+  QSize
+  nodeSize(NodeId const nodeId) const;
+
+  /**
+   * @returns `true` if both snapshots are the same version of the graph.
+   * Snapshots taken without any change in between are always identical.
+   */
+  bool
+  isIdenticalTo(GraphSnapshot const & other) const;
+
+  /// Lists the changes made from `older` to this snapshot.
+  /**
+   * The cost is proportional to the number of changes, the parts shared by
+   * both snapshots are not visited.
+   */
+  GraphSnapshotDiff
+  diff(GraphSnapshot const & older) const;
+
+  /// Same document as `DataFlowGraphModel::save()` would have produced.
+  QJsonObject
+  toJson() const;
+
+private:
+  NodeMap _nodes;
+
+  GeometryMap _geometry;
+
+  ConnectionMap _connections;
+};
+
+}
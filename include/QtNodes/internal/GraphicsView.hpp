@@ -1,9 +1,19 @@
 #pragma once
 
+#include <QtCore/QLineF>
+#include <QtCore/QRect>
 #include <QtWidgets/QGraphicsView>
 
+#include <unordered_map>
+#include <vector>
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+
 #include "Export.hpp"
 
+class QRubberBand;
+
 namespace QtNodes
 {
 
@@ -27,12 +37,37 @@ public:
   QAction*
   deleteSelectionAction() const;
 
+  QAction*
+  copySelectionAction() const { return _copySelectionAction; }
+
+  QAction*
+  cutSelectionAction() const { return _cutSelectionAction; }
+
+  QAction*
+  pasteAction() const { return _pasteAction; }
+
+  QAction*
+  duplicateSelectionAction() const { return _duplicateSelectionAction; }
+
   void
   setScene(BasicGraphicsScene *scene);
 
   void
   centerScene();
 
+  /// Skips the grid levels whose lines would be closer on the screen.
+  /**
+   * Zoomed far out, the fine grid turns into a flat fill of lines a pixel or
+   * two apart, and skipping it saves most of the background painting. The
+   * skipped level is not drawn at all, which changes the look of the
+   * background. The default is 0, every level is always drawn.
+   */
+  void
+  setMinGridSpacing(double const pixels);
+
+  double
+  minGridSpacing() const { return _minGridSpacing; }
+
 public Q_SLOTS:
   void
   scaleUp();
@@ -43,6 +78,21 @@ public Q_SLOTS:
   void
   onDeleteSelectedObjects();
 
+  /// Puts the selected nodes and their inner connections on the clipboard.
+  void
+  onCopySelectedObjects();
+
+  void
+  onCutSelectedObjects();
+
+  /// Pastes the clipboard nodes under the cursor.
+  void
+  onPasteObjects();
+
+  /// Copies the selected nodes next to the originals without the clipboard.
+  void
+  onDuplicateSelectedObjects();
+
 protected:
   void
   contextMenuEvent(QContextMenuEvent *event) override;
@@ -62,20 +112,98 @@ protected:
   void
   mouseMoveEvent(QMouseEvent *event) override;
 
+  void
+  mouseReleaseEvent(QMouseEvent *event) override;
+
   void
   drawBackground(QPainter* painter, const QRectF & r) override;
 
   void
   showEvent(QShowEvent *event) override;
 
+  void
+  hideEvent(QHideEvent *event) override;
+
+  void
+  scrollContentsBy(int dx, int dy) override;
+
+  void
+  resizeEvent(QResizeEvent *event) override;
+
 protected:
   BasicGraphicsScene *
   nodeScene();
 
+private:
+  /// Lines of one grid level around the viewport, kept while panning.
+  struct GridLines
+  {
+    QRect cells;
+
+    /// Zoom the lines were built for.
+    double scale = 0.0;
+
+    std::vector<QLineF> lines;
+  };
+
+  /// Draws all cached lines of the grid level in one call.
+  /**
+   * The lines cover the viewport and a margin of half its size on each side,
+   * they are rebuilt when `rect` leaves them or the zoom changes. The level
+   * is skipped when its lines would be closer than `minGridSpacing()`.
+   */
+  void
+  drawGrid(QPainter *     painter,
+           QRectF const & rect,
+           double const   gridStep,
+           GridLines &    grid);
+
+  /// Reports a changed visible part of the scene to the BasicGraphicsScene.
+  /**
+   * Called where scrolling, zooming and resizing happen rather than on paint,
+   * so the repositioned connections and embedded widgets are painted in the
+   * same frame.
+   */
+  void
+  updateVisibleSceneRect();
+
+  /// Selects the nodes under the rubber band and the connections between them.
+  /**
+   * Only the nodes entering or leaving the band since the previous mouse move
+   * change their selection, the candidates come from
+   * `BasicGraphicsScene::nodesInRect()`. A node is inside once the band
+   * touches its rect, the margin of the bounding rect does not count.
+   */
+  void
+  updateRubberBandSelection(QPoint const viewPos);
+
 private:
   QAction* _clearSelectionAction;
   QAction* _deleteSelectionAction;
+  QAction* _copySelectionAction;
+  QAction* _cutSelectionAction;
+  QAction* _pasteAction;
+  QAction* _duplicateSelectionAction;
 
   QPointF _clickPos;
+
+  QRubberBand * _rubberBand;
+
+  /// Pixels, see `setMinGridSpacing()`.
+  double _minGridSpacing;
+
+  QPoint _rubberBandOrigin;
+
+  /// Objects inside the rubber band, `true` if the band has selected them.
+  std::unordered_map<NodeId, bool> _rubberBandNodes;
+
+  std::unordered_map<ConnectionId, bool> _rubberBandConnections;
+
+  /// Last visible part of the scene reported to the BasicGraphicsScene.
+  QRectF _visibleSceneRect;
+
+  GridLines _fineGrid;
+
+  GridLines _coarseGrid;
 };
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <utility>
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
@@ -10,14 +13,110 @@
 namespace QtNodes
 {
 
+/// Compact integer standing for an interned `NodeDataType::id`.
+using NodeDataTypeHandle = unsigned int;
+
+static constexpr NodeDataTypeHandle InvalidNodeDataTypeHandle =
+  std::numeric_limits<NodeDataTypeHandle>::max();
+
+/**
+ * Process-wide table interning data type ids.
+ *
+ * Equal id strings always get the same handle, so two data types are
+ * compatible when their handles are equal. The table only grows and is safe
+ * to use from several threads. Lookups of ids a thread has already seen do
+ * not lock.
+ */
+class NODE_EDITOR_PUBLIC NodeDataTypeRegistry
+{
+public:
+  /// Returns the handle for `typeId`, registering it when seen the first time.
+  static
+  NodeDataTypeHandle
+  intern(QString const & typeId);
+
+  /// Returns the id string registered for `handle`.
+  static
+  QString
+  typeId(NodeDataTypeHandle const handle);
+};
+
 /**
  * `id` represents an internal unique data type for the given port.
  * `name` is a normal text description.
  */
 struct NODE_EDITOR_PUBLIC NodeDataType
 {
+  NodeDataType() = default;
+
+  /// Does not touch the registry, `id` is interned by the first `handle()`.
+  NodeDataType(QString id, QString name)
+    : id(std::move(id))
+    , name(std::move(name))
+  {}
+
+  NodeDataType(NodeDataType const & other)
+    : id(other.id)
+    , name(other.name)
+    , _handle(other._handle.load(std::memory_order_relaxed))
+  {}
+
+  NodeDataType(NodeDataType && other) noexcept
+    : id(std::move(other.id))
+    , name(std::move(other.name))
+    , _handle(other._handle.exchange(InvalidNodeDataTypeHandle,
+                                     std::memory_order_relaxed))
+  {}
+
+  NodeDataType &
+  operator=(NodeDataType const & other)
+  {
+    id   = other.id;
+    name = other.name;
+    _handle.store(other._handle.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+
+    return *this;
+  }
+
+  NodeDataType &
+  operator=(NodeDataType && other) noexcept
+  {
+    id   = std::move(other.id);
+    name = std::move(other.name);
+    _handle.store(other._handle.exchange(InvalidNodeDataTypeHandle,
+                                         std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+
+    return *this;
+  }
+
   QString id;
   QString name;
+
+  /**
+   * Returns the interned `id`. The handle is looked up once and stored, and
+   * copies made afterwards share it, so assign a whole new NodeDataType
+   * instead of changing `id` of an existing one.
+   */
+  NodeDataTypeHandle
+  handle() const
+  {
+    NodeDataTypeHandle h = _handle.load(std::memory_order_relaxed);
+
+    if (h == InvalidNodeDataTypeHandle)
+    {
+      h = NodeDataTypeRegistry::intern(id);
+
+      _handle.store(h, std::memory_order_relaxed);
+    }
+
+    return h;
+  }
+
+private:
+  /// Atomic so that one shared type may be queried from several threads.
+  mutable std::atomic<NodeDataTypeHandle> _handle{InvalidNodeDataTypeHandle};
 };
 
 /**
@@ -35,6 +134,8 @@ public:
   virtual bool
   sameType(NodeData const &nodeData) const
   {
+    // `type()` usually builds a fresh NodeDataType, comparing the ids spares
+    // interning both of them.
     return (this->type().id == nodeData.type().id);
   }
 
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+
+#include <QtCore/QObject>
+
+#include "Export.hpp"
+#include "NodeData.hpp"
+
+namespace QtNodes
+{
+
+/**
+ * Bounded FIFO of data chunks carried by a streaming connection.
+ *
+ * DataFlowGraphModel creates one channel per connection between two streaming
+ * ports (see `NodeDelegateModel::portStreamCapacity`). The upstream node
+ * pushes chunks with `NodeDelegateModel::pushChunk`, the downstream node pops
+ * them from the channel it received in `NodeDelegateModel::setInChannel`.
+ *
+ * When the channel is full the producer must wait for `spaceAvailable`. A
+ * consumer which cannot forward its results should stop popping, so the
+ * pressure travels upstream and the memory stays bounded by the chunk size
+ * times the total capacity of the chain.
+ *
+ * The channel is not thread-safe and is used from the GUI thread as the rest
+ * of the graph model.
+ */
+class NODE_EDITOR_PUBLIC NodeDataChannel : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit
+  NodeDataChannel(std::size_t capacity, QObject * parent = nullptr);
+
+public:
+  std::size_t
+  capacity() const { return _capacity; }
+
+  std::size_t
+  size() const { return _chunks.size(); }
+
+  bool
+  isEmpty() const { return _chunks.empty(); }
+
+  bool
+  isFull() const { return _chunks.size() >= _capacity; }
+
+  bool
+  isClosed() const { return _closed; }
+
+  /// The producer closed the channel and all the chunks were consumed.
+  bool
+  atEnd() const { return _closed && _chunks.empty(); }
+
+  /// @returns `false` and drops nothing if the channel is full or closed.
+  bool
+  tryPush(std::shared_ptr<NodeData> chunk);
+
+  /// @returns the oldest chunk or `nullptr` if the channel is empty.
+  std::shared_ptr<NodeData>
+  tryPop();
+
+  /// Marks the end of the stream. Already queued chunks stay readable.
+  void
+  close();
+
+  /**
+   * Starts the next stream once the consumer has read the end of the
+   * previous one.
+   * @returns `false` and keeps the channel closed unless `atEnd()`.
+   */
+  bool
+  reopen();
+
+Q_SIGNALS:
+  /// A chunk was pushed into the channel.
+  void
+  chunkAvailable();
+
+  /// A chunk was popped from a full channel or the last chunk of a closed
+  /// one, after which the channel accepts the next stream.
+  void
+  spaceAvailable();
+
+  void
+  closed();
+
+private:
+  std::size_t _capacity;
+
+  bool _closed;
+
+  std::deque<std::shared_ptr<NodeData>> _chunks;
+};
+
+}
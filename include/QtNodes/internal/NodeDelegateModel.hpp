@@ -1,12 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <QtWidgets/QWidget>
 
 #include "Definitions.hpp"
 #include "Export.hpp"
 #include "NodeData.hpp"
+#include "NodeDataChannel.hpp"
 #include "NodeStyle.hpp"
 #include "Serializable.hpp"
 
@@ -94,6 +97,61 @@ public:
   std::shared_ptr<NodeData>
   outData(PortIndex const port) = 0;
 
+public:
+  /**
+   * Streaming ports exchange a sequence of chunks through a NodeDataChannel
+   * instead of a single `outData` snapshot. A non-zero value marks the port
+   * as streaming; for input ports it is also the number of chunks buffered
+   * on the incoming connection. Only streaming ports can be connected to
+   * each other.
+   */
+  virtual
+  unsigned int
+  portStreamCapacity(PortType, PortIndex) const { return 0; }
+
+  /**
+   * Called when a streaming input port gets connected (`channel` is valid)
+   * or disconnected (`channel` is `nullptr`).
+   */
+  virtual
+  void
+  setInChannel(std::shared_ptr<NodeDataChannel> channel,
+               PortIndex const                  portIndex)
+  {
+    Q_UNUSED(channel);
+    Q_UNUSED(portIndex);
+  }
+
+  /**
+   * Sends `chunk` to every connection attached to the streaming output port.
+   * @returns `false` without sending anything if the port is not connected
+   * or any of the channels is full; `streamSpaceAvailable` is emitted once
+   * all of them accept chunks again and when the port gets connected.
+   *
+   * After `closeStream` the chunk starts the next stream on the same
+   * connections. Until every consumer has read the end of the previous
+   * stream the function returns `false` as for a full channel.
+   */
+  bool
+  pushChunk(PortIndex const port, std::shared_ptr<NodeData> chunk);
+
+  /// @returns `true` if `pushChunk` would succeed now.
+  bool
+  canPushChunk(PortIndex const port) const;
+
+  /// Tells the downstream nodes that the current stream is over.
+  void
+  closeStream(PortIndex const port);
+
+  /// Used by DataFlowGraphModel to wire streaming connections.
+  void
+  attachOutChannel(PortIndex const port,
+                   std::shared_ptr<NodeDataChannel> channel);
+
+  void
+  detachOutChannel(PortIndex const port,
+                   std::shared_ptr<NodeDataChannel> const & channel);
+
   /**
    * It is recommented to preform a lazy initialization for the
    * embedded widget and create it inside this function, not in the
@@ -108,6 +166,17 @@ public:
   QWidget *
   embeddedWidget() = 0;
 
+  /**
+   * Size the embedded widget takes once it is created. Scenes embedding
+   * widgets lazily lay out offscreen nodes with it and call
+   * `embeddedWidget()` only when the node becomes visible. With the default
+   * invalid size the widget is created right away to lay out the node, and
+   * only its proxy is embedded lazily.
+   */
+  virtual
+  QSize
+  embeddedWidgetSizeHint() const { return QSize(); }
+
   virtual
   bool
   resizable() const { return false; }
@@ -149,8 +218,17 @@ Q_SIGNALS:
   void
   embeddedWidgetSizeUpdated();
 
+  /// The streaming output port is able to accept a chunk again or got its
+  /// first connection.
+  void
+  streamSpaceAvailable(PortIndex const index);
+
 private:
   NodeStyle _nodeStyle;
+
+  std::unordered_map<PortIndex,
+                     std::vector<std::shared_ptr<NodeDataChannel>>>
+  _outChannels;
 };
 
 } // namespace QtNodes
@@ -32,7 +32,13 @@ public:
   using RegisteredModelsCategoryMap = std::unordered_map<QString, QString>;
   using CategoriesSet = std::set<QString>;
 
-  //using RegisteredTypeConvertersMap = std::map<TypeConverterId, TypeConverter>;
+  /// Turns data of one type into data of another type. Must accept `nullptr`.
+  using TypeConverter =
+    std::function<std::shared_ptr<NodeData>(std::shared_ptr<NodeData>)>;
+
+  /// Packed pair of interned (from, to) data type handles.
+  using TypeConverterId = quint64;
+  using RegisteredTypeConvertersMap = std::unordered_map<TypeConverterId, TypeConverter>;
 
   NodeDelegateModelRegistry() = default;
   ~NodeDelegateModelRegistry() = default;
@@ -97,17 +103,19 @@ public:
   {
     registerModel(std::forward<ModelCreator>(creator), category);
   }
+#endif
 
 
+  /**
+   * Makes output ports of type `from` connectable to input ports of type
+   * `to`. DataFlowGraphModel runs the converter while propagating the data
+   * through such connections, no intermediate node is created. Streaming
+   * ports are not affected, their chunks are never converted.
+   */
   void
-  registerTypeConverter(TypeConverterId const& id,
-                        TypeConverter          typeConverter)
-  {
-    _registeredTypeConverters[id] = std::move(typeConverter);
-  }
-
-
-#endif
+  registerTypeConverter(NodeDataType const& from,
+                        NodeDataType const& to,
+                        TypeConverter       typeConverter);
 
 
   std::unique_ptr<NodeDelegateModel>
@@ -122,11 +130,15 @@ public:
   CategoriesSet const &
   categories() const;
 
-#if 0
+  /// @returns `true` if a converter from `d1` to `d2` was registered.
+  bool
+  hasTypeConverter(NodeDataType const& d1,
+                   NodeDataType const& d2) const;
+
+  /// @returns a registered converter or an empty function.
   TypeConverter
   getTypeConverter(NodeDataType const& d1,
                    NodeDataType const& d2) const;
-#endif
 
 private:
 
@@ -136,12 +148,17 @@ private:
 
   RegisteredModelCreatorsMap _registeredItemCreators;
 
-#if 0
   RegisteredTypeConvertersMap _registeredTypeConverters;
-#endif
 
 private:
 
+  static TypeConverterId
+  typeConverterId(NodeDataType const& d1,
+                  NodeDataType const& d2)
+  {
+    return (static_cast<TypeConverterId>(d1.handle()) << 32) | d2.handle();
+  }
+
   // If the registered ModelType class has the static member method
   // `static QString Name();`, use it. Otherwise use the non-static
   // method: `virtual QString name() const;`
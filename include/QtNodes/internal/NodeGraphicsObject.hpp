@@ -1,6 +1,8 @@
 #pragma once
 
+#include <QtCore/QPointer>
 #include <QtCore/QUuid>
+#include <QtGui/QPixmap>
 #include <QtWidgets/QGraphicsObject>
 
 #include "NodeState.hpp"
@@ -27,7 +29,7 @@ public:
   NodeGraphicsObject(BasicGraphicsScene &scene,
                      NodeId node);
 
-  ~NodeGraphicsObject() override = default;
+  ~NodeGraphicsObject() override;
 
 public:
   AbstractGraphModel &
@@ -63,6 +65,41 @@ public:
   void
   reactToConnection(ConnectionGraphicsObject const * cgo);
 
+  /// Drops everything related to the current node before pooling the object.
+  /**
+   * The embedded widget is destroyed, the shadow effect and the other
+   * node-independent settings are kept for the next `attachToNode`.
+   */
+  void
+  detachFromNode();
+
+  /// @returns `true` if the node widget is currently shown by a proxy.
+  bool
+  widgetEmbedded() const { return _proxyWidget != nullptr; }
+
+  /// Creates the QGraphicsProxyWidget for the node widget if it is missing.
+  /**
+   * With lazy embedding this is where the node widget itself gets created,
+   * until then the node is laid out with `NodeRole::WidgetSize`.
+   */
+  void
+  ensureWidgetEmbedded();
+
+  /// Replaces the proxy widget by a snapshot of the node widget.
+  /**
+   * The widget itself is kept and embedded again by
+   * `ensureWidgetEmbedded()`.
+   */
+  void
+  releaseWidget();
+
+  /// Reinitializes a pooled object for `nodeId`.
+  /**
+   * The object must already be added to a BasicGraphicsScene.
+   */
+  void
+  attachToNode(NodeId const nodeId);
+
 protected:
   void
   paint(QPainter* painter,
@@ -97,9 +134,17 @@ protected:
   contextMenuEvent(QGraphicsSceneContextMenuEvent* event) override;
 
 private:
+  /// Applies the node-specific style, flags, widget and position.
+  void
+  initializeNode();
+
   void
   embedQWidget();
 
+  /// Draws the snapshot or an outline where the released widget was.
+  void
+  drawWidgetPlaceholder(QPainter * painter) const;
+
   void
   setLockedState();
 
@@ -112,5 +157,10 @@ private:
 
   // either nullptr or owned by parent QGraphicsItem
   QGraphicsProxyWidget * _proxyWidget;
+
+  /// Widget taken out of its proxy by `releaseWidget()`.
+  QPointer<QWidget> _releasedWidget;
+
+  QPixmap _widgetSnapshot;
 };
 }
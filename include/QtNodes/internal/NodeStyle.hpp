@@ -10,6 +10,15 @@ namespace QtNodes
 
 class NODE_EDITOR_PUBLIC NodeStyle : public Style
 {
+public:
+  /// How the shadow under the node is produced.
+  enum class ShadowMode
+  {
+    None,    ///< No shadow at all.
+    Effect,  ///< `QGraphicsDropShadowEffect` installed on the node item.
+    Painted, ///< Cached pre-blurred texture drawn by DefaultNodePainter.
+  };
+
 public:
   NodeStyle();
 
@@ -50,5 +59,8 @@ public:
   float ConnectionPointDiameter;
 
   float Opacity;
+
+  /// Stored in JSON as "ShadowMode": "None", "Effect" or "Painted".
+  ShadowMode Shadow = ShadowMode::Effect;
 };
 }
@@ -0,0 +1,655 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace QtNodes
+{
+
+/**
+ * Immutable hash map sharing its structure with the previous versions
+ * (hash array mapped trie).
+ *
+ * The map is a 32-way tree indexed by 5-bit chunks of the key hash. Each
+ * modification copies only the path from the root to the changed entry, so a
+ * copy of the map is O(1) and the copies share all the untouched subtrees.
+ * Two versions of one map are compared in time proportional to the number of
+ * differences, because the identical subtrees are recognized by their
+ * address.
+ *
+ * The tree nodes are never modified after construction, therefore a copy of
+ * the map could be read by any thread while the original is being modified.
+ *
+ * `T` must be copyable and comparable with `operator==`.
+ */
+template<typename Key,
+         typename T,
+         typename Hash     = std::hash<Key>,
+         typename KeyEqual = std::equal_to<Key>>
+class PersistentHashMap
+{
+public:
+  using key_type    = Key;
+  using mapped_type = T;
+  using value_type  = std::pair<Key, T>;
+
+public:
+  std::size_t
+  size() const { return _size; }
+
+  bool
+  empty() const { return _size == 0; }
+
+  /// @returns `nullptr` if the key is absent.
+  T const *
+  find(Key const & key) const
+  {
+    std::size_t const hash = Hash()(key);
+
+    Node const * node = _root.get();
+
+    for (unsigned shift = 0; node; shift += BitsPerLevel)
+    {
+      if (shift >= HashBits)
+      {
+        for (auto const & entry : node->entries)
+        {
+          if (KeyEqual()(entry.first, key))
+            return &entry.second;
+        }
+
+        return nullptr;
+      }
+
+      std::uint32_t const bit = slotBit(hash, shift);
+
+      if (node->entryMap & bit)
+      {
+        value_type const & entry = node->entries[index(node->entryMap, bit)];
+
+        return KeyEqual()(entry.first, key) ? &entry.second : nullptr;
+      }
+
+      if (!(node->childMap & bit))
+        return nullptr;
+
+      node = node->children[index(node->childMap, bit)].get();
+    }
+
+    return nullptr;
+  }
+
+  bool
+  contains(Key const & key) const { return find(key) != nullptr; }
+
+  /// Inserts the value or replaces the one stored for the key.
+  void
+  insert(Key const & key, T value)
+  {
+    bool added = false;
+
+    _root = insert(_root, 0, Hash()(key), key, std::move(value), added);
+
+    if (added)
+      ++_size;
+  }
+
+  /// @returns `true` if the key was present.
+  bool
+  erase(Key const & key)
+  {
+    bool removed = false;
+
+    _root = erase(_root, 0, Hash()(key), key, removed);
+
+    if (removed)
+      --_size;
+
+    return removed;
+  }
+
+  void
+  clear()
+  {
+    _root.reset();
+    _size = 0;
+  }
+
+  /// Calls `f(key, value)` for every entry in an unspecified order.
+  template<typename F>
+  void
+  forEach(F && f) const
+  {
+    forEach(_root.get(), f);
+  }
+
+  /// @returns `true` if both maps are the same version, no entry comparison.
+  bool
+  isSharedWith(PersistentHashMap const & other) const
+  {
+    return _root == other._root;
+  }
+
+  /**
+   * Reports the differences of this map from an `older` version.
+   *
+   * `added(key, value)` and `removed(key, value)` are called for the keys
+   * present in only one of the maps, `changed(key, oldValue, newValue)` for
+   * the keys whose values differ. Subtrees shared by both maps are skipped.
+   */
+  template<typename Added, typename Removed, typename Changed>
+  void
+  diff(PersistentHashMap const & older,
+       Added &&                  added,
+       Removed &&                removed,
+       Changed &&                changed) const
+  {
+    diff(older._root.get(), _root.get(), 0, added, removed, changed);
+  }
+
+private:
+  static constexpr unsigned BitsPerLevel = 5;
+
+  static constexpr unsigned HashBits = sizeof(std::size_t) * 8;
+
+  /**
+   * Inner node of the trie.
+   *
+   * A slot holds either an entry or a subtree, the maps tell which one. The
+   * vectors keep only the occupied slots in slot order. Below the last hash
+   * level a node lists the entries with fully equal hashes and the maps are
+   * unused.
+   */
+  struct Node
+  {
+    std::uint32_t entryMap = 0;
+    std::uint32_t childMap = 0;
+
+    std::vector<value_type> entries;
+
+    std::vector<std::shared_ptr<Node const>> children;
+  };
+
+  using NodePtr = std::shared_ptr<Node const>;
+
+private:
+  static
+  unsigned
+  popCount(std::uint32_t x)
+  {
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+
+    return (x * 0x01010101u) >> 24;
+  }
+
+  static
+  std::uint32_t
+  slotBit(std::size_t const hash, unsigned const shift)
+  {
+    return std::uint32_t(1) << ((hash >> shift) & 0x1F);
+  }
+
+  /// Position of the slot in the packed vector.
+  static
+  std::size_t
+  index(std::uint32_t const map, std::uint32_t const bit)
+  {
+    return popCount(map & (bit - 1));
+  }
+
+  /// Builds the smallest subtree holding two entries with different keys.
+  static
+  NodePtr
+  makePair(value_type first, std::size_t const firstHash,
+           value_type second, std::size_t const secondHash,
+           unsigned const shift)
+  {
+    auto node = std::make_shared<Node>();
+
+    if (shift >= HashBits)
+    {
+      node->entries.push_back(std::move(first));
+      node->entries.push_back(std::move(second));
+
+      return node;
+    }
+
+    std::uint32_t const firstBit  = slotBit(firstHash, shift);
+    std::uint32_t const secondBit = slotBit(secondHash, shift);
+
+    if (firstBit == secondBit)
+    {
+      node->childMap = firstBit;
+      node->children.push_back(makePair(std::move(first), firstHash,
+                                        std::move(second), secondHash,
+                                        shift + BitsPerLevel));
+    }
+    else
+    {
+      node->entryMap = firstBit | secondBit;
+
+      if (firstBit < secondBit)
+      {
+        node->entries.push_back(std::move(first));
+        node->entries.push_back(std::move(second));
+      }
+      else
+      {
+        node->entries.push_back(std::move(second));
+        node->entries.push_back(std::move(first));
+      }
+    }
+
+    return node;
+  }
+
+  static
+  NodePtr
+  insert(NodePtr const &    node,
+         unsigned const     shift,
+         std::size_t const  hash,
+         Key const &        key,
+         T &&               value,
+         bool &             added)
+  {
+    if (!node)
+    {
+      auto leaf = std::make_shared<Node>();
+
+      if (shift < HashBits)
+        leaf->entryMap = slotBit(hash, shift);
+
+      leaf->entries.emplace_back(key, std::move(value));
+
+      added = true;
+
+      return leaf;
+    }
+
+    if (shift >= HashBits)
+    {
+      for (std::size_t i = 0; i < node->entries.size(); ++i)
+      {
+        if (KeyEqual()(node->entries[i].first, key))
+        {
+          if (node->entries[i].second == value)
+            return node;
+
+          auto copy = std::make_shared<Node>(*node);
+          copy->entries[i].second = std::move(value);
+
+          return copy;
+        }
+      }
+
+      auto copy = std::make_shared<Node>(*node);
+      copy->entries.emplace_back(key, std::move(value));
+
+      added = true;
+
+      return copy;
+    }
+
+    std::uint32_t const bit = slotBit(hash, shift);
+
+    if (node->entryMap & bit)
+    {
+      std::size_t const i = index(node->entryMap, bit);
+
+      value_type const & entry = node->entries[i];
+
+      if (KeyEqual()(entry.first, key))
+      {
+        // Unchanged values keep the version, so equal maps stay shared.
+        if (entry.second == value)
+          return node;
+
+        auto copy = std::make_shared<Node>(*node);
+        copy->entries[i].second = std::move(value);
+
+        return copy;
+      }
+
+      auto copy = std::make_shared<Node>(*node);
+
+      NodePtr child = makePair(entry, Hash()(entry.first),
+                               value_type(key, std::move(value)), hash,
+                               shift + BitsPerLevel);
+
+      copy->entries.erase(copy->entries.begin() + i);
+      copy->entryMap &= ~bit;
+
+      copy->children.insert(copy->children.begin() + index(copy->childMap, bit),
+                            std::move(child));
+      copy->childMap |= bit;
+
+      added = true;
+
+      return copy;
+    }
+
+    if (node->childMap & bit)
+    {
+      std::size_t const i = index(node->childMap, bit);
+
+      NodePtr child = insert(node->children[i], shift + BitsPerLevel,
+                             hash, key, std::move(value), added);
+
+      if (child == node->children[i])
+        return node;
+
+      auto copy = std::make_shared<Node>(*node);
+      copy->children[i] = std::move(child);
+
+      return copy;
+    }
+
+    auto copy = std::make_shared<Node>(*node);
+
+    copy->entries.emplace(copy->entries.begin() + index(node->entryMap, bit),
+                          key, std::move(value));
+    copy->entryMap |= bit;
+
+    added = true;
+
+    return copy;
+  }
+
+  static
+  NodePtr
+  erase(NodePtr const &   node,
+        unsigned const    shift,
+        std::size_t const hash,
+        Key const &       key,
+        bool &            removed)
+  {
+    if (!node)
+      return node;
+
+    if (shift >= HashBits)
+    {
+      for (std::size_t i = 0; i < node->entries.size(); ++i)
+      {
+        if (KeyEqual()(node->entries[i].first, key))
+        {
+          removed = true;
+
+          if (node->entries.size() == 1)
+            return nullptr;
+
+          auto copy = std::make_shared<Node>(*node);
+          copy->entries.erase(copy->entries.begin() + i);
+
+          return copy;
+        }
+      }
+
+      return node;
+    }
+
+    std::uint32_t const bit = slotBit(hash, shift);
+
+    if (node->entryMap & bit)
+    {
+      std::size_t const i = index(node->entryMap, bit);
+
+      if (!KeyEqual()(node->entries[i].first, key))
+        return node;
+
+      removed = true;
+
+      if (node->entries.size() == 1 && node->children.empty())
+        return nullptr;
+
+      auto copy = std::make_shared<Node>(*node);
+      copy->entries.erase(copy->entries.begin() + i);
+      copy->entryMap &= ~bit;
+
+      return copy;
+    }
+
+    if (node->childMap & bit)
+    {
+      std::size_t const i = index(node->childMap, bit);
+
+      NodePtr child = erase(node->children[i], shift + BitsPerLevel,
+                            hash, key, removed);
+
+      if (child == node->children[i])
+        return node;
+
+      auto copy = std::make_shared<Node>(*node);
+
+      if (!child)
+      {
+        copy->children.erase(copy->children.begin() + i);
+        copy->childMap &= ~bit;
+
+        if (copy->entries.empty() && copy->children.empty())
+          return nullptr;
+      }
+      else if (child->entries.size() == 1 && child->children.empty())
+      {
+        // A subtree with a single entry is folded back into the slot.
+        copy->children.erase(copy->children.begin() + i);
+        copy->childMap &= ~bit;
+
+        copy->entries.insert(copy->entries.begin() + index(copy->entryMap, bit),
+                             child->entries.front());
+        copy->entryMap |= bit;
+      }
+      else
+      {
+        copy->children[i] = std::move(child);
+      }
+
+      return copy;
+    }
+
+    return node;
+  }
+
+  template<typename F>
+  static
+  void
+  forEach(Node const * node, F & f)
+  {
+    if (!node)
+      return;
+
+    for (auto const & entry : node->entries)
+      f(entry.first, entry.second);
+
+    for (auto const & child : node->children)
+      forEach(child.get(), f);
+  }
+
+  /// Looks for the key in the subtree without knowing its depth.
+  static
+  T const *
+  findInSubtree(Node const * node, Key const & key)
+  {
+    if (!node)
+      return nullptr;
+
+    for (auto const & entry : node->entries)
+    {
+      if (KeyEqual()(entry.first, key))
+        return &entry.second;
+    }
+
+    for (auto const & child : node->children)
+    {
+      if (T const * value = findInSubtree(child.get(), key))
+        return value;
+    }
+
+    return nullptr;
+  }
+
+  /// Compares a single entry of one version with a subtree of the other.
+  template<typename Added, typename Removed, typename Changed>
+  static
+  void
+  diffEntry(value_type const * olderEntry,
+            Node const *       olderNode,
+            value_type const * newerEntry,
+            Node const *       newerNode,
+            Added &            added,
+            Removed &          removed,
+            Changed &          changed)
+  {
+    if (olderEntry)
+    {
+      T const * newerValue = findInSubtree(newerNode, olderEntry->first);
+
+      auto reportNewer =
+        [&](Key const & key, T const & value)
+        {
+          if (!KeyEqual()(key, olderEntry->first))
+            added(key, value);
+        };
+      forEach(newerNode, reportNewer);
+
+      if (!newerValue)
+        removed(olderEntry->first, olderEntry->second);
+      else if (!(*newerValue == olderEntry->second))
+        changed(olderEntry->first, olderEntry->second, *newerValue);
+    }
+    else
+    {
+      T const * olderValue = findInSubtree(olderNode, newerEntry->first);
+
+      auto reportOlder =
+        [&](Key const & key, T const & value)
+        {
+          if (!KeyEqual()(key, newerEntry->first))
+            removed(key, value);
+        };
+      forEach(olderNode, reportOlder);
+
+      if (!olderValue)
+        added(newerEntry->first, newerEntry->second);
+      else if (!(*olderValue == newerEntry->second))
+        changed(newerEntry->first, *olderValue, newerEntry->second);
+    }
+  }
+
+  template<typename Added, typename Removed, typename Changed>
+  static
+  void
+  diff(Node const *   older,
+       Node const *   newer,
+       unsigned const shift,
+       Added &        added,
+       Removed &      removed,
+       Changed &      changed)
+  {
+    if (older == newer)
+      return;
+
+    if (!older)
+    {
+      forEach(newer, added);
+      return;
+    }
+
+    if (!newer)
+    {
+      forEach(older, removed);
+      return;
+    }
+
+    if (shift >= HashBits)
+    {
+      for (auto const & entry : newer->entries)
+      {
+        T const * olderValue = findInSubtree(older, entry.first);
+
+        if (!olderValue)
+          added(entry.first, entry.second);
+        else if (!(*olderValue == entry.second))
+          changed(entry.first, *olderValue, entry.second);
+      }
+
+      for (auto const & entry : older->entries)
+      {
+        if (!findInSubtree(newer, entry.first))
+          removed(entry.first, entry.second);
+      }
+
+      return;
+    }
+
+    std::uint32_t const slots = older->entryMap | older->childMap |
+                                newer->entryMap | newer->childMap;
+
+    for (unsigned slot = 0; slot < 32; ++slot)
+    {
+      std::uint32_t const bit = std::uint32_t(1) << slot;
+
+      if (!(slots & bit))
+        continue;
+
+      value_type const * olderEntry =
+        (older->entryMap & bit) ? &older->entries[index(older->entryMap, bit)] : nullptr;
+      value_type const * newerEntry =
+        (newer->entryMap & bit) ? &newer->entries[index(newer->entryMap, bit)] : nullptr;
+
+      Node const * olderChild =
+        (older->childMap & bit) ? older->children[index(older->childMap, bit)].get() : nullptr;
+      Node const * newerChild =
+        (newer->childMap & bit) ? newer->children[index(newer->childMap, bit)].get() : nullptr;
+
+      if (olderEntry && newerEntry)
+      {
+        if (KeyEqual()(olderEntry->first, newerEntry->first))
+        {
+          if (!(olderEntry->second == newerEntry->second))
+            changed(newerEntry->first, olderEntry->second, newerEntry->second);
+        }
+        else
+        {
+          removed(olderEntry->first, olderEntry->second);
+          added(newerEntry->first, newerEntry->second);
+        }
+      }
+      else if (olderEntry && newerChild)
+      {
+        diffEntry(olderEntry, nullptr, nullptr, newerChild,
+                  added, removed, changed);
+      }
+      else if (olderChild && newerEntry)
+      {
+        diffEntry(nullptr, olderChild, newerEntry, nullptr,
+                  added, removed, changed);
+      }
+      else if (olderEntry)
+      {
+        removed(olderEntry->first, olderEntry->second);
+      }
+      else if (newerEntry)
+      {
+        added(newerEntry->first, newerEntry->second);
+      }
+      else
+      {
+        diff(olderChild, newerChild, shift + BitsPerLevel,
+             added, removed, changed);
+      }
+    }
+  }
+
+private:
+  NodePtr _root;
+
+  std::size_t _size = 0;
+};
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace QtNodes
+{
+
+/**
+ * Vector of trivially copyable values storing the first `N` values inline.
+ *
+ * Meant for short sequences that are usually one or two values long, such as
+ * the connections of a node. No allocation happens until the sequence grows
+ * beyond `N`; the heap buffer is released again once it shrinks back.
+ */
+template<typename T, std::size_t N>
+class SmallVector
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SmallVector stores trivially copyable values only");
+
+public:
+  using iterator       = T *;
+  using const_iterator = T const *;
+
+public:
+  std::size_t
+  size() const { return _heap.empty() ? _inlineSize : _heap.size(); }
+
+  bool
+  empty() const { return size() == 0; }
+
+  T *
+  data() { return _heap.empty() ? _inline.data() : _heap.data(); }
+
+  T const *
+  data() const { return _heap.empty() ? _inline.data() : _heap.data(); }
+
+  iterator
+  begin() { return data(); }
+
+  iterator
+  end() { return data() + size(); }
+
+  const_iterator
+  begin() const { return data(); }
+
+  const_iterator
+  end() const { return data() + size(); }
+
+  T &
+  operator[](std::size_t const i) { return data()[i]; }
+
+  T const &
+  operator[](std::size_t const i) const { return data()[i]; }
+
+  /// @returns iterator to the inserted value.
+  iterator
+  insert(const_iterator const position, T const & value)
+  {
+    std::size_t const index = static_cast<std::size_t>(position - begin());
+
+    if (_heap.empty() && _inlineSize < N)
+    {
+      std::copy_backward(_inline.begin() + index,
+                         _inline.begin() + _inlineSize,
+                         _inline.begin() + _inlineSize + 1);
+
+      _inline[index] = value;
+      ++_inlineSize;
+
+      return _inline.data() + index;
+    }
+
+    if (_heap.empty())
+    {
+      _heap.reserve(2 * N);
+      _heap.assign(_inline.begin(), _inline.begin() + _inlineSize);
+      _inlineSize = 0;
+    }
+
+    _heap.insert(_heap.begin() + index, value);
+
+    return _heap.data() + index;
+  }
+
+  void
+  push_back(T const & value) { insert(end(), value); }
+
+  /// @returns iterator to the value following the erased one.
+  iterator
+  erase(const_iterator const position)
+  {
+    std::size_t const index = static_cast<std::size_t>(position - begin());
+
+    if (_heap.empty())
+    {
+      std::copy(_inline.begin() + index + 1,
+                _inline.begin() + _inlineSize,
+                _inline.begin() + index);
+      --_inlineSize;
+
+      return _inline.data() + index;
+    }
+
+    _heap.erase(_heap.begin() + index);
+
+    if (_heap.size() <= N)
+    {
+      _inlineSize = _heap.size();
+      std::copy(_heap.begin(), _heap.end(), _inline.begin());
+
+      std::vector<T>().swap(_heap);
+
+      return _inline.data() + index;
+    }
+
+    return _heap.data() + index;
+  }
+
+  void
+  clear()
+  {
+    _inlineSize = 0;
+    std::vector<T>().swap(_heap);
+  }
+
+private:
+  std::array<T, N> _inline;
+
+  std::size_t _inlineSize = 0;
+
+  /// Holds all the values once there are more than `N` of them.
+  std::vector<T> _heap;
+};
+
+}
@@ -2,10 +2,46 @@
 
 #include <QtNodes/ConnectionIdUtils>
 
+#include <algorithm>
+
 
 namespace QtNodes
 {
 
+NodeId
+AbstractGraphModel::
+newNodeId() const
+{
+  NodeId maxNodeId = 0;
+  bool empty = true;
+
+  for (NodeId const nodeId : allNodeIds())
+  {
+    maxNodeId = std::max(maxNodeId, nodeId);
+    empty = false;
+  }
+
+  return empty ? 0 : maxNodeId + 1;
+}
+
+
+void
+AbstractGraphModel::
+loadNodes(std::vector<QJsonObject> const &  nodesJson,
+          std::vector<ConnectionId> const & connectionIds)
+{
+  for (QJsonObject const & nodeJson : nodesJson)
+  {
+    loadNode(nodeJson);
+  }
+
+  for (ConnectionId const & connectionId : connectionIds)
+  {
+    addConnection(connectionId);
+  }
+}
+
+
 void
 AbstractGraphModel::
 portsAboutToBeDeleted(NodeId const    nodeId,
@@ -4,6 +4,7 @@
 #include "StyleCollection.hpp"
 
 #include <QMargins>
+#include <QWidget>
 
 #include <cmath>
 
@@ -37,6 +38,34 @@ boundingRect(NodeId const nodeId) const
 }
 
 
+QSize
+AbstractNodeGeometry::
+widgetSize(NodeId const nodeId) const
+{
+  QVariant const size = _graphModel.nodeData(nodeId, NodeRole::WidgetSize);
+
+  if (size.isValid())
+    return size.toSize();
+
+  if (auto w = _graphModel.nodeData<QWidget*>(nodeId, NodeRole::Widget))
+    return w->size();
+
+  return QSize();
+}
+
+
+QWidget *
+AbstractNodeGeometry::
+createdWidget(NodeId const nodeId) const
+{
+  // The model answers with a size hint only until the widget is created.
+  if (_graphModel.nodeData(nodeId, NodeRole::WidgetSize).isValid())
+    return nullptr;
+
+  return _graphModel.nodeData<QWidget*>(nodeId, NodeRole::Widget);
+}
+
+
 QPointF
 AbstractNodeGeometry::
 portScenePosition(NodeId const nodeId,
@@ -0,0 +1,151 @@
+#include "AutosaveService.hpp"
+
+#include "DataFlowGraphModel.hpp"
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMetaObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimer>
+
+
+namespace QtNodes
+{
+
+AutosaveService::
+AutosaveService(DataFlowGraphModel & graphModel,
+                QObject *            parent)
+  : QObject(parent)
+  , _graphModel(graphModel)
+  , _timer(new QTimer(this))
+  , _saving(false)
+{
+  _timer->setInterval(60 * 1000);
+
+  connect(_timer, &QTimer::timeout, this, &AutosaveService::saveNow);
+
+  _threadPool.setMaxThreadCount(1);
+}
+
+
+AutosaveService::
+~AutosaveService()
+{
+  // The finished task posts its result to this object, the queued call is
+  // discarded together with the object.
+  _threadPool.waitForDone();
+}
+
+
+void
+AutosaveService::
+setFilePath(QString const & filePath)
+{
+  _filePath = filePath;
+}
+
+
+void
+AutosaveService::
+setInterval(int const msec)
+{
+  _timer->setInterval(msec);
+}
+
+
+int
+AutosaveService::
+interval() const
+{
+  return _timer->interval();
+}
+
+
+bool
+AutosaveService::
+isActive() const
+{
+  return _timer->isActive();
+}
+
+
+void
+AutosaveService::
+start()
+{
+  _timer->start();
+}
+
+
+void
+AutosaveService::
+stop()
+{
+  _timer->stop();
+}
+
+
+void
+AutosaveService::
+saveNow()
+{
+  if (_saving || _filePath.isEmpty())
+    return;
+
+  GraphSnapshot snapshot = _graphModel.snapshot();
+
+  if (_filePath == _savedFilePath && snapshot.isIdenticalTo(_savedSnapshot))
+    return;
+
+  _saving = true;
+
+  QString const filePath = _filePath;
+
+  _threadPool.start(QRunnable::create(
+    [this, snapshot, filePath]()
+    {
+      QString errorString;
+
+      QSaveFile file(filePath);
+
+      if (file.open(QIODevice::WriteOnly))
+      {
+        file.write(QJsonDocument(snapshot.toJson()).toJson());
+
+        if (!file.commit())
+          errorString = file.errorString();
+      }
+      else
+      {
+        errorString = file.errorString();
+      }
+
+      QMetaObject::invokeMethod(this,
+                                [this, snapshot, filePath, errorString]()
+                                { onSaveFinished(snapshot, filePath, errorString); },
+                                Qt::QueuedConnection);
+    }));
+}
+
+
+void
+AutosaveService::
+onSaveFinished(GraphSnapshot const & snapshot,
+               QString const &       filePath,
+               QString const &       errorString)
+{
+  _saving = false;
+
+  if (!errorString.isEmpty())
+  {
+    Q_EMIT saveFailed(filePath, errorString);
+    return;
+  }
+
+  _savedSnapshot = snapshot;
+  _savedFilePath = filePath;
+
+  Q_EMIT saved(filePath);
+}
+
+}
@@ -3,11 +3,16 @@
 #include "AbstractNodeGeometry.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "ConnectionLayer.hpp"
 #include "DefaultHorizontalNodeGeometry.hpp"
 #include "DefaultNodePainter.hpp"
 #include "DefaultVerticalNodeGeometry.hpp"
 #include "GraphicsView.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "NodeSpatialIndex.hpp"
+#include "StyleCollection.hpp"
+#include "UndoCommands.hpp"
+#include "UndoMemoryBudget.hpp"
 
 #include <QUndoStack>
 
@@ -21,8 +26,10 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QTimer>
 #include <QtCore/QtGlobal>
 
+#include <algorithm>
 #include <queue>
 #include <iostream>
 #include <stdexcept>
@@ -30,6 +37,32 @@
 #include <utility>
 
 
+namespace
+{
+
+/// Number of idle node and connection objects kept for reuse by default.
+std::size_t const defaultGraphicsObjectPoolLimit = 256;
+
+/// Delay after the last view change before widgets are embedded, ms.
+int const widgetEmbeddingDelay = 50;
+
+/// Time an offscreen node keeps its proxy widget, ms.
+int const widgetReleaseDelay = 3000;
+
+/// Default time between two repositionings of moved connections, ms.
+int const connectionUpdateDelay = 16;
+
+
+std::uint64_t
+portAnchorKey(QtNodes::NodeId const nodeId, QtNodes::PortType const portType)
+{
+  return (static_cast<std::uint64_t>(nodeId) << 1) |
+         (portType == QtNodes::PortType::Out ? 1u : 0u);
+}
+
+}
+
+
 namespace QtNodes
 {
 
@@ -38,13 +71,45 @@ BasicGraphicsScene(AbstractGraphModel &graphModel,
                    QObject *   parent)
   : QGraphicsScene(parent)
   , _graphModel(graphModel)
+  , _graphicsObjectPoolLimit(defaultGraphicsObjectPoolLimit)
   , _nodeGeometry(std::make_unique<DefaultHorizontalNodeGeometry>(_graphModel))
   , _nodePainter(std::make_unique<DefaultNodePainter>())
   , _undoStack(new QUndoStack(this))
+  , _undoCompressionDepth(8)
+  , _lastUndoIndex(0)
+  , _undoMemory(std::make_unique<UndoMemoryBudget>(*_undoStack))
   , _orientation(Qt::Horizontal)
+  , _lazyWidgetEmbedding(false)
+  , _widgetEmbeddingTimer(new QTimer(this))
+  , _batchInsertionDepth(0)
+  , _connectionUpdateInterval(connectionUpdateDelay)
+  , _connectionUpdateTimer(new QTimer(this))
+  , _topNodeId(InvalidNodeId)
+  , _nodeIndex(std::make_unique<NodeSpatialIndex>())
+  , _portSnapRadius(2.0 * StyleCollection::nodeStyle().ConnectionPointDiameter)
+  , _connectionCulling(false)
+  , _visibleSceneRectValid(false)
 {
   setItemIndexMethod(QGraphicsScene::NoIndex);
 
+  _widgetEmbeddingTimer->setSingleShot(true);
+
+  connect(_widgetEmbeddingTimer, &QTimer::timeout,
+          this, &BasicGraphicsScene::updateWidgetEmbedding);
+
+  _connectionUpdateTimer->setSingleShot(true);
+
+  connect(_connectionUpdateTimer, &QTimer::timeout,
+          this, &BasicGraphicsScene::flushConnectionUpdates);
+
+  _widgetEmbeddingClock.start();
+
+  connect(_undoStack, &QUndoStack::indexChanged,
+          this, &BasicGraphicsScene::compressUndoHistory);
+
+  connect(_undoStack, &QUndoStack::indexChanged,
+          this, [this]() { _undoMemory->enforce(); });
+
 
   connect(&_graphModel, &AbstractGraphModel::connectionCreated,
           this, &BasicGraphicsScene::onConnectionCreated);
@@ -72,7 +137,15 @@ BasicGraphicsScene(AbstractGraphModel &graphModel,
 
 
 BasicGraphicsScene::
-~BasicGraphicsScene() = default;
+~BasicGraphicsScene()
+{
+  // The commands report their memory to _undoMemory when they are
+  // destroyed, so the stack goes first.
+  delete _undoStack;
+  _undoStack = nullptr;
+
+  detachAllGraphicsObjects();
+}
 
 
 AbstractGraphModel const &
@@ -123,6 +196,83 @@ undoStack()
 }
 
 
+void
+BasicGraphicsScene::
+setUndoCompressionDepth(int const depth)
+{
+  _undoCompressionDepth = depth;
+
+  // The whole history may now be older than the depth, not only the
+  // commands behind the last index.
+  _lastUndoIndex = 0;
+
+  compressUndoHistory(_undoStack->index());
+}
+
+
+std::size_t
+BasicGraphicsScene::
+undoStackMemoryUsage() const
+{
+  return _undoMemory->usage();
+}
+
+
+void
+BasicGraphicsScene::
+setUndoMemoryBudget(std::size_t const bytes)
+{
+  _undoMemory->setBudget(bytes);
+}
+
+
+std::size_t
+BasicGraphicsScene::
+undoMemoryBudget() const
+{
+  return _undoMemory->budget();
+}
+
+
+BasicGraphicsScene::UndoMemoryStatistics
+BasicGraphicsScene::
+undoMemoryStatistics() const
+{
+  return _undoMemory->statistics();
+}
+
+
+void
+BasicGraphicsScene::
+compressUndoHistory(int const index)
+{
+  int const previousIndex = _lastUndoIndex;
+
+  _lastUndoIndex = index;
+
+  if (_undoCompressionDepth < 0)
+    return;
+
+  // With an undo limit the stack drops its first command on push and the
+  // index stays the same, so the command right behind the depth is always
+  // visited as well.
+  int const first =
+    std::max(0, std::min(previousIndex, index) - _undoCompressionDepth - 1);
+
+  int const last = std::min(index - _undoCompressionDepth,
+                            _undoStack->count());
+
+  for (int i = first; i < last; ++i)
+  {
+    // The stack only gives const access to the commands it owns.
+    auto command = const_cast<QUndoCommand*>(_undoStack->command(i));
+
+    if (auto undoCommand = dynamic_cast<UndoCommand*>(command))
+      undoCommand->compress();
+  }
+}
+
+
 std::unique_ptr<ConnectionGraphicsObject> const &
 BasicGraphicsScene::
 makeDraftConnection(ConnectionId const incompleteConnectionId)
@@ -149,6 +299,14 @@ void
 BasicGraphicsScene::
 clearScene()
 {
+  bool const batched = batchedConnectionPainting();
+
+  // The model deletes the nodes one by one, the graphics objects are
+  // removed in advance in one pass.
+  detachAllGraphicsObjects();
+
+  setBatchedConnectionPainting(batched);
+
   auto const &allNodeIds =
     graphModel().allNodeIds();
 
@@ -189,6 +347,65 @@ connectionGraphicsObject(ConnectionId connectionId)
 }
 
 
+void
+BasicGraphicsScene::
+beginBatchInsertion()
+{
+  ++_batchInsertionDepth;
+}
+
+
+void
+BasicGraphicsScene::
+endBatchInsertion()
+{
+  if (_batchInsertionDepth == 0 || --_batchInsertionDepth > 0)
+    return;
+
+  std::vector<NodeId> nodeIds;
+  std::vector<ConnectionId> connectionIds;
+
+  std::swap(nodeIds, _batchedNodes);
+  std::swap(connectionIds, _batchedConnections);
+
+  // Some of the items could be deleted again before the end of the batch.
+  for (NodeId const nodeId : nodeIds)
+  {
+    if (!_graphModel.nodeExists(nodeId) || _nodeGraphicsObjects.count(nodeId) > 0)
+      continue;
+
+    _nodeGraphicsObjects[nodeId] = acquireNodeGraphicsObject(nodeId);
+  }
+
+  std::unordered_set<NodeId> attachedNodes;
+
+  for (auto const & connectionId : connectionIds)
+  {
+    if (!_graphModel.connectionExists(connectionId) ||
+        _connectionGraphicsObjects.count(connectionId) > 0)
+      continue;
+
+    auto cgo = acquireConnectionGraphicsObject(connectionId);
+
+    if (_connectionLayer)
+      _connectionLayer->addConnection(cgo.get());
+
+    _connectionGraphicsObjects[connectionId] = std::move(cgo);
+
+    attachedNodes.insert(connectionId.outNodeId);
+    attachedNodes.insert(connectionId.inNodeId);
+  }
+
+  for (NodeId const nodeId : attachedNodes)
+  {
+    if (auto ngo = nodeGraphicsObject(nodeId))
+      ngo->update();
+  }
+
+  scheduleWidgetEmbeddingUpdate();
+}
+
+
 void
 BasicGraphicsScene::
 setOrientation(Qt::Orientation const orientation)
@@ -213,6 +430,525 @@ setOrientation(Qt::Orientation const orientation)
 }
 
 
+void
+BasicGraphicsScene::
+setBatchedConnectionPainting(bool const enabled)
+{
+  if (enabled == batchedConnectionPainting())
+    return;
+
+  if (enabled)
+  {
+    _connectionLayer = std::make_unique<ConnectionLayer>();
+
+    addItem(_connectionLayer.get());
+
+    for (auto const & cgo : _connectionGraphicsObjects)
+    {
+      _connectionLayer->addConnection(cgo.second.get());
+    }
+  }
+  else
+  {
+    _connectionLayer.reset();
+  }
+
+  // Connections must be repainted on their own or skip painting now.
+  for (auto const & cgo : _connectionGraphicsObjects)
+  {
+    cgo.second->update();
+  }
+}
+
+
+bool
+BasicGraphicsScene::
+batchedConnectionPainting() const
+{
+  return static_cast<bool>(_connectionLayer);
+}
+
+
+ConnectionLayer *
+BasicGraphicsScene::
+connectionLayer() const
+{
+  return _connectionLayer.get();
+}
+
+
+void
+BasicGraphicsScene::
+setGraphicsObjectPoolLimit(std::size_t const limit)
+{
+  _graphicsObjectPoolLimit = limit;
+
+  if (_nodeGraphicsObjectPool.size() > limit)
+    _nodeGraphicsObjectPool.resize(limit);
+
+  if (_connectionGraphicsObjectPool.size() > limit)
+    _connectionGraphicsObjectPool.resize(limit);
+}
+
+
+void
+BasicGraphicsScene::
+setLazyWidgetEmbedding(bool const enabled)
+{
+  if (enabled == _lazyWidgetEmbedding)
+    return;
+
+  _lazyWidgetEmbedding = enabled;
+
+  if (enabled)
+  {
+    for (auto const & ngo : _nodeGraphicsObjects)
+    {
+      if (ngo.second->widgetEmbedded())
+        _embeddedWidgetNodes.insert(ngo.first);
+    }
+
+    scheduleWidgetEmbeddingUpdate();
+  }
+  else
+  {
+    _widgetEmbeddingTimer->stop();
+    _widgetOffscreenSince.clear();
+    _embeddedWidgetNodes.clear();
+
+    for (auto const & ngo : _nodeGraphicsObjects)
+    {
+      ngo.second->ensureWidgetEmbedded();
+    }
+  }
+}
+
+
+void
+BasicGraphicsScene::
+setConnectionCulling(bool const enabled)
+{
+  _connectionCulling = enabled;
+
+  if (!enabled)
+  {
+    std::unordered_set<ConnectionId> connectionIds;
+    connectionIds.swap(_staleConnections);
+
+    for (auto const & connectionId : connectionIds)
+    {
+      if (auto cgo = connectionGraphicsObject(connectionId))
+        cgo->move();
+    }
+  }
+}
+
+
+QRectF
+BasicGraphicsScene::
+visibleSceneRect() const
+{
+  if (!_visibleSceneRectValid)
+  {
+    _visibleSceneRect = QRectF();
+
+    for (QGraphicsView * view : views())
+    {
+      if (view->isVisible())
+      {
+        _visibleSceneRect |= view->mapToScene(view->viewport()->rect()).boundingRect();
+      }
+    }
+
+    _visibleSceneRectValid = true;
+  }
+
+  return _visibleSceneRect;
+}
+
+
+void
+BasicGraphicsScene::
+markConnectionStale(ConnectionId const connectionId)
+{
+  _staleConnections.insert(connectionId);
+}
+
+
+void
+BasicGraphicsScene::
+updateStaleConnections(QRectF const & sceneRect)
+{
+  if (_staleConnections.empty())
+    return;
+
+  std::vector<ConnectionGraphicsObject *> due;
+
+  for (auto it = _staleConnections.begin(); it != _staleConnections.end();)
+  {
+    auto cgo = connectionGraphicsObject(*it);
+
+    if (!cgo)
+    {
+      it = _staleConnections.erase(it);
+    }
+    else if (sceneRect.intersects(cgo->sceneBoundingRect()) ||
+             sceneRect.intersects(cgo->estimatedSceneBounds()))
+    {
+      due.push_back(cgo);
+      it = _staleConnections.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  for (ConnectionGraphicsObject * cgo : due)
+  {
+    cgo->move();
+  }
+}
+
+
+void
+BasicGraphicsScene::
+scheduleWidgetEmbeddingUpdate()
+{
+  if (_lazyWidgetEmbedding)
+    _widgetEmbeddingTimer->start(widgetEmbeddingDelay);
+}
+
+
+void
+BasicGraphicsScene::
+onNodeWidgetEmbedded(NodeId const nodeId)
+{
+  if (_lazyWidgetEmbedding)
+    _embeddedWidgetNodes.insert(nodeId);
+}
+
+
+void
+BasicGraphicsScene::
+raiseNode(NodeId const nodeId)
+{
+  if (nodeId == _topNodeId)
+    return;
+
+  NodeGraphicsObject * ngo = nodeGraphicsObject(nodeId);
+  if (!ngo)
+    return;
+
+  if (auto previous = nodeGraphicsObject(_topNodeId))
+    previous->setZValue(0.0);
+
+  ngo->setZValue(1.0);
+
+  _topNodeId = nodeId;
+}
+
+
+void
+BasicGraphicsScene::
+onNodeSelectionChanged(NodeId const nodeId, bool const selected)
+{
+  if (selected)
+    _selectedNodes.insert(nodeId);
+  else
+    _selectedNodes.erase(nodeId);
+}
+
+
+void
+BasicGraphicsScene::
+onConnectionSelectionChanged(ConnectionId const connectionId,
+                             bool const         selected)
+{
+  if (selected)
+    _selectedConnections.insert(connectionId);
+  else
+    _selectedConnections.erase(connectionId);
+}
+
+
+std::vector<NodeId>
+BasicGraphicsScene::
+nodesInRect(QRectF const & sceneRect) const
+{
+  return _nodeIndex->query(sceneRect);
+}
+
+
+void
+BasicGraphicsScene::
+updateNodeIndex(NodeGraphicsObject const & ngo)
+{
+  NodeId const nodeId = ngo.nodeId();
+
+  if (nodeId == InvalidNodeId)
+    return;
+
+  _nodeIndex->insert(nodeId, ngo.sceneBoundingRect());
+
+  _portAnchors.erase(portAnchorKey(nodeId, PortType::In));
+  _portAnchors.erase(portAnchorKey(nodeId, PortType::Out));
+}
+
+
+NodeGraphicsObject *
+BasicGraphicsScene::
+nodeGraphicsObjectAt(QPointF const & scenePoint)
+{
+  NodeGraphicsObject * result = nullptr;
+
+  for (NodeId const nodeId : _nodeIndex->query(QRectF(scenePoint, QSizeF(1.0, 1.0))))
+  {
+    NodeGraphicsObject * ngo = nodeGraphicsObject(nodeId);
+
+    if (!ngo || !ngo->sceneBoundingRect().contains(scenePoint))
+      continue;
+
+    if (!result || ngo->zValue() > result->zValue())
+      result = ngo;
+  }
+
+  return result;
+}
+
+
+BasicGraphicsScene::PortLocation
+BasicGraphicsScene::
+locatePort(QPointF const &                               scenePoint,
+           PortType const                                portType,
+           qreal const                                   radius,
+           std::function<bool(NodeId, PortIndex)> const & accept)
+{
+  PortLocation result;
+
+  if (portType == PortType::None)
+    return result;
+
+  QRectF const area(scenePoint.x() - radius,
+                    scenePoint.y() - radius,
+                    2.0 * radius,
+                    2.0 * radius);
+
+  qreal bestDistance = radius * radius;
+
+  for (NodeId const nodeId : _nodeIndex->query(area))
+  {
+    std::vector<QPointF> const & anchors = portAnchors(nodeId, portType);
+
+    for (std::size_t i = 0; i < anchors.size(); ++i)
+    {
+      QPointF const diff = anchors[i] - scenePoint;
+
+      qreal const distance = QPointF::dotProduct(diff, diff);
+
+      if (distance >= bestDistance)
+        continue;
+
+      PortIndex const portIndex = static_cast<PortIndex>(i);
+
+      if (accept && !accept(nodeId, portIndex))
+        continue;
+
+      bestDistance     = distance;
+      result.nodeId    = nodeId;
+      result.portIndex = portIndex;
+      result.scenePos  = anchors[i];
+    }
+  }
+
+  return result;
+}
+
+
+void
+BasicGraphicsScene::
+setPortSnapRadius(qreal const radius)
+{
+  _portSnapRadius = std::max<qreal>(0.0, radius);
+}
+
+
+std::vector<QPointF> const &
+BasicGraphicsScene::
+portAnchors(NodeId const nodeId, PortType const portType)
+{
+  std::uint64_t const key = portAnchorKey(nodeId, portType);
+
+  auto it = _portAnchors.find(key);
+  if (it != _portAnchors.end())
+    return it->second;
+
+  std::vector<QPointF> & anchors = _portAnchors[key];
+
+  NodeGraphicsObject * ngo = nodeGraphicsObject(nodeId);
+  if (!ngo)
+    return anchors;
+
+  unsigned int const n =
+    _graphModel.nodeData<unsigned int>(nodeId,
+                                       (portType == PortType::Out) ?
+                                       NodeRole::OutPortCount :
+                                       NodeRole::InPortCount);
+
+  QTransform const sceneTransform = ngo->sceneTransform();
+
+  anchors.reserve(n);
+
+  for (PortIndex portIndex = 0; portIndex < n; ++portIndex)
+  {
+    anchors.push_back(_nodeGeometry->portScenePosition(nodeId,
+                                                       portType,
+                                                       portIndex,
+                                                       sceneTransform));
+  }
+
+  return anchors;
+}
+
+
+void
+BasicGraphicsScene::
+setConnectionUpdateInterval(int const msec)
+{
+  _connectionUpdateInterval = std::max(0, msec);
+
+  if (_connectionUpdateInterval == 0)
+    flushConnectionUpdates();
+}
+
+
+void
+BasicGraphicsScene::
+scheduleConnectionUpdate(NodeId const nodeId)
+{
+  if (_connectionUpdateInterval == 0)
+  {
+    if (auto ngo = nodeGraphicsObject(nodeId))
+      ngo->moveConnections();
+
+    return;
+  }
+
+  _nodesWithMovedConnections.insert(nodeId);
+
+  // The timer is not restarted, a continuous drag still updates every interval.
+  if (!_connectionUpdateTimer->isActive())
+    _connectionUpdateTimer->start(_connectionUpdateInterval);
+}
+
+
+void
+BasicGraphicsScene::
+flushConnectionUpdates()
+{
+  _connectionUpdateTimer->stop();
+
+  if (_nodesWithMovedConnections.empty())
+    return;
+
+  std::unordered_set<NodeId> nodeIds;
+  nodeIds.swap(_nodesWithMovedConnections);
+
+  std::vector<ConnectionGraphicsObject *> moved;
+
+  for (NodeId const nodeId : nodeIds)
+  {
+    auto it = _movedNodeConnections.find(nodeId);
+
+    // The model is asked once per drag rather than once per frame.
+    if (it == _movedNodeConnections.end())
+    {
+      auto const connected = _graphModel.allConnectionIds(nodeId);
+
+      it = _movedNodeConnections.emplace(
+        nodeId, std::vector<ConnectionId>(connected.begin(), connected.end())).first;
+    }
+
+    for (auto const & connectionId : it->second)
+    {
+      if (auto cgo = connectionGraphicsObject(connectionId))
+        moved.push_back(cgo);
+    }
+  }
+
+  std::sort(moved.begin(), moved.end());
+  moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+
+  for (ConnectionGraphicsObject * cgo : moved)
+  {
+    cgo->move();
+  }
+}
+
+
+void
+BasicGraphicsScene::
+updateWidgetEmbedding()
+{
+  if (!_lazyWidgetEmbedding)
+    return;
+
+  QRectF const visibleRect = visibleSceneRect();
+
+  qint64 const now = _widgetEmbeddingClock.elapsed();
+
+  bool releasePending = false;
+
+  for (NodeId const nodeId : _nodeIndex->query(visibleRect))
+  {
+    if (NodeGraphicsObject * ngo = nodeGraphicsObject(nodeId))
+    {
+      _widgetOffscreenSince.erase(nodeId);
+
+      ngo->ensureWidgetEmbedded();
+    }
+  }
+
+  // The nodes which were embedded before, some of them are offscreen now.
+  for (auto embedded = _embeddedWidgetNodes.begin(); embedded != _embeddedWidgetNodes.end();)
+  {
+    NodeId const nodeId = *embedded;
+    NodeGraphicsObject * ngo = nodeGraphicsObject(nodeId);
+
+    if (!ngo || !ngo->widgetEmbedded())
+    {
+      _widgetOffscreenSince.erase(nodeId);
+      embedded = _embeddedWidgetNodes.erase(embedded);
+      continue;
+    }
+
+    if (visibleRect.intersects(ngo->sceneBoundingRect()) || ngo->nodeState().hovered())
+    {
+      ++embedded;
+      continue;
+    }
+
+    auto it = _widgetOffscreenSince.emplace(nodeId, now).first;
+
+    if (now - it->second >= widgetReleaseDelay)
+    {
+      ngo->releaseWidget();
+
+      _widgetOffscreenSince.erase(it);
+      embedded = _embeddedWidgetNodes.erase(embedded);
+    }
+    else
+    {
+      releasePending = true;
+      ++embedded;
+    }
+  }
+
+  if (releasePending && !_widgetEmbeddingTimer->isActive())
+    _widgetEmbeddingTimer->start(widgetReleaseDelay);
+}
+
+
 QMenu *
 BasicGraphicsScene::
 createSceneMenu(QPointF const scenePos)
@@ -244,8 +980,7 @@ traverseGraphAndPopulateGraphicsObjects()
       auto nodeId = fifo.front();
       fifo.pop();
 
-      _nodeGraphicsObjects[nodeId] =
-        std::make_unique<NodeGraphicsObject>(*this, nodeId);
+      _nodeGraphicsObjects[nodeId] = acquireNodeGraphicsObject(nodeId);
 
       unsigned int nOutPorts =
         _graphModel.nodeData(nodeId, NodeRole::OutPortCount).toUInt();
@@ -271,13 +1006,125 @@ traverseGraphAndPopulateGraphicsObjects()
 
   for (auto const & connectionId : connectionsToCreate)
   {
-    _connectionGraphicsObjects[connectionId] =
-      std::make_unique<ConnectionGraphicsObject>(*this,
-                                                 connectionId);
+    auto cgo = acquireConnectionGraphicsObject(connectionId);
+
+    if (_connectionLayer)
+      _connectionLayer->addConnection(cgo.get());
+
+    _connectionGraphicsObjects[connectionId] = std::move(cgo);
   }
 }
 
 
+std::unique_ptr<NodeGraphicsObject>
+BasicGraphicsScene::
+acquireNodeGraphicsObject(NodeId const nodeId)
+{
+  std::unique_ptr<NodeGraphicsObject> ngo;
+
+  if (_nodeGraphicsObjectPool.empty())
+  {
+    ngo = std::make_unique<NodeGraphicsObject>(*this, nodeId);
+  }
+  else
+  {
+    ngo = std::move(_nodeGraphicsObjectPool.back());
+    _nodeGraphicsObjectPool.pop_back();
+
+    addItem(ngo.get());
+    ngo->attachToNode(nodeId);
+  }
+
+  // Locked nodes don't report their position changes.
+  updateNodeIndex(*ngo);
+
+  return ngo;
+}
+
+
+std::unique_ptr<ConnectionGraphicsObject>
+BasicGraphicsScene::
+acquireConnectionGraphicsObject(ConnectionId const connectionId)
+{
+  if (_connectionGraphicsObjectPool.empty())
+    return std::make_unique<ConnectionGraphicsObject>(*this, connectionId);
+
+  std::unique_ptr<ConnectionGraphicsObject> cgo =
+    std::move(_connectionGraphicsObjectPool.back());
+  _connectionGraphicsObjectPool.pop_back();
+
+  addItem(cgo.get());
+  cgo->attachToConnection(connectionId);
+
+  return cgo;
+}
+
+
+void
+BasicGraphicsScene::
+releaseNodeGraphicsObject(std::unique_ptr<NodeGraphicsObject> ngo)
+{
+  _selectedNodes.erase(ngo->nodeId());
+  _nodeIndex->remove(ngo->nodeId());
+
+  _portAnchors.erase(portAnchorKey(ngo->nodeId(), PortType::In));
+  _portAnchors.erase(portAnchorKey(ngo->nodeId(), PortType::Out));
+
+  removeItem(ngo.get());
+
+  ngo->detachFromNode();
+
+  if (_nodeGraphicsObjectPool.size() < _graphicsObjectPoolLimit)
+    _nodeGraphicsObjectPool.push_back(std::move(ngo));
+}
+
+
+void
+BasicGraphicsScene::
+releaseConnectionGraphicsObject(std::unique_ptr<ConnectionGraphicsObject> cgo)
+{
+  _selectedConnections.erase(cgo->connectionId());
+  _staleConnections.erase(cgo->connectionId());
+
+  removeItem(cgo.get());
+
+  cgo->detachFromConnection();
+
+  if (_connectionGraphicsObjectPool.size() < _graphicsObjectPoolLimit)
+    _connectionGraphicsObjectPool.push_back(std::move(cgo));
+}
+
+
+void
+BasicGraphicsScene::
+detachAllGraphicsObjects()
+{
+  _draftConnection.reset();
+
+  // Without an item index of the scene, deleting the items one by one costs
+  // no more than QGraphicsScene::clear(), and the user items stay untouched.
+  _connectionGraphicsObjects.clear();
+  _nodeGraphicsObjects.clear();
+
+  _connectionLayer.reset();
+
+  _widgetOffscreenSince.clear();
+  _embeddedWidgetNodes.clear();
+
+  _nodesWithMovedConnections.clear();
+  _movedNodeConnections.clear();
+  _connectionUpdateTimer->stop();
+
+  _topNodeId = InvalidNodeId;
+
+  _selectedNodes.clear();
+  _selectedConnections.clear();
+  _nodeIndex->clear();
+  _portAnchors.clear();
+  _staleConnections.clear();
+}
+
+
 void
 BasicGraphicsScene::
 updateAttachedNodes(ConnectionId const connectionId,
@@ -296,10 +1143,19 @@ void
 BasicGraphicsScene::
 onConnectionDeleted(ConnectionId const connectionId)
 {
+  _movedNodeConnections.erase(connectionId.outNodeId);
+  _movedNodeConnections.erase(connectionId.inNodeId);
+
   auto it = _connectionGraphicsObjects.find(connectionId);
   if (it != _connectionGraphicsObjects.end())
   {
+    if (_connectionLayer)
+      _connectionLayer->removeConnection(it->second.get());
+
+    auto cgo = std::move(it->second);
     _connectionGraphicsObjects.erase(it);
+
+    releaseConnectionGraphicsObject(std::move(cgo));
   }
 
   // TODO: do we need it?
@@ -318,9 +1174,35 @@ void
 BasicGraphicsScene::
 onConnectionCreated(ConnectionId const connectionId)
 {
-  _connectionGraphicsObjects[connectionId] =
-    std::make_unique<ConnectionGraphicsObject>(*this,
-                                               connectionId);
+  _movedNodeConnections.erase(connectionId.outNodeId);
+  _movedNodeConnections.erase(connectionId.inNodeId);
+
+  if (_batchInsertionDepth > 0)
+  {
+    _batchedConnections.push_back(connectionId);
+    return;
+  }
+
+  auto it = _connectionGraphicsObjects.find(connectionId);
+
+  if (it != _connectionGraphicsObjects.end())
+  {
+    auto stale = std::move(it->second);
+    _connectionGraphicsObjects.erase(it);
+
+    if (_connectionLayer)
+      _connectionLayer->removeConnection(stale.get());
+
+    releaseConnectionGraphicsObject(std::move(stale));
+  }
+
+  // Map references don't survive insertions, the object is stored last.
+  auto cgo = acquireConnectionGraphicsObject(connectionId);
+
+  if (_connectionLayer)
+    _connectionLayer->addConnection(cgo.get());
+
+  _connectionGraphicsObjects[connectionId] = std::move(cgo);
 
   updateAttachedNodes(connectionId, PortType::Out);
   updateAttachedNodes(connectionId, PortType::In);
@@ -334,7 +1216,18 @@ onNodeDeleted(NodeId const nodeId)
   auto it = _nodeGraphicsObjects.find(nodeId);
   if (it != _nodeGraphicsObjects.end())
   {
+    auto ngo = std::move(it->second);
     _nodeGraphicsObjects.erase(it);
+
+    _widgetOffscreenSince.erase(nodeId);
+    _embeddedWidgetNodes.erase(nodeId);
+    _movedNodeConnections.erase(nodeId);
+
+    // The same id comes back with a fresh object on undo.
+    if (nodeId == _topNodeId)
+      _topNodeId = InvalidNodeId;
+
+    releaseNodeGraphicsObject(std::move(ngo));
   }
 }
 
@@ -343,8 +1236,15 @@ void
 BasicGraphicsScene::
 onNodeCreated(NodeId const nodeId)
 {
-  _nodeGraphicsObjects[nodeId] =
-    std::make_unique<NodeGraphicsObject>(*this, nodeId);
+  if (_batchInsertionDepth > 0)
+  {
+    _batchedNodes.push_back(nodeId);
+    return;
+  }
+
+  _nodeGraphicsObjects[nodeId] = acquireNodeGraphicsObject(nodeId);
+
+  scheduleWidgetEmbeddingUpdate();
 }
 
 
@@ -358,6 +1258,8 @@ onNodePositionUpdated(NodeId const nodeId)
     node->setPos(_graphModel.nodeData(nodeId,
                                       NodeRole::Position).value<QPointF>());
     node->update();
+
+    updateNodeIndex(*node);
   }
 }
 
@@ -376,6 +1278,8 @@ onNodeUpdated(NodeId const nodeId)
 
     node->update();
     node->moveConnections();
+
+    updateNodeIndex(*node);
   }
 }
 
@@ -384,12 +1288,15 @@ void
 BasicGraphicsScene::
 onModelReset()
 {
-  _connectionGraphicsObjects.clear();
-  _nodeGraphicsObjects.clear();
+  bool const batched = batchedConnectionPainting();
+
+  detachAllGraphicsObjects();
 
-  clear();
+  setBatchedConnectionPainting(batched);
 
   traverseGraphAndPopulateGraphicsObjects();
+
+  scheduleWidgetEmbeddingUpdate();
 }
 
 }
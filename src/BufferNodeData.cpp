@@ -0,0 +1,171 @@
+#include "BufferNodeData.hpp"
+
+#include <QtCore/QtGlobal>
+
+#include <cstring>
+#include <new>
+
+using QtNodes::BufferNodeData;
+using QtNodes::NodeData;
+using QtNodes::NodeDataType;
+
+struct BufferNodeData::Storage
+{
+  Storage(std::size_t const size, std::size_t const alignment)
+    : data(nullptr)
+    , size(size)
+    , alignment(alignment)
+  {
+    if (size > 0)
+    {
+      data = qMallocAligned(size, alignment);
+
+      if (!data)
+        throw std::bad_alloc();
+    }
+  }
+
+  ~Storage()
+  {
+    qFreeAligned(data);
+  }
+
+  Storage(Storage const &) = delete;
+
+  Storage & operator=(Storage const &) = delete;
+
+  void * data;
+
+  std::size_t const size;
+
+  std::size_t const alignment;
+};
+
+constexpr std::size_t BufferNodeData::DefaultAlignment;
+
+
+BufferNodeData::
+BufferNodeData(NodeDataType      type,
+               std::size_t const size,
+               std::size_t const alignment)
+  : _type(std::move(type))
+  , _storage(std::make_shared<Storage>(size, alignment))
+{}
+
+
+BufferNodeData::
+BufferNodeData(NodeDataType          type,
+               BufferNodeData const& other)
+  : _type(std::move(type))
+  , _storage(other._storage)
+{}
+
+
+std::size_t
+BufferNodeData::
+size() const
+{
+  return _storage->size;
+}
+
+
+std::size_t
+BufferNodeData::
+alignment() const
+{
+  return _storage->alignment;
+}
+
+
+bool
+BufferNodeData::
+isShared() const
+{
+  return _storage.use_count() > 1;
+}
+
+
+void const *
+BufferNodeData::
+constData() const
+{
+  return _storage->data;
+}
+
+
+void *
+BufferNodeData::
+data()
+{
+  detach();
+
+  return _storage->data;
+}
+
+
+BufferNodeData::View
+BufferNodeData::
+view() const
+{
+  View v;
+
+  // Aliasing constructor: the view owns a reference to the whole storage.
+  v._storage = std::shared_ptr<void const>(_storage, _storage->data);
+  v._data    = _storage->data;
+  v._size    = _storage->size;
+
+  return v;
+}
+
+
+void
+BufferNodeData::
+detach()
+{
+  if (!isShared())
+    return;
+
+  auto copy = std::make_shared<Storage>(_storage->size, _storage->alignment);
+
+  if (copy->size > 0)
+    std::memcpy(copy->data, _storage->data, copy->size);
+
+  _storage = std::move(copy);
+}
+
+
+std::shared_ptr<BufferNodeData>
+BufferNodeData::
+detach(std::shared_ptr<BufferNodeData> && buffer)
+{
+  if (!buffer)
+    return nullptr;
+
+  std::shared_ptr<BufferNodeData> result = std::move(buffer);
+
+  // Other nodes hold the same object, it must not be written to.
+  if (result.use_count() > 1)
+    result = std::make_shared<BufferNodeData>(*result);
+
+  result->detach();
+
+  return result;
+}
+
+
+std::shared_ptr<BufferNodeData>
+BufferNodeData::
+detach(std::shared_ptr<NodeData> && data)
+{
+  auto buffer = dynamic_cast<BufferNodeData *>(data.get());
+
+  if (!buffer)
+    return nullptr;
+
+  // Aliasing constructor, then drop the moved-in reference so that the
+  // result is the only one counted for the caller.
+  std::shared_ptr<BufferNodeData> result(data, buffer);
+  data.reset();
+
+  return detach(std::move(result));
+}
@@ -4,7 +4,6 @@
 #include <QtWidgets/QGraphicsDropShadowEffect>
 #include <QtWidgets/QGraphicsBlurEffect>
 #include <QtWidgets/QStyleOptionGraphicsItem>
-#include <QtWidgets/QGraphicsView>
 
 #include <QtCore/QDebug>
 
@@ -12,13 +11,55 @@
 #include "AbstractNodeGeometry.hpp"
 #include "BasicGraphicsScene.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "ConnectionLayer.hpp"
 #include "ConnectionPainter.hpp"
 #include "ConnectionState.hpp"
 #include "ConnectionStyle.hpp"
 #include "NodeConnectionInteraction.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "StyleCollection.hpp"
-#include "locateNode.hpp"
+
+
+namespace
+{
+
+using QtNodes::BasicGraphicsScene;
+using QtNodes::ConnectionGraphicsObject;
+using QtNodes::ConnectionId;
+using QtNodes::NodeId;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+/// Largest distance of a Bezier control point from its end point.
+double const maxControlPointOffset = 200;
+
+/// Nearest port the loose end of the draft connection could be attached to.
+BasicGraphicsScene::PortLocation
+locateCompatiblePort(ConnectionGraphicsObject const & cgo, QPointF const & scenePos)
+{
+  BasicGraphicsScene & scene = *cgo.nodeScene();
+
+  ConnectionId const connectionId = cgo.connectionId();
+
+  PortType const requiredPort = cgo.connectionState().requiredPort();
+
+  NodeId const attachedNodeId =
+    QtNodes::getNodeId(QtNodes::oppositePort(requiredPort), connectionId);
+
+  auto accept =
+    [&](NodeId const nodeId, PortIndex const portIndex)
+    {
+      ConnectionId const possibleConnectionId =
+        QtNodes::makeCompleteConnectionId(connectionId, nodeId, portIndex);
+
+      return nodeId != attachedNodeId &&
+             scene.graphModel().connectionPossible(possibleConnectionId);
+    };
+
+  return scene.locatePort(scenePos, requiredPort, scene.portSnapRadius(), accept);
+}
+
+}
 
 
 namespace QtNodes
@@ -90,6 +131,38 @@ initializePosition()
 }
 
 
+void
+ConnectionGraphicsObject::
+detachFromConnection()
+{
+  setSelected(false);
+
+  _connectionState.setHovered(false);
+  _connectionState.setLastHoveredNode(InvalidNodeId);
+}
+
+
+void
+ConnectionGraphicsObject::
+attachToConnection(ConnectionId const connectionId)
+{
+  Q_ASSERT(nodeScene());
+
+  prepareGeometryChange();
+
+  _connectionId = connectionId;
+
+  _out = QPointF(0, 0);
+  _in  = QPointF(0, 0);
+
+  setPos(0, 0);
+
+  initializePosition();
+
+  update();
+}
+
+
 AbstractGraphModel &
 ConnectionGraphicsObject::
 graphModel() const
@@ -184,6 +257,24 @@ void
 ConnectionGraphicsObject::
 move()
 {
+  BasicGraphicsScene & scene = *nodeScene();
+
+  // The draft connection follows the mouse and is never culled.
+  if (scene.connectionCulling() &&
+      _connectionState.requiredPort() == PortType::None)
+  {
+    QRectF const visibleRect = scene.visibleSceneRect();
+
+    // With all views hidden there is nothing to refresh the connection later.
+    if (!visibleRect.isEmpty() &&
+        !visibleRect.intersects(sceneBoundingRect()) &&
+        !visibleRect.intersects(estimatedSceneBounds()))
+    {
+      scene.markConnectionStale(_connectionId);
+      return;
+    }
+  }
+
   auto moveEnd =
     [this](ConnectionId cId, PortType portType)
     {
@@ -217,6 +308,29 @@ move()
   prepareGeometryChange();
 
   update();
+
+  if (auto layer = scene.connectionLayer())
+    layer->connectionMoved(*this);
+}
+
+
+QRectF
+ConnectionGraphicsObject::
+estimatedSceneBounds() const
+{
+  QRectF result;
+
+  for (PortType const portType : {PortType::Out, PortType::In})
+  {
+    if (auto ngo = nodeScene()->nodeGraphicsObject(getNodeId(portType, _connectionId)))
+      result |= ngo->sceneBoundingRect();
+  }
+
+  // Control points lie within a fixed distance from the ports.
+  double const margin =
+    maxControlPointOffset + StyleCollection::connectionStyle().pointDiameter();
+
+  return result.adjusted(-margin, -margin, margin, margin);
 }
 
 
@@ -245,12 +359,40 @@ paint(QPainter * painter,
   if (!scene())
     return;
 
+  // Idle connections are painted all at once by the scene.
+  if (auto layer = nodeScene()->connectionLayer())
+  {
+    if (layer->paintsConnection(*this))
+      return;
+  }
+
   painter->setClipRect(option->exposedRect);
 
   ConnectionPainter::paint(painter, *this);
 }
 
 
+QVariant
+ConnectionGraphicsObject::
+itemChange(GraphicsItemChange change, const QVariant &value)
+{
+  if (change == ItemSelectedHasChanged && scene())
+  {
+    if (auto layer = nodeScene()->connectionLayer())
+      layer->connectionStateChanged(*this);
+
+    // Draft connections have one end only and are not tracked.
+    if (_connectionId.outNodeId != InvalidNodeId &&
+        _connectionId.inNodeId != InvalidNodeId)
+    {
+      nodeScene()->onConnectionSelectionChanged(_connectionId, value.toBool());
+    }
+  }
+
+  return QGraphicsObject::itemChange(change, value);
+}
+
+
 void
 ConnectionGraphicsObject::
 mousePressEvent(QGraphicsSceneMouseEvent * event)
@@ -265,10 +407,13 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
 {
   prepareGeometryChange();
 
-  auto view = static_cast<QGraphicsView *>(event->widget());
-  auto ngo  = locateNodeAt(event->scenePos(),
-                           *nodeScene(),
-                           view->transform());
+  BasicGraphicsScene & scene = *nodeScene();
+
+  auto const port = locateCompatiblePort(*this, event->scenePos());
+
+  auto ngo = (port.nodeId != InvalidNodeId) ?
+             scene.nodeGraphicsObject(port.nodeId) :
+             scene.nodeGraphicsObjectAt(event->scenePos());
   if (ngo)
   {
     ngo->reactToConnection(this);
@@ -286,7 +431,12 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
 
   if (requiredPort != PortType::None)
   {
-    setEndPoint(requiredPort, event->pos());
+    // The loose end snaps to the nearest port accepting the connection.
+    QPointF const endPoint = (port.nodeId != InvalidNodeId) ?
+                             mapFromScene(port.scenePos) :
+                             event->pos();
+
+    setEndPoint(requiredPort, endPoint);
   }
 
   //-------------------
@@ -306,18 +456,15 @@ mouseReleaseEvent(QGraphicsSceneMouseEvent * event)
   ungrabMouse();
   event->accept();
 
-  auto view = static_cast<QGraphicsView *>(event->widget());
-
-  Q_ASSERT(view);
-
-  auto ngo = locateNodeAt(event->scenePos(),
-                          *nodeScene(),
-                          view->transform());
+  auto const port = locateCompatiblePort(*this, event->scenePos());
 
   bool wasConnected = false;
 
-  if (ngo)
+  if (auto ngo = nodeScene()->nodeGraphicsObject(port.nodeId))
   {
+    // The release may come before the last move placed the loose end.
+    setEndPoint(_connectionState.requiredPort(), mapFromScene(port.scenePos));
+
     NodeConnectionInteraction interaction(*ngo, *this, *nodeScene());
 
     wasConnected = interaction.tryConnect();
@@ -340,6 +487,9 @@ hoverEnterEvent(QGraphicsSceneHoverEvent * event)
 
   update();
 
+  if (auto layer = nodeScene()->connectionLayer())
+    layer->connectionStateChanged(*this);
+
   // Signal
   nodeScene()->connectionHovered(connectionId(), event->screenPos());
 
@@ -355,6 +505,9 @@ hoverLeaveEvent(QGraphicsSceneHoverEvent * event)
 
   update();
 
+  if (auto layer = nodeScene()->connectionLayer())
+    layer->connectionStateChanged(*this);
+
   // Signal
   nodeScene()->connectionHoverLeft(connectionId());
 
@@ -399,7 +552,7 @@ std::pair<QPointF, QPointF>
 ConnectionGraphicsObject::
 pointsC1C2Horizontal() const
 {
-  double const defaultOffset = 200;
+  double const defaultOffset = maxControlPointOffset;
 
   double xDistance = _in.x() - _out.x();
 
@@ -436,7 +589,7 @@ std::pair<QPointF, QPointF>
 ConnectionGraphicsObject::
 pointsC1C2Vertical() const
 {
-  double const defaultOffset = 200;
+  double const defaultOffset = maxControlPointOffset;
 
   double yDistance = _in.y() - _out.y();
 
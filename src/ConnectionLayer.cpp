@@ -0,0 +1,419 @@
+#include "ConnectionLayer.hpp"
+
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+
+#include "ConnectionGraphicsObject.hpp"
+#include "ConnectionPainter.hpp"
+#include "ConnectionState.hpp"
+#include "ConnectionStyleCache.hpp"
+#include "StyleCollection.hpp"
+
+
+namespace
+{
+
+/// Connections merged into one path. Moving a connection costs a rebuild
+/// of that many cubic paths instead of all the idle connections.
+std::size_t const batchCapacity = 64;
+
+}
+
+
+namespace QtNodes
+{
+
+ConnectionLayer::
+ConnectionLayer()
+  : _styleGeneration(ConnectionStyleCache::instance().generation())
+  , _synchronizeScheduled(false)
+{
+  setAcceptedMouseButtons(Qt::NoButton);
+  setAcceptHoverEvents(false);
+
+  // Below the connections which are still painted individually.
+  setZValue(-2.0);
+}
+
+
+void
+ConnectionLayer::
+addConnection(ConnectionGraphicsObject const * cgo)
+{
+  _slots.emplace(cgo, Slot());
+
+  // The connection is not positioned yet.
+  _pending.insert(cgo);
+
+  scheduleSynchronize();
+}
+
+
+void
+ConnectionLayer::
+removeConnection(ConnectionGraphicsObject const * cgo)
+{
+  auto it = _slots.find(cgo);
+
+  if (it == _slots.end())
+    return;
+
+  if (it->second.batched)
+  {
+    detach(it->second);
+
+    scheduleSynchronize();
+  }
+
+  _slots.erase(it);
+  _pending.erase(cgo);
+}
+
+
+void
+ConnectionLayer::
+connectionMoved(ConnectionGraphicsObject const & cgo)
+{
+  auto it = _slots.find(&cgo);
+
+  if (it == _slots.end() || !it->second.batched)
+    return;
+
+  markDirty(it->second.batch);
+
+  scheduleSynchronize();
+}
+
+
+void
+ConnectionLayer::
+connectionStateChanged(ConnectionGraphicsObject const & cgo)
+{
+  if (_slots.count(&cgo) == 0)
+    return;
+
+  _pending.insert(&cgo);
+
+  scheduleSynchronize();
+}
+
+
+bool
+ConnectionLayer::
+paintsConnection(ConnectionGraphicsObject const & cgo) const
+{
+  if (styleOutdated())
+    return false;
+
+  auto it = _slots.find(&cgo);
+
+  return it != _slots.end() && it->second.batched;
+}
+
+
+QRectF
+ConnectionLayer::
+boundingRect() const
+{
+  return _boundingRect;
+}
+
+
+QPainterPath
+ConnectionLayer::
+shape() const
+{
+  return QPainterPath();
+}
+
+
+void
+ConnectionLayer::
+paint(QPainter * painter,
+      QStyleOptionGraphicsItem const * option,
+      QWidget *)
+{
+  // The connections paint themselves until the new style is applied.
+  if (styleOutdated())
+  {
+    scheduleSynchronize();
+    return;
+  }
+
+  QRectF const exposedRect = option->exposedRect;
+
+  painter->setClipRect(exposedRect);
+
+  painter->setBrush(Qt::NoBrush);
+
+  for (Batch const & batch : _batches)
+  {
+    if (batch.connections.empty() || !batch.bounds.intersects(exposedRect))
+      continue;
+
+    painter->setPen(batch.pen);
+    painter->drawPath(batch.path);
+  }
+
+  QPen const & endPointPen = ConnectionStyleCache::instance().endPointPen();
+
+  painter->setPen(endPointPen);
+  painter->setBrush(endPointPen.color());
+
+  for (Batch const & batch : _batches)
+  {
+    if (batch.connections.empty() || !batch.bounds.intersects(exposedRect))
+      continue;
+
+    painter->drawPath(batch.endPoints);
+  }
+}
+
+
+void
+ConnectionLayer::
+scheduleSynchronize()
+{
+  if (_synchronizeScheduled)
+    return;
+
+  _synchronizeScheduled = true;
+
+  // Posted events are delivered before the views repaint, the call is
+  // dropped together with the layer.
+  QMetaObject::invokeMethod(this,
+                            [this]() { synchronize(); },
+                            Qt::QueuedConnection);
+}
+
+
+void
+ConnectionLayer::
+synchronize()
+{
+  _synchronizeScheduled = false;
+
+  if (styleOutdated())
+    resetBatches();
+
+  for (auto const * cgo : _pending)
+  {
+    updateSlot(cgo);
+  }
+
+  _pending.clear();
+
+  if (_dirtyBatches.empty())
+    return;
+
+  for (std::size_t const batchIndex : _dirtyBatches)
+  {
+    Batch & batch = _batches[batchIndex];
+
+    QRectF const oldBounds = batch.bounds;
+
+    rebuildBatch(batch);
+
+    update(oldBounds | batch.bounds);
+  }
+
+  _dirtyBatches.clear();
+
+  updateBoundingRect();
+}
+
+
+bool
+ConnectionLayer::
+styleOutdated() const
+{
+  return ConnectionStyleCache::instance().generation() != _styleGeneration;
+}
+
+
+void
+ConnectionLayer::
+resetBatches()
+{
+  _styleGeneration = ConnectionStyleCache::instance().generation();
+
+  _batches.clear();
+  _dirtyBatches.clear();
+
+  for (auto & slot : _slots)
+  {
+    slot.second = Slot();
+
+    _pending.insert(slot.first);
+  }
+
+  // Nothing is left to paint until the batches are rebuilt.
+  updateBoundingRect();
+}
+
+
+void
+ConnectionLayer::
+updateSlot(ConnectionGraphicsObject const * cgo)
+{
+  auto it = _slots.find(cgo);
+
+  if (it == _slots.end())
+    return;
+
+  QPen pen;
+
+  bool const batched =
+    !cgo->isSelected() &&
+    !cgo->connectionState().hovered() &&
+    ConnectionPainter::plainLinePen(*cgo, pen);
+
+  Slot & slot = it->second;
+
+  if (slot.batched)
+  {
+    if (batched && _batches[slot.batch].pen == pen)
+    {
+      markDirty(slot.batch);
+      return;
+    }
+
+    detach(slot);
+  }
+
+  if (batched)
+    attach(cgo, pen);
+}
+
+
+void
+ConnectionLayer::
+attach(ConnectionGraphicsObject const * cgo, QPen const & pen)
+{
+  std::size_t batchIndex = _batches.size();
+
+  for (std::size_t i = 0; i < _batches.size(); ++i)
+  {
+    Batch const & batch = _batches[i];
+
+    if (batch.connections.empty())
+    {
+      // Reused unless a batch of the same pen has room.
+      if (batchIndex == _batches.size())
+        batchIndex = i;
+    }
+    else if (batch.pen == pen && batch.connections.size() < batchCapacity)
+    {
+      batchIndex = i;
+      break;
+    }
+  }
+
+  if (batchIndex == _batches.size())
+    _batches.emplace_back();
+
+  Batch & batch = _batches[batchIndex];
+
+  if (batch.connections.empty())
+    batch.pen = pen;
+
+  Slot & slot = _slots[cgo];
+
+  slot.batched = true;
+  slot.batch   = batchIndex;
+  slot.index   = batch.connections.size();
+
+  batch.connections.push_back(cgo);
+
+  markDirty(batchIndex);
+}
+
+
+void
+ConnectionLayer::
+detach(Slot & slot)
+{
+  Batch & batch = _batches[slot.batch];
+
+  // Swaps the last connection into the gap.
+  ConnectionGraphicsObject const * last = batch.connections.back();
+
+  batch.connections[slot.index] = last;
+  _slots[last].index = slot.index;
+
+  batch.connections.pop_back();
+
+  markDirty(slot.batch);
+
+  slot = Slot();
+}
+
+
+void
+ConnectionLayer::
+markDirty(std::size_t const batchIndex)
+{
+  Batch & batch = _batches[batchIndex];
+
+  if (batch.dirty)
+    return;
+
+  batch.dirty = true;
+
+  _dirtyBatches.push_back(batchIndex);
+}
+
+
+void
+ConnectionLayer::
+rebuildBatch(Batch & batch)
+{
+  batch.path      = QPainterPath();
+  batch.endPoints = QPainterPath();
+  batch.bounds    = QRectF();
+  batch.dirty     = false;
+
+  if (batch.connections.empty())
+    return;
+
+  double const pointRadius =
+    StyleCollection::connectionStyle().pointDiameter() / 2.0;
+
+  for (auto const * cgo : batch.connections)
+  {
+    batch.path.addPath(cgo->mapToScene(ConnectionPainter::cubicPath(*cgo)));
+
+    batch.endPoints.addEllipse(cgo->mapToScene(cgo->out()), pointRadius, pointRadius);
+    batch.endPoints.addEllipse(cgo->mapToScene(cgo->in()),  pointRadius, pointRadius);
+  }
+
+  double const margin = batch.pen.widthF();
+
+  batch.bounds = batch.path.boundingRect()
+                 .united(batch.endPoints.boundingRect())
+                 .adjusted(-margin, -margin, margin, margin);
+}
+
+
+void
+ConnectionLayer::
+updateBoundingRect()
+{
+  QRectF rect;
+
+  for (Batch const & batch : _batches)
+  {
+    rect |= batch.bounds;
+  }
+
+  if (rect == _boundingRect)
+    return;
+
+  // The scene must query the old bounding rect before it changes.
+  prepareGeometryChange();
+
+  _boundingRect = rect;
+}
+
+
+}
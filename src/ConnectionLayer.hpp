@@ -0,0 +1,161 @@
+#pragma once
+
+#include <QtGui/QColor>
+#include <QtGui/QPainterPath>
+#include <QtGui/QPen>
+#include <QtWidgets/QGraphicsObject>
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Definitions.hpp"
+
+namespace QtNodes
+{
+
+class ConnectionGraphicsObject;
+
+/// Scene-level item painting all idle connections in a few passes.
+/**
+ * Every registered connection which is neither selected nor hovered and which
+ * is drawn with a single color is merged into a batch of connections of this
+ * color. Each batch keeps one `QPainterPath` for its wires and one for their
+ * end points. The individual ConnectionGraphicsObject instances stay in the
+ * scene for the interaction but skip their own painting.
+ *
+ * A batch holds a bounded number of connections, so a moving connection only
+ * rebuilds the paths of its own batch. The connections report their moves and
+ * state changes, the layer collects them and rebuilds the affected batches in
+ * one deferred pass before the next paint. Painting and `paintsConnection()`
+ * only read the batches.
+ */
+class ConnectionLayer : public QGraphicsObject
+{
+public:
+  // Needed for qgraphicsitem_cast
+  enum { Type = UserType + 3 };
+
+  int
+  type() const override { return Type; }
+
+public:
+  ConnectionLayer();
+
+public:
+  void
+  addConnection(ConnectionGraphicsObject const * cgo);
+
+  void
+  removeConnection(ConnectionGraphicsObject const * cgo);
+
+  /// Rebuilds the batch of the connection after its geometry has changed.
+  void
+  connectionMoved(ConnectionGraphicsObject const & cgo);
+
+  /// Decides again whether the connection is batched, e.g. once hovered.
+  void
+  connectionStateChanged(ConnectionGraphicsObject const & cgo);
+
+  /// @returns `true` if the layer takes care of painting the given connection.
+  /**
+   * Connections are painted individually while the batches wait for a
+   * changed connection style to be applied.
+   */
+  bool
+  paintsConnection(ConnectionGraphicsObject const & cgo) const;
+
+public:
+  /// Union of the batch bounds, recomputed whenever a batch is rebuilt.
+  QRectF
+  boundingRect() const override;
+
+  /// The layer is never a target for mouse interaction.
+  QPainterPath
+  shape() const override;
+
+protected:
+  void
+  paint(QPainter * painter,
+        QStyleOptionGraphicsItem const * option,
+        QWidget * widget = 0) override;
+
+private:
+  struct Batch
+  {
+    QPen pen;
+
+    std::vector<ConnectionGraphicsObject const *> connections;
+
+    /// Wires and end points in scene coordinates.
+    QPainterPath path;
+    QPainterPath endPoints;
+
+    QRectF bounds;
+
+    bool dirty = false;
+  };
+
+  struct Slot
+  {
+    bool batched = false;
+
+    std::size_t batch = 0;
+
+    /// Position in `Batch::connections`.
+    std::size_t index = 0;
+  };
+
+private:
+  /// Posts one `synchronize()` call for all the changes of this event loop pass.
+  void
+  scheduleSynchronize();
+
+  /// Applies the pending state changes and rebuilds the dirty batches.
+  void
+  synchronize();
+
+  bool
+  styleOutdated() const;
+
+  /// Unbatches all connections once the connection style has changed.
+  void
+  resetBatches();
+
+  void
+  updateSlot(ConnectionGraphicsObject const * cgo);
+
+  void
+  attach(ConnectionGraphicsObject const * cgo, QPen const & pen);
+
+  void
+  detach(Slot & slot);
+
+  void
+  markDirty(std::size_t const batchIndex);
+
+  void
+  rebuildBatch(Batch & batch);
+
+  void
+  updateBoundingRect();
+
+private:
+  std::unordered_map<ConnectionGraphicsObject const *, Slot> _slots;
+
+  /// Connections whose batch membership must be decided again.
+  std::unordered_set<ConnectionGraphicsObject const *> _pending;
+
+  std::vector<Batch> _batches;
+
+  std::vector<std::size_t> _dirtyBatches;
+
+  unsigned _styleGeneration;
+
+  bool _synchronizeScheduled;
+
+  QRectF _boundingRect;
+};
+
+}
@@ -1,10 +1,11 @@
 #include "ConnectionPainter.hpp"
 
-#include <QtGui/QIcon>
+#include <QtGui/QLinearGradient>
 
 #include "AbstractGraphModel.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
+#include "ConnectionStyleCache.hpp"
 #include "Definitions.hpp"
 #include "NodeData.hpp"
 #include "StyleCollection.hpp"
@@ -13,8 +14,8 @@
 namespace QtNodes
 {
 
-static
 QPainterPath
+ConnectionPainter::
 cubicPath(ConnectionGraphicsObject const &connection)
 {
   QPointF const &in  = connection.endPoint(PortType::In);
@@ -35,7 +36,7 @@ QPainterPath
 ConnectionPainter::
 getPainterStroke(ConnectionGraphicsObject const &connection)
 {
-  auto cubic = cubicPath(connection);
+  auto cubic = ConnectionPainter::cubicPath(connection);
 
   QPointF const &out = connection.endPoint(PortType::Out);
   QPainterPath result(out);
@@ -78,7 +79,7 @@ debugDrawing(QPainter * painter,
     painter->drawEllipse(points.second, 3, 3);
 
     painter->setBrush(Qt::NoBrush);
-    painter->drawPath(cubicPath(cgo));
+    painter->drawPath(ConnectionPainter::cubicPath(cgo));
   }
 
   {
@@ -99,18 +100,10 @@ drawSketchLine(QPainter * painter,
 
   if (state.requiresPort())
   {
-    auto const &connectionStyle =
-      QtNodes::StyleCollection::connectionStyle();
-
-    QPen pen;
-    pen.setWidth(connectionStyle.constructionLineWidth());
-    pen.setColor(connectionStyle.constructionColor());
-    pen.setStyle(Qt::DashLine);
-
-    painter->setPen(pen);
+    painter->setPen(ConnectionStyleCache::instance().sketchPen());
     painter->setBrush(Qt::NoBrush);
 
-    auto cubic = cubicPath(cgo);
+    auto cubic = ConnectionPainter::cubicPath(cgo);
 
     // cubic spline
     painter->drawPath(cubic);
@@ -129,50 +122,52 @@ drawHoveredOrSelected(QPainter * painter,
   // drawn as a fat background
   if (hovered || selected)
   {
-    auto const &connectionStyle =
-      QtNodes::StyleCollection::connectionStyle();
+    auto &cache = ConnectionStyleCache::instance();
 
-    double const lineWidth = connectionStyle.lineWidth();
-
-    QPen pen;
-    pen.setWidth(2 * lineWidth);
-    pen.setColor(selected ?
-                 connectionStyle.selectedHaloColor() :
-                 connectionStyle.hoveredColor());
-
-    painter->setPen(pen);
+    painter->setPen(selected ?
+                    cache.selectedHaloPen() :
+                    cache.hoveredHaloPen());
     painter->setBrush(Qt::NoBrush);
 
     // cubic spline
-    auto const cubic = cubicPath(cgo);
+    auto const cubic = ConnectionPainter::cubicPath(cgo);
     painter->drawPath(cubic);
   }
 }
 
 
-static
-void
-drawNormalLine(QPainter * painter,
-               ConnectionGraphicsObject const &cgo)
+namespace
 {
-  ConnectionState const &state = cgo.connectionState();
 
-  if (state.requiresPort())
-    return;
+struct LineColors
+{
+  QColor out;
+  QColor in;
+  QPen   pen;
+  QPen   selectedPen;
+  bool   gradient;
+};
 
-  // colors
+}
 
-  auto const &connectionStyle =
-    QtNodes::StyleCollection::connectionStyle();
 
-  QColor normalColorOut = connectionStyle.normalColor();
-  QColor normalColorIn  = connectionStyle.normalColor();
-  QColor selectedColor  = connectionStyle.selectedColor();
+static
+LineColors
+lineColors(ConnectionGraphicsObject const &cgo)
+{
+  auto &cache = ConnectionStyleCache::instance();
 
-  bool useGradientColor = false;
+  LineColors colors{cache.normalPen().color(),
+                    cache.normalPen().color(),
+                    cache.normalPen(),
+                    cache.selectedPen(),
+                    false};
 
   AbstractGraphModel const &graphModel = cgo.graphModel();
 
+  auto const &connectionStyle =
+    QtNodes::StyleCollection::connectionStyle();
+
   if (connectionStyle.useDataDefinedColors())
   {
     using QtNodes::PortType;
@@ -191,76 +186,94 @@ drawNormalLine(QPainter * painter,
                           cId.inPortIndex,
                           PortRole::DataType).value<NodeDataType>();
 
-    useGradientColor = (dataTypeOut.id != dataTypeIn.id);
+    colors.gradient = (dataTypeOut.handle() != dataTypeIn.handle());
+
+    // Copied before the next lookup may grow the cache.
+    auto const & outResources = cache.typeResources(dataTypeOut);
+
+    colors.out         = outResources.color;
+    colors.pen         = outResources.pen;
+    colors.selectedPen = outResources.selectedPen;
 
-    normalColorOut = connectionStyle.normalColor(dataTypeOut.id);
-    normalColorIn  = connectionStyle.normalColor(dataTypeIn.id);
-    selectedColor  = normalColorOut.darker(200);
+    colors.in = colors.gradient ?
+                cache.typeResources(dataTypeIn).color :
+                colors.out;
   }
 
-  // geometry
+  return colors;
+}
+
+
+bool
+ConnectionPainter::
+plainLinePen(ConnectionGraphicsObject const &cgo,
+             QPen &pen)
+{
+  if (cgo.connectionState().requiresPort())
+    return false;
+
+  LineColors const colors = lineColors(cgo);
 
-  double const lineWidth = connectionStyle.lineWidth();
+  pen = colors.pen;
 
-  // draw normal line
-  QPen p;
+  return !colors.gradient;
+}
 
-  p.setWidth(lineWidth);
+
+static
+void
+drawNormalLine(QPainter * painter,
+               ConnectionGraphicsObject const &cgo)
+{
+  ConnectionState const &state = cgo.connectionState();
+
+  if (state.requiresPort())
+    return;
+
+  LineColors const colors = lineColors(cgo);
 
   bool const selected = cgo.isSelected();
 
-  auto cubic = cubicPath(cgo);
-  if (useGradientColor)
-  {
-    painter->setBrush(Qt::NoBrush);
+  auto cubic = ConnectionPainter::cubicPath(cgo);
 
-    QColor cOut = normalColorOut;
+  painter->setBrush(Qt::NoBrush);
+
+  if (colors.gradient)
+  {
+    QColor cOut = colors.out;
+    QColor cIn  = colors.in;
     if (selected)
+    {
       cOut = cOut.darker(200);
-    p.setColor(cOut);
-    painter->setPen(p);
+      cIn  = cIn.darker(200);
+    }
 
-    unsigned int const segments = 60;
+    // The color switches in the middle of the straight line between the
+    // end points which is close enough to the middle of the curve.
+    QLinearGradient gradient(cgo.endPoint(PortType::Out),
+                             cgo.endPoint(PortType::In));
+    gradient.setColorAt(0.0, cOut);
+    gradient.setColorAt(0.5, cOut);
+    gradient.setColorAt(0.5, cIn);
+    gradient.setColorAt(1.0, cIn);
 
-    for (unsigned int i = 0ul; i < segments; ++i)
-    {
-      double ratioPrev = double(i) / segments;
-      double ratio     = double(i + 1) / segments;
-
-      if (i == segments / 2)
-      {
-        QColor cIn = normalColorIn;
-        if (selected)
-          cIn = cIn.darker(200);
-
-        p.setColor(cIn);
-        painter->setPen(p);
-      }
-      painter->drawLine(cubic.pointAtPercent(ratioPrev),
-                        cubic.pointAtPercent(ratio));
-    }
+    QPen p = colors.pen;
+    p.setBrush(gradient);
+
+    painter->setPen(p);
+    painter->drawPath(cubic);
 
     {
-      QIcon icon(":convert.png");
+      QPixmap const &pixmap = ConnectionStyleCache::instance().convertPixmap();
 
-      QPixmap pixmap = icon.pixmap(QSize(22, 22));
       painter->drawPixmap(cubic.pointAtPercent(0.50) - QPoint(pixmap.width() / 2,
                                                               pixmap.height() / 2),
                           pixmap);
-
     }
   }
   else
   {
-    p.setColor(normalColorOut);
-
-    if (selected)
-    {
-      p.setColor(selectedColor);
-    }
-
-    painter->setPen(p);
-    painter->setBrush(Qt::NoBrush);
+    painter->setPen(selected ? colors.selectedPen : colors.pen);
 
     painter->drawPath(cubic);
   }
@@ -288,8 +301,10 @@ paint(QPainter * painter,
 
   double const pointDiameter = connectionStyle.pointDiameter();
 
-  painter->setPen(connectionStyle.constructionColor());
-  painter->setBrush(connectionStyle.constructionColor());
+  QPen const & endPointPen = ConnectionStyleCache::instance().endPointPen();
+
+  painter->setPen(endPointPen);
+  painter->setBrush(endPointPen.color());
   double const pointRadius = pointDiameter / 2.0;
   painter->drawEllipse(cgo.out(), pointRadius, pointRadius);
   painter->drawEllipse(cgo.in(),   pointRadius, pointRadius);
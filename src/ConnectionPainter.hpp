@@ -1,7 +1,9 @@
 #pragma once
 
+#include <QtGui/QColor>
 #include <QtGui/QPainter>
 #include <QtGui/QPainterPath>
+#include <QtGui/QPen>
 
 #include "Definitions.hpp"
 
@@ -21,6 +23,19 @@ public:
 
   static
   QPainterPath getPainterStroke(ConnectionGraphicsObject const & cgo);
+
+  /// Cubic spline of the connection in the item's coordinates.
+  static
+  QPainterPath cubicPath(ConnectionGraphicsObject const & cgo);
+
+  /**
+   * Gives the cached pen of a not selected connection line.
+   * @returns `false` when the line can't be drawn with a single color, i.e.
+   * when the connected ports have different data types.
+   */
+  static
+  bool plainLinePen(ConnectionGraphicsObject const & cgo,
+                    QPen & pen);
 };
 
 }
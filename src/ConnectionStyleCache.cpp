@@ -0,0 +1,197 @@
+#include "ConnectionStyleCache.hpp"
+
+#include <QtGui/QIcon>
+
+#include "ConnectionStyle.hpp"
+#include "StyleCollection.hpp"
+
+
+namespace QtNodes
+{
+
+ConnectionStyleCache::
+ConnectionStyleCache()
+  : _pensValid(false)
+  , _convertPixmapValid(false)
+  , _generation(0)
+{}
+
+
+ConnectionStyleCache &
+ConnectionStyleCache::
+instance()
+{
+  static ConnectionStyleCache cache;
+
+  return cache;
+}
+
+
+void
+ConnectionStyleCache::
+invalidate()
+{
+  instance().clear();
+}
+
+
+QPen const &
+ConnectionStyleCache::
+normalPen()
+{
+  ensurePens();
+
+  return _normalPen;
+}
+
+
+QPen const &
+ConnectionStyleCache::
+selectedPen()
+{
+  ensurePens();
+
+  return _selectedPen;
+}
+
+
+QPen const &
+ConnectionStyleCache::
+selectedHaloPen()
+{
+  ensurePens();
+
+  return _selectedHaloPen;
+}
+
+
+QPen const &
+ConnectionStyleCache::
+hoveredHaloPen()
+{
+  ensurePens();
+
+  return _hoveredHaloPen;
+}
+
+
+QPen const &
+ConnectionStyleCache::
+sketchPen()
+{
+  ensurePens();
+
+  return _sketchPen;
+}
+
+
+QPen const &
+ConnectionStyleCache::
+endPointPen()
+{
+  ensurePens();
+
+  return _endPointPen;
+}
+
+
+ConnectionStyleCache::TypeResources const &
+ConnectionStyleCache::
+typeResources(NodeDataType const & dataType)
+{
+  NodeDataTypeHandle const handle = dataType.handle();
+
+  if (handle >= _typeResources.size())
+  {
+    _typeResources.resize(handle + 1);
+    _typeResourcesValid.resize(handle + 1, false);
+  }
+
+  if (!_typeResourcesValid[handle])
+  {
+    auto const &connectionStyle = StyleCollection::connectionStyle();
+
+    TypeResources & resources = _typeResources[handle];
+
+    resources.color = connectionStyle.normalColor(dataType.id);
+
+    resources.pen = normalPen();
+    resources.pen.setColor(resources.color);
+
+    resources.selectedPen = normalPen();
+    resources.selectedPen.setColor(resources.color.darker(200));
+
+    _typeResourcesValid[handle] = true;
+  }
+
+  return _typeResources[handle];
+}
+
+
+QPixmap const &
+ConnectionStyleCache::
+convertPixmap()
+{
+  if (!_convertPixmapValid)
+  {
+    QIcon icon(":convert.png");
+
+    _convertPixmap = icon.pixmap(QSize(22, 22));
+
+    _convertPixmapValid = true;
+  }
+
+  return _convertPixmap;
+}
+
+
+void
+ConnectionStyleCache::
+ensurePens()
+{
+  if (_pensValid)
+    return;
+
+  auto const &connectionStyle = StyleCollection::connectionStyle();
+
+  double const lineWidth = connectionStyle.lineWidth();
+
+  _normalPen = QPen(connectionStyle.normalColor());
+  _normalPen.setWidth(lineWidth);
+
+  _selectedPen = _normalPen;
+  _selectedPen.setColor(connectionStyle.selectedColor());
+
+  _selectedHaloPen = QPen(connectionStyle.selectedHaloColor());
+  _selectedHaloPen.setWidth(2 * lineWidth);
+
+  _hoveredHaloPen = QPen(connectionStyle.hoveredColor());
+  _hoveredHaloPen.setWidth(2 * lineWidth);
+
+  _sketchPen = QPen(connectionStyle.constructionColor());
+  _sketchPen.setWidth(connectionStyle.constructionLineWidth());
+  _sketchPen.setStyle(Qt::DashLine);
+
+  _endPointPen = QPen(connectionStyle.constructionColor());
+
+  _pensValid = true;
+}
+
+
+void
+ConnectionStyleCache::
+clear()
+{
+  _pensValid = false;
+
+  _typeResources.clear();
+  _typeResourcesValid.clear();
+
+  _convertPixmapValid = false;
+  _convertPixmap = QPixmap();
+
+  ++_generation;
+}
+
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QColor>
+#include <QtGui/QPen>
+#include <QtGui/QPixmap>
+
+#include <vector>
+
+#include "NodeData.hpp"
+
+namespace QtNodes
+{
+
+class ConnectionStyle;
+
+/// Painting resources derived from the current ConnectionStyle.
+/**
+ * The cache keeps everything that ConnectionPainter would otherwise rebuild
+ * on each paint call: the pens, the colors computed for data types and the
+ * rasterized "convert" icon.
+ *
+ * The content is dropped by `StyleCollection::setConnectionStyle`.
+ */
+class ConnectionStyleCache
+{
+public:
+  struct TypeResources
+  {
+    QColor color;
+    QPen   pen;
+    QPen   selectedPen;
+  };
+
+public:
+  static
+  ConnectionStyleCache & instance();
+
+  /// Drops all the cached resources.
+  static
+  void invalidate();
+
+public:
+  /// Pen for a line in `NormalColor`.
+  QPen const &
+  normalPen();
+
+  /// Pen for a selected line in `SelectedColor`.
+  QPen const &
+  selectedPen();
+
+  /// Wide pen drawing a halo behind selected connections.
+  QPen const &
+  selectedHaloPen();
+
+  /// Wide pen drawing a halo behind hovered connections.
+  QPen const &
+  hoveredHaloPen();
+
+  /// Dashed pen for the connection being constructed.
+  QPen const &
+  sketchPen();
+
+  /// Pen for the end points, they are filled with its color.
+  QPen const &
+  endPointPen();
+
+  /// Color and pens for the given data type, looked up by its handle.
+  /// The reference is valid until the next call.
+  TypeResources const &
+  typeResources(NodeDataType const & dataType);
+
+  /// Icon drawn in the middle of connections converting data types.
+  QPixmap const &
+  convertPixmap();
+
+  /// Changes each time the cache is dropped.
+  unsigned
+  generation() const { return _generation; }
+
+private:
+  ConnectionStyleCache();
+
+  ConnectionStyleCache(ConnectionStyleCache const &) = delete;
+
+  ConnectionStyleCache & operator=(ConnectionStyleCache const &) = delete;
+
+  void
+  ensurePens();
+
+  void
+  clear();
+
+private:
+  bool _pensValid;
+
+  QPen _normalPen;
+  QPen _selectedPen;
+  QPen _selectedHaloPen;
+  QPen _hoveredHaloPen;
+  QPen _sketchPen;
+  QPen _endPointPen;
+
+  /// Indexed by NodeDataTypeHandle.
+  std::vector<TypeResources> _typeResources;
+
+  std::vector<bool> _typeResourcesValid;
+
+  bool _convertPixmapValid;
+
+  QPixmap _convertPixmap;
+
+  unsigned _generation;
+};
+
+}
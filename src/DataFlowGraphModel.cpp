@@ -3,15 +3,82 @@
 
 #include <QJsonArray>
 
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
 namespace QtNodes
 {
 
+namespace
+{
+
+/// Orders the edges of a node by port.
+struct PortLess
+{
+  template<typename Edge>
+  bool
+  operator()(Edge const & edge, std::pair<PortType, PortIndex> const & port) const
+  {
+    return std::tie(edge.portType, edge.portIndex) < std::tie(port.first, port.second);
+  }
+
+  template<typename Edge>
+  bool
+  operator()(std::pair<PortType, PortIndex> const & port, Edge const & edge) const
+  {
+    return std::tie(port.first, port.second) < std::tie(edge.portType, edge.portIndex);
+  }
+};
+
+
+/// Orders the edges of a node by port, then by the other side.
+struct EdgeLess
+{
+  template<typename Edge>
+  bool
+  operator()(Edge const & a, Edge const & b) const
+  {
+    return std::tie(a.portType, a.portIndex, a.otherNodeId, a.otherPortIndex) <
+           std::tie(b.portType, b.portIndex, b.otherNodeId, b.otherPortIndex);
+  }
+};
+
+
+template<typename Edge>
+bool
+sameEdge(Edge const & a, Edge const & b)
+{
+  return !EdgeLess()(a, b) && !EdgeLess()(b, a);
+}
+
+
+template<typename Edge>
+ConnectionId
+edgeConnectionId(NodeId const nodeId, Edge const & edge)
+{
+  ConnectionId connectionId{nodeId,
+                            edge.portIndex,
+                            edge.otherNodeId,
+                            edge.otherPortIndex};
+
+  if (edge.portType == PortType::In)
+    invertConnection(connectionId);
+
+  return connectionId;
+}
+
+}
+
 
 DataFlowGraphModel::
 DataFlowGraphModel(std::shared_ptr<NodeDelegateModelRegistry> registry)
   : _registry(std::move(registry))
   , _nextNodeId{0}
-{}
+{
+  connect(this, &AbstractGraphModel::nodeUpdated,
+          this, &DataFlowGraphModel::onNodeUpdated);
+}
 
 
 std::unordered_set<NodeId>
@@ -19,12 +86,10 @@ DataFlowGraphModel::
 allNodeIds() const
 {
   std::unordered_set<NodeId> nodeIds;
-  for_each(_models.begin(), _models.end(),
-           [&nodeIds](auto const& p)
-           {
-             nodeIds.insert(p.first);
+  nodeIds.reserve(_nodes.size());
 
-           });
+  for (auto const & entry : _nodes)
+    nodeIds.insert(entry.id);
 
   return nodeIds;
 }
@@ -36,28 +101,14 @@ allConnectionIds(NodeId const nodeId) const
 {
   std::unordered_set<ConnectionId> result;
 
-  for (auto& c : _connectivity)
-  {
-    if (std::get<0>(c.first) != nodeId)
-      continue;
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return result;
 
-    PortType const portType = std::get<1>(c.first);
-    PortIndex const portIndex = std::get<2>(c.first);
+  result.reserve(entry->edges.size());
 
-    for (auto& target : c.second)
-    {
-      ConnectionId conn{nodeId,
-                        portIndex,
-                        target.first,
-                        target.second};
-
-      if (portType == PortType::In)
-      {
-        invertConnection(conn);
-      }
-      result.insert(conn);
-    }
-  }
+  for (auto const & edge : entry->edges)
+    result.insert(edgeConnectionId(nodeId, edge));
 
   return result;
 }
@@ -71,26 +122,10 @@ connections(NodeId    nodeId,
 {
   std::unordered_set<ConnectionId> result;
 
-  auto const key = std::make_tuple(nodeId, portType, portIndex);
-
-  auto it = _connectivity.find(key);
+  auto const range = portEdges(nodeId, portType, portIndex);
 
-  if (it != _connectivity.end())
-  {
-    for (auto& nodeAndPort : it->second)
-    {
-      ConnectionId conn{nodeId,
-                        portIndex,
-                        nodeAndPort.first,
-                        nodeAndPort.second};
-
-      if (portType == PortType::In)
-      {
-        invertConnection(conn);
-      }
-      result.insert(conn);
-    }
-  }
+  for (auto edge = range.first; edge != range.second; ++edge)
+    result.insert(edgeConnectionId(nodeId, *edge));
 
   return result;
 }
@@ -100,12 +135,18 @@ bool
 DataFlowGraphModel::
 connectionExists(ConnectionId const connectionId) const
 {
-  auto key =
-    std::make_tuple(getNodeId(PortType::Out, connectionId),
-                    PortType::Out,
-                    getPortIndex(PortType::Out, connectionId));
+  NodeEntry const * entry = _nodes.find(connectionId.outNodeId);
+  if (!entry)
+    return false;
 
-  return (_connectivity.find(key) != _connectivity.end());
+  PortEdge const edge{PortType::Out,
+                      connectionId.outPortIndex,
+                      connectionId.inNodeId,
+                      connectionId.inPortIndex};
+
+  auto it = std::lower_bound(entry->edges.begin(), entry->edges.end(), edge, EdgeLess());
+
+  return it != entry->edges.end() && sameEdge(*it, edge);
 }
 
 
@@ -117,13 +158,16 @@ addNode(QString const nodeType)
 
   if (model)
   {
-    NodeId newId = newNodeId();
+    NodeId newId = _nextNodeId++;
 
     connect(model.get(), &NodeDelegateModel::dataUpdated,
             [newId, this](PortIndex const portIndex)
             { onOutPortDataUpdated(newId, portIndex); });
 
-    _models[newId] = std::move(model);
+    _nodes.insert(newId, NodeEntry{std::move(model), NodeGeometryData{}});
+
+    markSnapshotDirty(newId, *_nodes.find(newId));
+    updateSnapshotGeometry(newId);
 
     Q_EMIT nodeCreated(newId);
 
@@ -138,6 +182,14 @@ bool
 DataFlowGraphModel::
 connectionPossible(ConnectionId const connectionId) const
 {
+  NodeDelegateModel * outModel = delegate(connectionId.outNodeId);
+  NodeDelegateModel * inModel  = delegate(connectionId.inNodeId);
+
+  if (!outModel || !inModel)
+    return false;
+
+  // Types and policies go through the virtual portData() so that derived
+  // models can override them.
   auto getDataType =
     [&](PortType const portType)
     {
@@ -145,25 +197,44 @@ connectionPossible(ConnectionId const connectionId) const
                       portType,
                       getPortIndex(portType, connectionId),
                       PortRole::DataType).value<NodeDataType>();
-
     };
 
   auto portVacant =
     [&](PortType const portType)
     {
-      NodeId const nodeId = getNodeId(portType, connectionId);
+      NodeId const    nodeId    = getNodeId(portType, connectionId);
       PortIndex const portIndex = getPortIndex(portType, connectionId);
-      auto const connected = connections(nodeId, portType, portIndex);
+
+      auto const range = portEdges(nodeId, portType, portIndex);
+
+      if (range.first == range.second)
+        return true;
 
       auto policy = portData(nodeId,
                              portType,
                              portIndex,
                              PortRole::ConnectionPolicyRole).value<ConnectionPolicy>();
 
-      return connected.empty() || (policy == ConnectionPolicy::Many);
+      return policy == ConnectionPolicy::Many;
     };
 
-  return getDataType(PortType::Out).id == getDataType(PortType::In).id &&
+  NodeDataType const outType = getDataType(PortType::Out);
+  NodeDataType const inType  = getDataType(PortType::In);
+
+  bool const outStream =
+    outModel->portStreamCapacity(PortType::Out, connectionId.outPortIndex) > 0;
+  bool const inStream =
+    inModel->portStreamCapacity(PortType::In, connectionId.inPortIndex) > 0;
+
+  // Chunks are pushed as they are, converters only apply to snapshots.
+  bool const typesCompatible =
+    outType.handle() == inType.handle() ||
+    (!outStream && _registry->hasTypeConverter(outType, inType));
+
+  // A stream can't be connected to a snapshot port and vice versa.
+  bool const kindsCompatible = outStream == inStream;
+
+  return typesCompatible && kindsCompatible &&
          portVacant(PortType::Out) && portVacant(PortType::In);
 }
 
@@ -172,26 +243,54 @@ void
 DataFlowGraphModel::
 addConnection(ConnectionId const connectionId)
 {
+  if (!insertConnection(connectionId))
+    return;
+
+  if (openChannel(connectionId))
+    return;
+
+  onOutPortDataUpdated(getNodeId(PortType::Out, connectionId),
+                       getPortIndex(PortType::Out, connectionId));
+}
+
+
+bool
+DataFlowGraphModel::
+insertConnection(ConnectionId const connectionId)
+{
+  NodeEntry * outEntry = _nodes.find(connectionId.outNodeId);
+  NodeEntry * inEntry  = _nodes.find(connectionId.inNodeId);
+
+  // The edges are stored by the nodes, a dangling connection has no place.
+  if (!outEntry || !inEntry)
+    return false;
+
   auto connect =
-    [&](PortType portType)
+    [&](NodeEntry & entry, PortType portType)
     {
-      auto key = ConnectivityKey{getNodeId(portType, connectionId),
-                                 portType,
-                                 getPortIndex(portType, connectionId)};
-
       PortType opposite = oppositePort(portType);
 
-      _connectivity[key].insert(std::make_pair(getNodeId(opposite, connectionId),
-                                               getPortIndex(opposite, connectionId)));
+      PortEdge const edge{portType,
+                          getPortIndex(portType, connectionId),
+                          getNodeId(opposite, connectionId),
+                          getPortIndex(opposite, connectionId)};
+
+      auto it = std::lower_bound(entry.edges.begin(), entry.edges.end(), edge, EdgeLess());
+
+      if (it == entry.edges.end() || !sameEdge(*it, edge))
+        entry.edges.insert(it, edge);
     };
 
-  connect(PortType::Out);
-  connect(PortType::In);
+  connect(*outEntry, PortType::Out);
+  connect(*inEntry, PortType::In);
+
+  resolveConversion(connectionId);
+
+  _snapshotConnections.insert(connectionId, true);
 
   Q_EMIT connectionCreated(connectionId);
 
-  onOutPortDataUpdated(getNodeId(PortType::Out, connectionId),
-                       getPortIndex(PortType::Out, connectionId));
+  return true;
 }
 
 
@@ -199,7 +298,7 @@ bool
 DataFlowGraphModel::
 nodeExists(NodeId const nodeId) const
 {
-  return (_models.find(nodeId) != _models.end());
+  return _nodes.contains(nodeId);
 }
 
 
@@ -209,11 +308,11 @@ nodeData(NodeId nodeId, NodeRole role) const
 {
   QVariant result;
 
-  auto it = _models.find(nodeId);
-  if (it == _models.end())
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
     return result;
 
-  auto& model = it->second;
+  auto& model = entry->model;
 
   switch (role)
   {
@@ -222,11 +321,11 @@ nodeData(NodeId nodeId, NodeRole role) const
       break;
 
     case NodeRole::Position:
-      result = _nodeGeometryData[nodeId].pos;
+      result = entry->geometry.pos;
       break;
 
     case NodeRole::Size:
-      result = _nodeGeometryData[nodeId].size;
+      result = entry->geometry.size;
       break;
 
     case NodeRole::CaptionVisible:
@@ -248,7 +347,7 @@ nodeData(NodeId nodeId, NodeRole role) const
     {
       QJsonObject nodeJson;
 
-      nodeJson["internal-data"] = _models.at(nodeId)->save();
+      nodeJson["internal-data"] = model->save();
 
       result = nodeJson.toVariantMap();
       break;
@@ -265,9 +364,21 @@ nodeData(NodeId nodeId, NodeRole role) const
     case NodeRole::Widget:
     {
       auto w = model->embeddedWidget();
+      entry->widget = w;
       result = QVariant::fromValue(w);
     }
     break;
+
+    case NodeRole::WidgetSize:
+    {
+      // Offscreen nodes of lazily embedding scenes don't create the widget.
+      // Without a hint the geometry falls back to the widget itself.
+      QSize const hint = model->embeddedWidgetSizeHint();
+
+      if (!entry->widget && hint.isValid())
+        result = hint;
+    }
+    break;
   }
 
   return result;
@@ -278,9 +389,9 @@ NodeFlags
 DataFlowGraphModel::
 nodeFlags(NodeId nodeId) const
 {
-  auto it = _models.find(nodeId);
+  NodeDelegateModel * model = delegate(nodeId);
 
-  if (it != _models.end() && it->second->resizable())
+  if (model && model->resizable())
     return NodeFlag::Resizable;
 
   return NodeFlag::NoFlags;
@@ -293,19 +404,21 @@ setNodeData(NodeId   nodeId,
             NodeRole role,
             QVariant value)
 {
-  Q_UNUSED(nodeId);
-  Q_UNUSED(role);
-  Q_UNUSED(value);
-
   bool result = false;
 
+  NodeEntry * entry = _nodes.find(nodeId);
+  if (!entry)
+    return result;
+
   switch (role)
   {
     case NodeRole::Type:
       break;
     case NodeRole::Position:
     {
-      _nodeGeometryData[nodeId].pos = value.value<QPointF>();
+      entry->geometry.pos = value.value<QPointF>();
+
+      updateSnapshotGeometry(nodeId);
 
       Q_EMIT nodePositionUpdated(nodeId);
 
@@ -315,7 +428,10 @@ setNodeData(NodeId   nodeId,
 
     case NodeRole::Size:
     {
-      _nodeGeometryData[nodeId].size = value.value<QSize>();
+      entry->geometry.size = value.value<QSize>();
+
+      updateSnapshotGeometry(nodeId);
+
       result = true;
     }
     break;
@@ -340,6 +456,9 @@ setNodeData(NodeId   nodeId,
 
     case NodeRole::Widget:
       break;
+
+    case NodeRole::WidgetSize:
+      break;
   }
 
   return result;
@@ -355,12 +474,10 @@ portData(NodeId    nodeId,
 {
   QVariant result;
 
-  auto it = _models.find(nodeId);
-  if (it == _models.end())
+  NodeDelegateModel * model = delegate(nodeId);
+  if (!model)
     return result;
 
-  auto& model = it->second;
-
   switch (role)
   {
     case PortRole::Data:
@@ -369,7 +486,9 @@ portData(NodeId    nodeId,
       break;
 
     case PortRole::DataType:
-      result = QVariant::fromValue(model->dataType(portType, portIndex));
+      result = QVariant::fromValue(portDataType(*_nodes.find(nodeId),
+                                                portType,
+                                                portIndex));
       break;
 
     case PortRole::ConnectionPolicyRole:
@@ -392,6 +511,40 @@ portData(NodeId    nodeId,
 }
 
 
+NodeDataType
+DataFlowGraphModel::
+portDataType(NodeEntry const & entry,
+             PortType const    portType,
+             PortIndex const   portIndex) const
+{
+  if (portType == PortType::None)
+    return NodeDataType();
+
+  auto & types = portType == PortType::In ? entry.inTypes : entry.outTypes;
+
+  unsigned int const nPorts = entry.model->nPorts(portType);
+
+  // Delegates build a fresh type on every call, so they are asked once and
+  // every compatibility check or style lookup reuses the interned copy.
+  if (types.size() != nPorts)
+  {
+    types.clear();
+    types.reserve(nPorts);
+
+    for (PortIndex i = 0; i < nPorts; ++i)
+    {
+      types.push_back(entry.model->dataType(portType, i));
+      types.back().handle();
+    }
+  }
+
+  if (portIndex >= types.size())
+    return entry.model->dataType(portType, portIndex);
+
+  return types[portIndex];
+}
+
+
 bool
 DataFlowGraphModel::
 setPortData(NodeId          nodeId,
@@ -400,29 +553,19 @@ setPortData(NodeId          nodeId,
             QVariant const& value,
             PortRole        role)
 {
-  Q_UNUSED(nodeId);
-
-
-  QVariant result;
-
-  auto it = _models.find(nodeId);
-  if (it == _models.end())
+  if (!nodeExists(nodeId))
     return false;
 
-  auto& model = it->second;
-
   switch (role)
   {
     case PortRole::Data:
       if (portType == PortType::In)
       {
-        model->setInData(value.value<std::shared_ptr<NodeData>>(),
-                         portIndex);
+        setInPortData(nodeId,
+                      portIndex,
+                      value.value<std::shared_ptr<NodeData>>());
 
-        // Triggers repainting on the scene.
-        Q_EMIT inPortDataWasSet(nodeId,
-                                portType,
-                                portIndex);
+        return true;
       }
       break;
 
@@ -430,7 +573,6 @@ setPortData(NodeId          nodeId,
       break;
   }
 
-
   return false;
 }
 
@@ -444,28 +586,25 @@ deleteConnection(ConnectionId const connectionId)
   auto disconnect =
     [&](PortType portType)
     {
-      auto key = ConnectivityKey{getNodeId(portType, connectionId),
-                                 portType,
-                                 getPortIndex(portType, connectionId)};
-      auto it = _connectivity.find(key);
+      NodeEntry * entry = _nodes.find(getNodeId(portType, connectionId));
+      if (!entry)
+        return;
 
-      if (it != _connectivity.end())
-      {
-        disconnected = true;
+      PortType opposite = oppositePort(portType);
 
-        PortType opposite = oppositePort(portType);
+      PortEdge const edge{portType,
+                          getPortIndex(portType, connectionId),
+                          getNodeId(opposite, connectionId),
+                          getPortIndex(opposite, connectionId)};
 
-        auto oppositePair =
-          std::make_pair(getNodeId(opposite, connectionId),
-                         getPortIndex(opposite, connectionId));
-        it->second.erase(oppositePair);
+      auto it = std::lower_bound(entry->edges.begin(), entry->edges.end(), edge, EdgeLess());
 
-        if (it->second.empty())
-        {
-          _connectivity.erase(it);
-        }
-      }
+      if (it != entry->edges.end() && sameEdge(*it, edge))
+      {
+        disconnected = true;
 
+        entry->edges.erase(it);
+      }
     };
 
   disconnect(PortType::Out);
@@ -473,10 +612,17 @@ deleteConnection(ConnectionId const connectionId)
 
   if (disconnected)
   {
+    _convertedData.erase(connectionId);
+
+    _snapshotConnections.erase(connectionId);
+
     Q_EMIT connectionDeleted(connectionId);
 
-    propagateEmptyDataTo(getNodeId(PortType::In, connectionId),
-                         getPortIndex(PortType::In, connectionId));
+    if (!closeChannel(connectionId))
+    {
+      propagateEmptyDataTo(getNodeId(PortType::In, connectionId),
+                           getPortIndex(PortType::In, connectionId));
+    }
 
   }
 
@@ -495,8 +641,10 @@ deleteNode(NodeId const nodeId)
     deleteConnection(cId);
   }
 
-  _nodeGeometryData.erase(nodeId);
-  _models.erase(nodeId);
+  _nodes.erase(nodeId);
+
+  _snapshotNodes.erase(nodeId);
+  _snapshotGeometry.erase(nodeId);
 
   Q_EMIT nodeDeleted(nodeId);
 
@@ -512,7 +660,7 @@ saveNode(NodeId const nodeId) const
 
   nodeJson["id"] = static_cast<qint64>(nodeId);
 
-  nodeJson["internal-data"] = _models.at(nodeId)->save();
+  nodeJson["internal-data"] = delegate(nodeId)->save();
 
   {
     QPointF const pos =
@@ -543,21 +691,13 @@ save() const
 
 
   QJsonArray connJsonArray;
-  for (auto const & connPair : _connectivity)
+  for (auto const & entry : _nodes)
   {
-    ConnectivityKey const & key = connPair.first;
-    auto const& otherSideConnections = connPair.second;
-
-    for (auto const & otherSide : otherSideConnections)
+    // Each connection is saved once, from its output side.
+    for (auto const & edge : entry.value.edges)
     {
-      if (std::get<1>(key) == PortType::Out)
-      {
-        connJsonArray.append(
-          saveConnection(ConnectionId{std::get<0>(key),
-                                      std::get<2>(key),
-                                      otherSide.first,
-                                      otherSide.second}));
-      }
+      if (edge.portType == PortType::Out)
+        connJsonArray.append(saveConnection(edgeConnectionId(entry.id, edge)));
     }
   }
   sceneJson["connections"] = connJsonArray;
@@ -587,7 +727,10 @@ loadNode(QJsonObject const & nodeJson)
             [restoredNodeId, this](PortIndex const portIndex)
             { onOutPortDataUpdated(restoredNodeId, portIndex); });
 
-    _models[restoredNodeId] = std::move(model);
+    _nodes.insert(restoredNodeId, NodeEntry{std::move(model), NodeGeometryData{}});
+
+    markSnapshotDirty(restoredNodeId, *_nodes.find(restoredNodeId));
+    updateSnapshotGeometry(restoredNodeId);
 
     Q_EMIT nodeCreated(restoredNodeId);
 
@@ -599,7 +742,37 @@ loadNode(QJsonObject const & nodeJson)
                 NodeRole::Position,
                 pos);
 
-    _models[restoredNodeId]->load(internalDataJson);
+    delegate(restoredNodeId)->load(internalDataJson);
+  }
+}
+
+
+void
+DataFlowGraphModel::
+loadNodes(std::vector<QJsonObject> const &  nodesJson,
+          std::vector<ConnectionId> const & connectionIds)
+{
+  for (QJsonObject const & nodeJson : nodesJson)
+  {
+    loadNode(nodeJson);
+  }
+
+  // Each added connection would propagate to all the connections of its
+  // output port again.
+  std::vector<std::pair<NodeId, PortIndex>> outPorts;
+
+  for (ConnectionId const & connectionId : connectionIds)
+  {
+    if (insertConnection(connectionId) && !openChannel(connectionId))
+      outPorts.emplace_back(connectionId.outNodeId, connectionId.outPortIndex);
+  }
+
+  std::sort(outPorts.begin(), outPorts.end());
+  outPorts.erase(std::unique(outPorts.begin(), outPorts.end()), outPorts.end());
+
+  for (auto const & outPort : outPorts)
+  {
+    onOutPortDataUpdated(outPort.first, outPort.second);
   }
 }
 
@@ -653,39 +826,299 @@ loadConnection(QJsonObject const & connJson)
 }
 
 
+GraphSnapshot
+DataFlowGraphModel::
+snapshot() const
+{
+  for (NodeId const nodeId : _snapshotDirtyNodes)
+  {
+    NodeEntry const * entry = _nodes.find(nodeId);
+
+    // Deleted nodes stay queued, an id reused since is queued twice.
+    if (!entry || !entry->snapshotDirty)
+      continue;
+
+    entry->snapshotDirty = false;
+
+    _snapshotNodes.insert(nodeId, entry->model->save());
+  }
+
+  _snapshotDirtyNodes.clear();
+
+  return GraphSnapshot(_snapshotNodes, _snapshotGeometry, _snapshotConnections);
+}
+
+
+void
+DataFlowGraphModel::
+invalidateSnapshot(NodeId const nodeId)
+{
+  if (NodeEntry const * entry = _nodes.find(nodeId))
+    markSnapshotDirty(nodeId, *entry);
+}
+
+
+void
+DataFlowGraphModel::
+markSnapshotDirty(NodeId const nodeId, NodeEntry const & entry) const
+{
+  if (entry.snapshotDirty)
+    return;
+
+  entry.snapshotDirty = true;
+
+  _snapshotDirtyNodes.push_back(nodeId);
+}
+
+
+std::pair<DataFlowGraphModel::PortEdge const *, DataFlowGraphModel::PortEdge const *>
+DataFlowGraphModel::
+portEdges(NodeId const    nodeId,
+          PortType const  portType,
+          PortIndex const portIndex) const
+{
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return {nullptr, nullptr};
+
+  return std::equal_range(entry->edges.begin(),
+                          entry->edges.end(),
+                          std::make_pair(portType, portIndex),
+                          PortLess());
+}
+
+
+void
+DataFlowGraphModel::
+updateSnapshotGeometry(NodeId const nodeId)
+{
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return;
+
+  _snapshotGeometry.insert(nodeId,
+                           GraphSnapshot::NodeGeometry{entry->geometry.pos,
+                                                       entry->geometry.size});
+}
+
+
 void
 DataFlowGraphModel::
 onOutPortDataUpdated(NodeId const    nodeId,
                      PortIndex const portIndex)
 {
-  std::unordered_set<ConnectionId> const& connected =
-    connections(nodeId, PortType::Out, portIndex);
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return;
+
+  NodeDelegateModel * model = entry->model.get();
+
+  // New output usually means the delegate state has changed as well.
+  markSnapshotDirty(nodeId, *entry);
+
+  // Streaming ports carry chunks, not snapshots.
+  if (model->portStreamCapacity(PortType::Out, portIndex) > 0)
+    return;
+
+  auto const range = portEdges(nodeId, PortType::Out, portIndex);
 
-  QVariant const portDataToPropagate =
-    portData(nodeId, PortType::Out, portIndex, PortRole::Data);
+  if (range.first == range.second)
+    return;
 
-  for (auto const& cn : connected)
+  // Receivers may change the connectivity while handling the data.
+  SmallVector<PortEdge, 2> targets;
+
+  for (auto edge = range.first; edge != range.second; ++edge)
+    targets.push_back(*edge);
+
+  std::shared_ptr<NodeData> data = model->outData(portIndex);
+
+  for (std::size_t i = 0; i < targets.size(); ++i)
   {
-    setPortData(cn.inNodeId, PortType::In,
-                cn.inPortIndex, portDataToPropagate,
-                PortRole::Data);
+    ConnectionId const cn = edgeConnectionId(nodeId, targets[i]);
 
+    // The last receiver takes over our reference.
+    std::shared_ptr<NodeData> inData = (i + 1 == targets.size()) ?
+                                       convertedPortData(cn, std::move(data)) :
+                                       convertedPortData(cn, data);
+
+    setInPortData(cn.inNodeId, cn.inPortIndex, std::move(inData));
   }
 }
 
 
+std::shared_ptr<NodeData>
+DataFlowGraphModel::
+convertedPortData(ConnectionId const        connectionId,
+                  std::shared_ptr<NodeData> outData)
+{
+  auto it = _convertedData.find(connectionId);
+
+  // Dropped by onNodeUpdated() since the last data.
+  if (it == _convertedData.end())
+  {
+    resolveConversion(connectionId);
+
+    it = _convertedData.find(connectionId);
+  }
+
+  ConvertedData & converted = it->second;
+
+  bool const passThrough =
+    converted.outType == converted.inType || !converted.converter;
+
+  if (!outData || passThrough)
+  {
+    converted.source.reset();
+    converted.sourcePointer = nullptr;
+    converted.result.reset();
+
+    return outData;
+  }
+
+  bool const sameSource =
+    converted.sourcePointer == outData.get() &&
+    !converted.source.owner_before(outData) &&
+    !outData.owner_before(converted.source);
+
+  // Output data is replaced rather than modified in place when it changes,
+  // so the same source object always gives the same conversion result.
+  if (!sameSource)
+  {
+    converted.result        = converted.converter(outData);
+    converted.source        = outData;
+    converted.sourcePointer = outData.get();
+  }
+
+  return converted.result;
+}
+
+
+void
+DataFlowGraphModel::
+resolveConversion(ConnectionId const connectionId)
+{
+  // Same lookup as in connectionPossible(), derived models may override it.
+  auto getDataType =
+    [&](PortType const portType)
+    {
+      return portData(getNodeId(portType, connectionId),
+                      portType,
+                      getPortIndex(portType, connectionId),
+                      PortRole::DataType).value<NodeDataType>();
+    };
+
+  NodeDataType const outType = getDataType(PortType::Out);
+  NodeDataType const inType  = getDataType(PortType::In);
+
+  ConvertedData converted;
+  converted.outType = outType.handle();
+  converted.inType  = inType.handle();
+
+  // Connections loaded or added without connectionPossible() may join
+  // different types. Without a converter the data is passed as it is.
+  if (converted.outType != converted.inType)
+    converted.converter = _registry->getTypeConverter(outType, inType);
+
+  _convertedData[connectionId] = std::move(converted);
+}
+
+
+void
+DataFlowGraphModel::
+setInPortData(NodeId const              nodeId,
+              PortIndex const           portIndex,
+              std::shared_ptr<NodeData> data)
+{
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return;
+
+  // Marked first, the delegate may change the graph and move the entries.
+  markSnapshotDirty(nodeId, *entry);
+
+  entry->model->setInData(std::move(data), portIndex);
+
+  // Triggers repainting on the scene.
+  Q_EMIT inPortDataWasSet(nodeId,
+                          PortType::In,
+                          portIndex);
+}
+
+
+bool
+DataFlowGraphModel::
+openChannel(ConnectionId const connectionId)
+{
+  NodeDelegateModel * outModel = delegate(connectionId.outNodeId);
+  NodeDelegateModel * inModel  = delegate(connectionId.inNodeId);
+
+  if (!outModel || !inModel)
+    return false;
+
+  unsigned int const capacity =
+    inModel->portStreamCapacity(PortType::In, connectionId.inPortIndex);
+
+  if (capacity == 0 ||
+      outModel->portStreamCapacity(PortType::Out, connectionId.outPortIndex) == 0)
+    return false;
+
+  auto channel = std::make_shared<NodeDataChannel>(capacity);
+
+  _channels[connectionId] = channel;
+
+  outModel->attachOutChannel(connectionId.outPortIndex, channel);
+  inModel->setInChannel(channel, connectionId.inPortIndex);
+
+  return true;
+}
+
+
+bool
+DataFlowGraphModel::
+closeChannel(ConnectionId const connectionId)
+{
+  auto it = _channels.find(connectionId);
+  if (it == _channels.end())
+    return false;
+
+  std::shared_ptr<NodeDataChannel> channel = std::move(it->second);
+  _channels.erase(it);
+
+  channel->close();
+
+  if (NodeDelegateModel * outModel = delegate(connectionId.outNodeId))
+    outModel->detachOutChannel(connectionId.outPortIndex, channel);
+
+  if (NodeDelegateModel * inModel = delegate(connectionId.inNodeId))
+    inModel->setInChannel(nullptr, connectionId.inPortIndex);
+
+  return true;
+}
+
+
 void
 DataFlowGraphModel::
 propagateEmptyDataTo(NodeId const    nodeId,
                      PortIndex const portIndex)
 {
-  QVariant emptyData{};
+  setInPortData(nodeId, portIndex, nullptr);
+}
+
+
+void
+DataFlowGraphModel::
+onNodeUpdated(NodeId const nodeId)
+{
+  NodeEntry const * entry = _nodes.find(nodeId);
+  if (!entry)
+    return;
+
+  entry->inTypes.clear();
+  entry->outTypes.clear();
 
-  setPortData(nodeId,
-              PortType::In,
-              portIndex,
-              emptyData,
-              PortRole::Data);
+  for (auto const & edge : entry->edges)
+    _convertedData.erase(edgeConnectionId(nodeId, edge));
 }
 
 
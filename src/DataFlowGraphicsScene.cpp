@@ -51,22 +51,7 @@ std::vector<NodeId>
 DataFlowGraphicsScene::
 selectedNodes() const
 {
-  QList<QGraphicsItem*> graphicsItems = selectedItems();
-
-  std::vector<NodeId> result;
-  result.reserve(graphicsItems.size());
-
-  for (QGraphicsItem* item : graphicsItems)
-  {
-    auto ngo = qgraphicsitem_cast<NodeGraphicsObject*>(item);
-
-    if (ngo != nullptr)
-    {
-      result.push_back(ngo->nodeId());
-    }
-  }
-
-  return result;
+  return std::vector<NodeId>(selectedNodeIds().begin(), selectedNodeIds().end());
 }
 
 
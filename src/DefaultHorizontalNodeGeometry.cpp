@@ -42,9 +42,11 @@ recomputeSize(NodeId const nodeId) const
 {
   unsigned int height = maxVerticalPortsExtent(nodeId);
 
-  if (auto w = _graphModel.nodeData<QWidget*>(nodeId, NodeRole::Widget))
+  QSize const wSize = widgetSize(nodeId);
+
+  if (wSize.isValid())
   {
-    height = std::max(height, static_cast<unsigned int>(w->height()));
+    height = std::max(height, static_cast<unsigned int>(wSize.height()));
   }
 
   QRectF const capRect = captionRect(nodeId);
@@ -59,9 +61,9 @@ recomputeSize(NodeId const nodeId) const
 
   unsigned int width = inPortWidth + outPortWidth + 4 * _portSpasing;
 
-  if (auto w = _graphModel.nodeData<QWidget*>(nodeId, NodeRole::Widget))
+  if (wSize.isValid())
   {
-    width += w->width();
+    width += wSize.width();
   }
 
   width = std::max(width, static_cast<unsigned int>(capRect.width()));
@@ -186,7 +188,7 @@ widgetPosition(NodeId const nodeId) const
 
   unsigned int captionHeight = captionRect(nodeId).height();
 
-  if (auto w = _graphModel.nodeData<QWidget*>(nodeId, NodeRole::Widget))
+  if (auto w = createdWidget(nodeId))
   {
     // If the widget wants to use as much vertical space as possible,
     // place it immediately after the caption.
@@ -200,6 +202,15 @@ widgetPosition(NodeId const nodeId) const
                      (captionHeight + size.height() - w->height()) / 2.0);
     }
   }
+
+  // Not embedded yet, the size policy is unknown until the widget exists.
+  QSize const wSize = widgetSize(nodeId);
+
+  if (wSize.isValid())
+  {
+    return QPointF(_portSpasing + maxPortsTextAdvance(nodeId, PortType::In),
+                   (captionHeight + size.height() - wSize.height()) / 2.0);
+  }
   return QPointF();
 
 }
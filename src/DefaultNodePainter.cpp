@@ -1,19 +1,143 @@
 #include "DefaultNodePainter.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <QtCore/QMargins>
+#include <QtGui/QImage>
+#include <QtGui/QPixmapCache>
+#include <QtWidgets/qdrawutil.h>
 
 #include "AbstractGraphModel.hpp"
 #include "AbstractNodeGeometry.hpp"
 #include "BasicGraphicsScene.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "ConnectionStyleCache.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "NodeState.hpp"
 #include "StyleCollection.hpp"
 
 
+namespace
+{
+
+/// Blur radius and offset of the painted node shadow.
+int const shadowBlurRadius = 6;
+
+QPoint const shadowOffset(3, 3);
+
+
+/// One horizontal and one vertical running-sum pass over an alpha mask.
+void
+boxBlur(std::vector<int> & alpha, int const width, int const height, int const radius)
+{
+  std::vector<int> tmp(alpha.size());
+
+  int const window = 2 * radius + 1;
+
+  auto pass =
+    [&](std::vector<int> const & src, std::vector<int> & dst,
+        int const lines, int const length, int const lineStep, int const step)
+    {
+      for (int l = 0; l < lines; ++l)
+      {
+        int const base = l * lineStep;
+
+        int sum = 0;
+        for (int i = -radius; i <= radius; ++i)
+        {
+          sum += src[base + std::min(std::max(i, 0), length - 1) * step];
+        }
+
+        for (int i = 0; i < length; ++i)
+        {
+          dst[base + i * step] = sum / window;
+
+          int const out = std::max(i - radius, 0);
+          int const in  = std::min(i + radius + 1, length - 1);
+
+          sum += src[base + in * step] - src[base + out * step];
+        }
+      }
+    };
+
+  pass(alpha, tmp, height, width, width, 1);
+  pass(tmp, alpha, width, height, 1, width);
+}
+
+
+/**
+ * Shadow of a rounded rectangle, blurred once and stretched with
+ * `qDrawBorderPixmap` to any node size. The nine slices make the texture
+ * independent of the node size, so it is cached per color and corner radius.
+ */
+QPixmap
+shadowTexture(QColor const & color, int const cornerRadius)
+{
+  QString const key = QStringLiteral("QtNodes::NodeShadow/%1/%2/%3")
+                      .arg(color.rgba())
+                      .arg(cornerRadius)
+                      .arg(shadowBlurRadius);
+
+  QPixmap pixmap;
+  if (QPixmapCache::find(key, &pixmap))
+    return pixmap;
+
+  int const b    = shadowBlurRadius;
+  int const side = 2 * (2 * b + cornerRadius) + 1;
+
+  QImage image(side, side, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+
+  {
+    QPainter p(&image);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(Qt::NoPen);
+    p.setBrush(Qt::black);
+    p.drawRoundedRect(QRectF(b, b, side - 2 * b, side - 2 * b),
+                      cornerRadius, cornerRadius);
+  }
+
+  std::vector<int> alpha(side * side);
+  for (int y = 0; y < side; ++y)
+  {
+    QRgb const * line = reinterpret_cast<QRgb const *>(image.constScanLine(y));
+    for (int x = 0; x < side; ++x)
+    {
+      alpha[y * side + x] = qAlpha(line[x]);
+    }
+  }
+
+  // Three box passes are close enough to a gaussian.
+  int const passRadius = std::max(1, b / 2);
+  for (int i = 0; i < 3; ++i)
+  {
+    boxBlur(alpha, side, side, passRadius);
+  }
+
+  for (int y = 0; y < side; ++y)
+  {
+    QRgb * line = reinterpret_cast<QRgb *>(image.scanLine(y));
+    for (int x = 0; x < side; ++x)
+    {
+      int const a = alpha[y * side + x] * color.alpha() / 255;
+
+      line[x] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), a));
+    }
+  }
+
+  pixmap = QPixmap::fromImage(image);
+
+  QPixmapCache::insert(key, pixmap);
+
+  return pixmap;
+}
+
+}
+
+
 namespace QtNodes
 {
 
@@ -87,6 +211,23 @@ drawNodeRect(QPainter * painter,
 
   double const radius = 3.0;
 
+  if (nodeStyle.Shadow == NodeStyle::ShadowMode::Painted)
+  {
+    int const cornerRadius = static_cast<int>(radius);
+    int const margin       = 2 * shadowBlurRadius + cornerRadius;
+
+    QRect const target =
+      boundary.toRect().translated(shadowOffset).adjusted(-shadowBlurRadius,
+                                                          -shadowBlurRadius,
+                                                          shadowBlurRadius,
+                                                          shadowBlurRadius);
+
+    qDrawBorderPixmap(painter,
+                      target,
+                      QMargins(margin, margin, margin, margin),
+                      shadowTexture(nodeStyle.ShadowColor, cornerRadius));
+  }
+
   painter->drawRoundedRect(boundary, radius, radius);
 }
 
@@ -171,7 +312,7 @@ drawConnectionPoints(QPainter * painter,
 
       if (connectionStyle.useDataDefinedColors())
       {
-        painter->setBrush(connectionStyle.normalColor(dataType.id));
+        painter->setBrush(ConnectionStyleCache::instance().typeResources(dataType).color);
       }
       else
       {
@@ -232,7 +373,7 @@ drawFilledConnectionPoints(QPainter * painter,
         auto const &connectionStyle = StyleCollection::connectionStyle();
         if (connectionStyle.useDataDefinedColors())
         {
-          QColor const c = connectionStyle.normalColor(dataType.id);
+          QColor const c = ConnectionStyleCache::instance().typeResources(dataType).color;
           painter->setPen(c);
           painter->setBrush(c);
         }
@@ -0,0 +1,552 @@
+#include "GraphJournal.hpp"
+
+#include "DataFlowGraphModel.hpp"
+#include "NodeDelegateModel.hpp"
+
+#include <QtCore/QCborMap>
+#include <QtCore/QCborValue>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimer>
+
+#include <vector>
+
+
+namespace
+{
+
+using QtNodes::ConnectionId;
+using QtNodes::NodeId;
+using QtNodes::PortIndex;
+
+/// "QNJ1"
+quint32 const journalMagic = 0x514E4A31;
+
+/// Frame size and checksum.
+qint64 const frameHeaderSize = sizeof(quint32) + sizeof(quint16);
+
+enum class RecordType : quint8
+{
+  NodeRemoved       = 1,
+  NodeData          = 2, ///< Creates the node or replaces its internal data.
+  NodePosition      = 3,
+  ConnectionAdded   = 4,
+  ConnectionRemoved = 5,
+};
+
+
+QString
+journalPathOf(QString const & documentPath)
+{
+  return documentPath + QStringLiteral(".journal");
+}
+
+
+void
+setStreamVersion(QDataStream & stream)
+{
+  stream.setVersion(QDataStream::Qt_5_15);
+}
+
+
+quint16
+checksum(QByteArray const & data)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  return qChecksum(data);
+#else
+  return qChecksum(data.constData(), static_cast<uint>(data.size()));
+#endif
+}
+
+
+void
+writeConnection(QDataStream & out, RecordType const type, ConnectionId const & cid)
+{
+  out << static_cast<quint8>(type)
+      << static_cast<quint32>(cid.outNodeId)
+      << static_cast<quint32>(cid.outPortIndex)
+      << static_cast<quint32>(cid.inNodeId)
+      << static_cast<quint32>(cid.inPortIndex);
+}
+
+
+ConnectionId
+readConnection(QDataStream & in)
+{
+  quint32 outNodeId = 0, outPortIndex = 0, inNodeId = 0, inPortIndex = 0;
+  in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
+
+  return ConnectionId{static_cast<NodeId>(outNodeId),
+                      static_cast<PortIndex>(outPortIndex),
+                      static_cast<NodeId>(inNodeId),
+                      static_cast<PortIndex>(inPortIndex)};
+}
+
+}
+
+
+namespace QtNodes
+{
+
+GraphJournal::
+GraphJournal(DataFlowGraphModel & graphModel,
+             QObject *            parent)
+  : QObject(parent)
+  , _graphModel(graphModel)
+  , _flushTimer(new QTimer(this))
+  , _compactionThreshold(16 * 1024 * 1024)
+{
+  _flushTimer->setInterval(1000);
+
+  connect(_flushTimer, &QTimer::timeout, this, &GraphJournal::flush);
+}
+
+
+GraphJournal::
+~GraphJournal()
+{
+  close();
+}
+
+
+bool
+GraphJournal::
+open(QString const & documentPath)
+{
+  close();
+
+  QFile base(documentPath);
+
+  QJsonObject baseDocument;
+
+  if (base.exists())
+  {
+    if (!base.open(QIODevice::ReadOnly))
+      return false;
+
+    QJsonParseError error;
+
+    QJsonDocument const document = QJsonDocument::fromJson(base.readAll(), &error);
+
+    // Loading an empty graph instead would let the next compaction
+    // overwrite the damaged document.
+    if (error.error != QJsonParseError::NoError || !document.isObject())
+    {
+      qWarning() << "Could not parse" << documentPath << ":" << error.errorString();
+      return false;
+    }
+
+    baseDocument = document.object();
+  }
+
+  // Everything that may fail happens before the model is touched.
+  _journal.setFileName(journalPathOf(documentPath));
+
+  if (!_journal.open(QIODevice::ReadWrite))
+    return false;
+
+  QByteArray const content = _journal.readAll();
+
+  // A shorter file is a new log whose header was torn by a crash.
+  bool const hasHeader = content.size() >= static_cast<int>(sizeof(journalMagic));
+
+  if (hasHeader)
+  {
+    QDataStream in(content);
+    setStreamVersion(in);
+
+    quint32 magic = 0;
+    in >> magic;
+
+    // Truncating a foreign file, or a log damaged at its start, would lose
+    // whatever it holds.
+    if (magic != journalMagic)
+    {
+      qWarning() << _journal.fileName() << "is not a graph journal";
+      _journal.close();
+      return false;
+    }
+  }
+
+  // Starts over if the file is new.
+  if (!hasHeader)
+  {
+    _journal.resize(0);
+
+    if (!writeHeader())
+    {
+      _journal.close();
+      return false;
+    }
+  }
+
+  if (!baseDocument.isEmpty())
+    _graphModel.load(baseDocument);
+
+  if (hasHeader)
+    replay(content);
+
+  _journaledSnapshot = _graphModel.snapshot();
+
+  _documentPath = documentPath;
+
+  _flushTimer->start();
+
+  return true;
+}
+
+
+void
+GraphJournal::
+close()
+{
+  if (!isOpen())
+    return;
+
+  flush();
+
+  _flushTimer->stop();
+
+  _journal.close();
+}
+
+
+QString
+GraphJournal::
+journalPath() const
+{
+  return journalPathOf(_documentPath);
+}
+
+
+void
+GraphJournal::
+setFlushInterval(int const msec)
+{
+  _flushTimer->setInterval(msec);
+}
+
+
+int
+GraphJournal::
+flushInterval() const
+{
+  return _flushTimer->interval();
+}
+
+
+void
+GraphJournal::
+setCompactionThreshold(qint64 const bytes)
+{
+  _compactionThreshold = bytes;
+}
+
+
+qint64
+GraphJournal::
+journalSize() const
+{
+  return _journal.isOpen() ? _journal.size() : 0;
+}
+
+
+bool
+GraphJournal::
+flush()
+{
+  if (!isOpen())
+    return false;
+
+  GraphSnapshot const snapshot = _graphModel.snapshot();
+
+  if (snapshot.isIdenticalTo(_journaledSnapshot))
+    return true;
+
+  QByteArray payload;
+  {
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    setStreamVersion(out);
+
+    // Connections are removed before their nodes and added after them.
+    std::vector<ConnectionId> addedConnections;
+
+    snapshot.connections().diff(
+      _journaledSnapshot.connections(),
+      [&](ConnectionId const & cid, bool) { addedConnections.push_back(cid); },
+      [&](ConnectionId const & cid, bool)
+      { writeConnection(out, RecordType::ConnectionRemoved, cid); },
+      [](ConnectionId const &, bool, bool) {});
+
+    auto writeNodeData =
+      [&](NodeId const nodeId, QJsonObject const & internalData)
+      {
+        out << static_cast<quint8>(RecordType::NodeData)
+            << static_cast<quint32>(nodeId)
+            << QCborValue::fromJsonValue(internalData).toCbor();
+      };
+
+    snapshot.nodes().diff(
+      _journaledSnapshot.nodes(),
+      writeNodeData,
+      [&](NodeId const nodeId, QJsonObject const &)
+      {
+        out << static_cast<quint8>(RecordType::NodeRemoved)
+            << static_cast<quint32>(nodeId);
+      },
+      [&](NodeId const nodeId, QJsonObject const &, QJsonObject const & internalData)
+      { writeNodeData(nodeId, internalData); });
+
+    auto writePosition =
+      [&](NodeId const nodeId, GraphSnapshot::NodeGeometry const & geometry)
+      {
+        out << static_cast<quint8>(RecordType::NodePosition)
+            << static_cast<quint32>(nodeId)
+            << geometry.pos.x() << geometry.pos.y();
+      };
+
+    // The size is computed by the node geometry and is not persisted.
+    snapshot.geometry().diff(
+      _journaledSnapshot.geometry(),
+      writePosition,
+      [](NodeId, GraphSnapshot::NodeGeometry const &) {},
+      [&](NodeId const nodeId,
+          GraphSnapshot::NodeGeometry const & oldGeometry,
+          GraphSnapshot::NodeGeometry const & newGeometry)
+      {
+        if (oldGeometry.pos != newGeometry.pos)
+          writePosition(nodeId, newGeometry);
+      });
+
+    for (auto const & cid : addedConnections)
+      writeConnection(out, RecordType::ConnectionAdded, cid);
+  }
+
+  if (!payload.isEmpty())
+  {
+    QByteArray frame;
+    {
+      QDataStream out(&frame, QIODevice::WriteOnly);
+      setStreamVersion(out);
+
+      out << static_cast<quint32>(payload.size()) << checksum(payload);
+    }
+    frame.append(payload);
+
+    qint64 const end = _journal.size();
+
+    if (!_journal.seek(end) ||
+        _journal.write(frame) != frame.size() ||
+        !_journal.flush())
+    {
+      QString const errorString = _journal.errorString();
+
+      // Drops the torn frame, the changes are retried on the next flush.
+      _journal.resize(end);
+
+      Q_EMIT writeFailed(errorString);
+
+      return false;
+    }
+  }
+
+  _journaledSnapshot = snapshot;
+
+  if (_journal.size() > _compactionThreshold)
+    return compact();
+
+  return true;
+}
+
+
+bool
+GraphJournal::
+compact()
+{
+  if (!isOpen())
+    return false;
+
+  GraphSnapshot const snapshot = _graphModel.snapshot();
+
+  QSaveFile base(_documentPath);
+
+  if (!base.open(QIODevice::WriteOnly))
+  {
+    Q_EMIT writeFailed(base.errorString());
+    return false;
+  }
+
+  base.write(QJsonDocument(snapshot.toJson()).toJson());
+
+  if (!base.commit())
+  {
+    Q_EMIT writeFailed(base.errorString());
+    return false;
+  }
+
+  // A crash right here leaves a journal already merged into the base file,
+  // replaying it again gives the same graph.
+  if (!_journal.resize(0) || !writeHeader())
+  {
+    Q_EMIT writeFailed(_journal.errorString());
+    return false;
+  }
+
+  _journaledSnapshot = snapshot;
+
+  Q_EMIT compacted();
+
+  return true;
+}
+
+
+void
+GraphJournal::
+replay(QByteArray const & journalContent)
+{
+  qint64 position = sizeof(quint32);
+
+  while (position + frameHeaderSize <= journalContent.size())
+  {
+    QDataStream header(journalContent.mid(position, frameHeaderSize));
+    setStreamVersion(header);
+
+    quint32 payloadSize = 0;
+    quint16 payloadChecksum = 0;
+    header >> payloadSize >> payloadChecksum;
+
+    qint64 const payloadStart = position + frameHeaderSize;
+
+    if (payloadStart + payloadSize > journalContent.size())
+      break;
+
+    QByteArray const payload = journalContent.mid(payloadStart, payloadSize);
+
+    // The tail of a frame written during a crash.
+    if (checksum(payload) != payloadChecksum)
+      break;
+
+    QDataStream in(payload);
+    setStreamVersion(in);
+
+    while (!in.atEnd() && in.status() == QDataStream::Ok)
+    {
+      quint8 type = 0;
+      in >> type;
+
+      switch (static_cast<RecordType>(type))
+      {
+        case RecordType::NodeRemoved:
+        {
+          quint32 nodeId = 0;
+          in >> nodeId;
+
+          if (_graphModel.nodeExists(nodeId))
+            _graphModel.deleteNode(nodeId);
+        }
+        break;
+
+        case RecordType::NodeData:
+        {
+          quint32 nodeId = 0;
+          QByteArray cbor;
+          in >> nodeId >> cbor;
+
+          QJsonObject const internalData =
+            QCborValue::fromCbor(cbor).toMap().toJsonObject();
+
+          auto delegate = _graphModel.delegateModel<NodeDelegateModel>(nodeId);
+
+          // The id was reused by a node of another type.
+          if (delegate && delegate->name() != internalData["model-name"].toString())
+          {
+            _graphModel.deleteNode(nodeId);
+            delegate = nullptr;
+          }
+
+          if (delegate)
+          {
+            delegate->load(internalData);
+            _graphModel.invalidateSnapshot(nodeId);
+          }
+          else
+          {
+            QJsonObject nodeJson;
+            nodeJson["id"] = static_cast<qint64>(nodeId);
+            nodeJson["internal-data"] = internalData;
+
+            _graphModel.loadNode(nodeJson);
+          }
+        }
+        break;
+
+        case RecordType::NodePosition:
+        {
+          quint32 nodeId = 0;
+          double x = 0.0, y = 0.0;
+          in >> nodeId >> x >> y;
+
+          if (_graphModel.nodeExists(nodeId))
+            _graphModel.setNodeData(nodeId, NodeRole::Position, QPointF(x, y));
+        }
+        break;
+
+        case RecordType::ConnectionAdded:
+        {
+          ConnectionId const cid = readConnection(in);
+
+          bool const exists =
+            _graphModel.connections(cid.outNodeId,
+                                    PortType::Out,
+                                    cid.outPortIndex).count(cid) > 0;
+
+          if (!exists &&
+              _graphModel.nodeExists(cid.outNodeId) &&
+              _graphModel.nodeExists(cid.inNodeId))
+          {
+            _graphModel.addConnection(cid);
+          }
+        }
+        break;
+
+        case RecordType::ConnectionRemoved:
+          _graphModel.deleteConnection(readConnection(in));
+          break;
+
+        default:
+          // Written by a newer version, the rest of the frame is unreadable.
+          in.setStatus(QDataStream::ReadCorruptData);
+          break;
+      }
+    }
+
+    position = payloadStart + payloadSize;
+  }
+
+  // Continues appending right after the last valid frame.
+  _journal.resize(position);
+}
+
+
+bool
+GraphJournal::
+writeHeader()
+{
+  QByteArray header;
+  {
+    QDataStream out(&header, QIODevice::WriteOnly);
+    setStreamVersion(out);
+
+    out << journalMagic;
+  }
+
+  return _journal.seek(0) &&
+         _journal.write(header) == header.size() &&
+         _journal.flush();
+}
+
+}
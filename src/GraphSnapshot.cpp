@@ -0,0 +1,144 @@
+#include "GraphSnapshot.hpp"
+
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <utility>
+
+namespace QtNodes
+{
+
+GraphSnapshot::
+GraphSnapshot(NodeMap       nodes,
+              GeometryMap   geometry,
+              ConnectionMap connections)
+  : _nodes(std::move(nodes))
+  , _geometry(std::move(geometry))
+  , _connections(std::move(connections))
+{}
+
+
+QJsonObject
+GraphSnapshot::
+nodeInternalData(NodeId const nodeId) const
+{
+  QJsonObject const * internalData = _nodes.find(nodeId);
+
+  return internalData ? *internalData : QJsonObject();
+}
+
+
+QPointF
+GraphSnapshot::
+nodePosition(NodeId const nodeId) const
+{
+  NodeGeometry const * geometry = _geometry.find(nodeId);
+
+  return geometry ? geometry->pos : QPointF();
+}
+
+
+QSize
+GraphSnapshot::
+nodeSize(NodeId const nodeId) const
+{
+  NodeGeometry const * geometry = _geometry.find(nodeId);
+
+  return geometry ? geometry->size : QSize();
+}
+
+
+bool
+GraphSnapshot::
+isIdenticalTo(GraphSnapshot const & other) const
+{
+  return _nodes.isSharedWith(other._nodes) &&
+         _geometry.isSharedWith(other._geometry) &&
+         _connections.isSharedWith(other._connections);
+}
+
+
+GraphSnapshotDiff
+GraphSnapshot::
+diff(GraphSnapshot const & older) const
+{
+  GraphSnapshotDiff result;
+
+  _nodes.diff(older._nodes,
+              [&](NodeId const nodeId, QJsonObject const &)
+              { result.addedNodes.push_back(nodeId); },
+              [&](NodeId const nodeId, QJsonObject const &)
+              { result.removedNodes.push_back(nodeId); },
+              [&](NodeId const nodeId, QJsonObject const &, QJsonObject const &)
+              { result.changedNodes.push_back(nodeId); });
+
+  // Geometry of added and removed nodes is reported with the nodes.
+  _geometry.diff(older._geometry,
+                 [](NodeId, NodeGeometry const &) {},
+                 [](NodeId, NodeGeometry const &) {},
+                 [&](NodeId const nodeId, NodeGeometry const &, NodeGeometry const &)
+                 { result.changedNodes.push_back(nodeId); });
+
+  // A node with new data and a new position is listed once.
+  std::sort(result.changedNodes.begin(), result.changedNodes.end());
+  result.changedNodes.erase(std::unique(result.changedNodes.begin(),
+                                        result.changedNodes.end()),
+                            result.changedNodes.end());
+
+  _connections.diff(older._connections,
+                    [&](ConnectionId const & connectionId, bool)
+                    { result.addedConnections.push_back(connectionId); },
+                    [&](ConnectionId const & connectionId, bool)
+                    { result.removedConnections.push_back(connectionId); },
+                    [](ConnectionId const &, bool, bool) {});
+
+  return result;
+}
+
+
+QJsonObject
+GraphSnapshot::
+toJson() const
+{
+  QJsonObject sceneJson;
+
+  QJsonArray nodesJsonArray;
+  _nodes.forEach(
+    [&](NodeId const nodeId, QJsonObject const & internalData)
+    {
+      QJsonObject nodeJson;
+
+      nodeJson["id"] = static_cast<qint64>(nodeId);
+
+      nodeJson["internal-data"] = internalData;
+
+      QPointF const pos = nodePosition(nodeId);
+
+      QJsonObject posJson;
+      posJson["x"] = pos.x();
+      posJson["y"] = pos.y();
+      nodeJson["position"] = posJson;
+
+      nodesJsonArray.append(nodeJson);
+    });
+  sceneJson["nodes"] = nodesJsonArray;
+
+  QJsonArray connJsonArray;
+  _connections.forEach(
+    [&](ConnectionId const & connId, bool)
+    {
+      QJsonObject connJson;
+
+      connJson["outNodeId"] = static_cast<qint64>(connId.outNodeId);
+      connJson["outPortIndex"] = static_cast<qint64>(connId.outPortIndex);
+      connJson["intNodeId"] = static_cast<qint64>(connId.inNodeId);
+      connJson["inPortIndex"] = static_cast<qint64>(connId.inPortIndex);
+
+      connJsonArray.append(connJson);
+    });
+  sceneJson["connections"] = connJsonArray;
+
+  return sceneJson;
+}
+
+}
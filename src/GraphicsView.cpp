@@ -20,8 +20,12 @@
 #include <QtOpenGL>
 #include <QtWidgets>
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <vector>
 
 using QtNodes::GraphicsView;
 using QtNodes::BasicGraphicsScene;
@@ -31,6 +35,12 @@ GraphicsView(QWidget *parent)
   : QGraphicsView(parent)
   , _clearSelectionAction(Q_NULLPTR)
   , _deleteSelectionAction(Q_NULLPTR)
+  , _copySelectionAction(Q_NULLPTR)
+  , _cutSelectionAction(Q_NULLPTR)
+  , _pasteAction(Q_NULLPTR)
+  , _duplicateSelectionAction(Q_NULLPTR)
+  , _rubberBand(new QRubberBand(QRubberBand::Rectangle, this))
+  , _minGridSpacing(0.0)
 {
   setDragMode(QGraphicsView::ScrollHandDrag);
   setRenderHint(QPainter::Antialiasing);
@@ -107,6 +117,54 @@ setScene(BasicGraphicsScene *scene)
   addAction(_deleteSelectionAction);
 
 
+  delete _copySelectionAction;
+  _copySelectionAction = new QAction(QStringLiteral("Copy Selection"), this);
+  _copySelectionAction->setShortcutContext(Qt::ShortcutContext::WidgetShortcut);
+  _copySelectionAction->setShortcut(QKeySequence(QKeySequence::Copy));
+  connect(_copySelectionAction,
+          &QAction::triggered,
+          this,
+          &GraphicsView::onCopySelectedObjects);
+
+  addAction(_copySelectionAction);
+
+
+  delete _cutSelectionAction;
+  _cutSelectionAction = new QAction(QStringLiteral("Cut Selection"), this);
+  _cutSelectionAction->setShortcutContext(Qt::ShortcutContext::WidgetShortcut);
+  _cutSelectionAction->setShortcut(QKeySequence(QKeySequence::Cut));
+  connect(_cutSelectionAction,
+          &QAction::triggered,
+          this,
+          &GraphicsView::onCutSelectedObjects);
+
+  addAction(_cutSelectionAction);
+
+
+  delete _pasteAction;
+  _pasteAction = new QAction(QStringLiteral("Paste"), this);
+  _pasteAction->setShortcutContext(Qt::ShortcutContext::WidgetShortcut);
+  _pasteAction->setShortcut(QKeySequence(QKeySequence::Paste));
+  connect(_pasteAction,
+          &QAction::triggered,
+          this,
+          &GraphicsView::onPasteObjects);
+
+  addAction(_pasteAction);
+
+
+  delete _duplicateSelectionAction;
+  _duplicateSelectionAction = new QAction(QStringLiteral("Duplicate Selection"), this);
+  _duplicateSelectionAction->setShortcutContext(Qt::ShortcutContext::WidgetShortcut);
+  _duplicateSelectionAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_D));
+  connect(_duplicateSelectionAction,
+          &QAction::triggered,
+          this,
+          &GraphicsView::onDuplicateSelectedObjects);
+
+  addAction(_duplicateSelectionAction);
+
+
   auto undoAction = scene->undoStack().createUndoAction(this, tr("&Undo"));
   undoAction->setShortcuts(QKeySequence::Undo);
   addAction(undoAction);
@@ -117,6 +175,16 @@ setScene(BasicGraphicsScene *scene)
 }
 
 
+void
+GraphicsView::
+setMinGridSpacing(double const pixels)
+{
+  _minGridSpacing = pixels;
+
+  resetCachedContent();
+}
+
+
 void
 GraphicsView::
 centerScene()
@@ -134,6 +202,8 @@ centerScene()
     }
 
     centerOn(sceneRect.center());
+
+    updateVisibleSceneRect();
   }
 }
 
@@ -193,6 +263,8 @@ scaleUp()
     return;
 
   scale(factor, factor);
+
+  updateVisibleSceneRect();
 }
 
 
@@ -204,6 +276,8 @@ scaleDown()
   double const factor = std::pow(step, -1.0);
 
   scale(factor, factor);
+
+  updateVisibleSceneRect();
 }
 
 
@@ -215,6 +289,91 @@ onDeleteSelectedObjects()
 }
 
 
+void
+GraphicsView::
+onCopySelectedObjects()
+{
+  QByteArray const data = serializeSelection(*nodeScene());
+
+  auto mimeData = new QMimeData();
+  mimeData->setData(selectionMimeType(), data);
+
+  QGuiApplication::clipboard()->setMimeData(mimeData);
+}
+
+
+void
+GraphicsView::
+onCutSelectedObjects()
+{
+  onCopySelectedObjects();
+
+  onDeleteSelectedObjects();
+}
+
+
+void
+GraphicsView::
+onPasteObjects()
+{
+  QMimeData const * mimeData = QGuiApplication::clipboard()->mimeData();
+
+  if (!mimeData || !mimeData->hasFormat(selectionMimeType()))
+    return;
+
+  QPoint viewPos = viewport()->mapFromGlobal(QCursor::pos());
+
+  if (!viewport()->rect().contains(viewPos))
+    viewPos = viewport()->rect().center();
+
+  auto command = new PasteCommand(nodeScene(),
+                                  mimeData->data(selectionMimeType()),
+                                  mapToScene(viewPos));
+
+  if (command->isEmpty())
+  {
+    delete command;
+    return;
+  }
+
+  nodeScene()->undoStack().push(command);
+}
+
+
+void
+GraphicsView::
+onDuplicateSelectedObjects()
+{
+  auto & graphModel = nodeScene()->graphModel();
+
+  QPointF topLeft(std::numeric_limits<double>::max(),
+                  std::numeric_limits<double>::max());
+
+  bool hasNodes = false;
+
+  for (NodeId const nodeId : nodeScene()->selectedNodeIds())
+  {
+    QPointF const pos =
+      graphModel.nodeData(nodeId, NodeRole::Position).value<QPointF>();
+
+    topLeft.setX(std::min(topLeft.x(), pos.x()));
+    topLeft.setY(std::min(topLeft.y(), pos.y()));
+
+    hasNodes = true;
+  }
+
+  if (!hasNodes)
+    return;
+
+  double const duplicateOffset = 30.0;
+
+  nodeScene()->undoStack().push(
+    new PasteCommand(nodeScene(),
+                     serializeSelection(*nodeScene()),
+                     topLeft + QPointF(duplicateOffset, duplicateOffset)));
+}
+
+
 void
 GraphicsView::
 keyPressEvent(QKeyEvent *event)
@@ -254,6 +413,24 @@ void
 GraphicsView::
 mousePressEvent(QMouseEvent *event)
 {
+  // The scene has no item index, the rubber band of QGraphicsView would test
+  // every item against the band on each mouse move.
+  if (event->button() == Qt::LeftButton &&
+      dragMode() == QGraphicsView::RubberBandDrag &&
+      nodeScene() &&
+      itemAt(event->pos()) == nullptr)
+  {
+    if ((event->modifiers() & Qt::ControlModifier) == 0)
+      scene()->clearSelection();
+
+    _rubberBandOrigin = event->pos();
+    _rubberBand->setGeometry(QRect(_rubberBandOrigin, QSize()));
+    _rubberBand->show();
+
+    event->accept();
+    return;
+  }
+
   QGraphicsView::mousePressEvent(event);
   if (event->button() == Qt::LeftButton)
   {
@@ -266,6 +443,14 @@ void
 GraphicsView::
 mouseMoveEvent(QMouseEvent *event)
 {
+  if (_rubberBand->isVisible())
+  {
+    updateRubberBandSelection(event->pos());
+
+    event->accept();
+    return;
+  }
+
   QGraphicsView::mouseMoveEvent(event);
   if (scene()->mouseGrabberItem() == nullptr && event->buttons() == Qt::LeftButton)
   {
@@ -281,51 +466,207 @@ mouseMoveEvent(QMouseEvent *event)
 
 void
 GraphicsView::
-drawBackground(QPainter* painter, const QRectF &r)
+mouseReleaseEvent(QMouseEvent *event)
 {
-  QGraphicsView::drawBackground(painter, r);
+  if (_rubberBand->isVisible() && event->button() == Qt::LeftButton)
+  {
+    _rubberBand->hide();
+
+    _rubberBandNodes.clear();
+    _rubberBandConnections.clear();
+
+    event->accept();
+    return;
+  }
+
+  QGraphicsView::mouseReleaseEvent(event);
+}
+
+
+void
+GraphicsView::
+updateRubberBandSelection(QPoint const viewPos)
+{
+  QRect const bandRect = QRect(_rubberBandOrigin, viewPos).normalized();
+
+  _rubberBand->setGeometry(bandRect);
+
+  BasicGraphicsScene * scene = nodeScene();
+
+  if (!scene)
+    return;
 
-  auto drawGrid =
-    [&](double gridStep)
+  auto & graphModel = scene->graphModel();
+
+  QRectF const bandSceneRect = mapToScene(bandRect).boundingRect();
+
+  std::vector<NodeId> found = scene->nodesInRect(bandSceneRect);
+
+  // The index holds the bounding rects with their painting margin, a node is
+  // selected only once the band touches the node rect itself.
+  auto & geometry = scene->nodeGeometry();
+
+  found.erase(std::remove_if(found.begin(),
+                             found.end(),
+                             [&](NodeId const nodeId)
+                             {
+                               auto ngo = scene->nodeGraphicsObject(nodeId);
+
+                               if (!ngo)
+                                 return true;
+
+                               QRectF const nodeRect(QPointF(0, 0), geometry.size(nodeId));
+
+                               return !ngo->mapRectToScene(nodeRect).intersects(bandSceneRect);
+                             }),
+              found.end());
+
+  std::unordered_set<NodeId> const inside(found.begin(), found.end());
+
+  // Objects selected before the band appeared keep their selection.
+  auto select =
+    [](QGraphicsItem * item) -> bool
     {
-      QRect windowRect = rect();
-      QPointF tl       = mapToScene(windowRect.topLeft());
-      QPointF br       = mapToScene(windowRect.bottomRight());
-
-      double left   = std::floor(tl.x() / gridStep - 0.5);
-      double right  = std::floor(br.x() / gridStep + 1.0);
-      double bottom = std::floor(tl.y() / gridStep - 0.5);
-      double top    = std::floor(br.y() / gridStep + 1.0);
-
-      // vertical lines
-      for (int xi = int(left); xi <= int(right); ++xi)
-      {
-        QLineF line(xi * gridStep, bottom * gridStep,
-                    xi * gridStep, top * gridStep);
-
-        painter->drawLine(line);
-      }
-
-      // horizontal lines
-      for (int yi = int(bottom); yi <= int(top); ++yi)
-      {
-        QLineF line(left * gridStep, yi * gridStep,
-                    right * gridStep, yi * gridStep);
-        painter->drawLine(line);
-      }
+      if (!item || item->isSelected())
+        return false;
+
+      item->setSelected(true);
+      return true;
     };
 
+  auto deselect =
+    [](QGraphicsItem * item, bool const selectedByBand)
+    {
+      if (item && selectedByBand)
+        item->setSelected(false);
+    };
+
+  for (auto it = _rubberBandNodes.begin(); it != _rubberBandNodes.end();)
+  {
+    NodeId const nodeId = it->first;
+
+    if (inside.count(nodeId) > 0)
+    {
+      ++it;
+      continue;
+    }
+
+    deselect(scene->nodeGraphicsObject(nodeId), it->second);
+
+    for (auto const & cid : graphModel.allConnectionIds(nodeId))
+    {
+      auto cIt = _rubberBandConnections.find(cid);
+      if (cIt == _rubberBandConnections.end())
+        continue;
+
+      deselect(scene->connectionGraphicsObject(cid), cIt->second);
+
+      _rubberBandConnections.erase(cIt);
+    }
+
+    it = _rubberBandNodes.erase(it);
+  }
+
+  for (NodeId const nodeId : found)
+  {
+    if (_rubberBandNodes.count(nodeId) > 0)
+      continue;
+
+    _rubberBandNodes[nodeId] = select(scene->nodeGraphicsObject(nodeId));
+
+    // Connections are selected once both of their nodes are inside.
+    for (auto const & cid : graphModel.allConnectionIds(nodeId))
+    {
+      NodeId const otherId = (cid.outNodeId == nodeId) ? cid.inNodeId : cid.outNodeId;
+
+      if (_rubberBandNodes.count(otherId) == 0 ||
+          _rubberBandConnections.count(cid) > 0)
+        continue;
+
+      _rubberBandConnections[cid] = select(scene->connectionGraphicsObject(cid));
+    }
+  }
+}
+
+
+void
+GraphicsView::
+drawBackground(QPainter* painter, const QRectF &r)
+{
+  QGraphicsView::drawBackground(painter, r);
+
   auto const &flowViewStyle = StyleCollection::flowViewStyle();
 
   QPen pfine(flowViewStyle.FineGridColor, 1.0);
 
   painter->setPen(pfine);
-  drawGrid(15);
+  drawGrid(painter, r, 15, _fineGrid);
 
   QPen p(flowViewStyle.CoarseGridColor, 1.0);
 
   painter->setPen(p);
-  drawGrid(150);
+  drawGrid(painter, r, 150, _coarseGrid);
+}
+
+
+void
+GraphicsView::
+drawGrid(QPainter *     painter,
+         QRectF const & rect,
+         double const   gridStep,
+         GridLines &    grid)
+{
+  double const scale = transform().m11();
+
+  // Denser lines merge into a flat fill and only cost time.
+  if (gridStep * scale < _minGridSpacing)
+    return;
+
+  auto cellsOf =
+    [gridStep](QRectF const & r)
+    {
+      return QRect(QPoint(int(std::floor(r.left() / gridStep)),
+                          int(std::floor(r.top() / gridStep))),
+                   QPoint(int(std::ceil(r.right() / gridStep)),
+                          int(std::ceil(r.bottom() / gridStep))));
+    };
+
+  // Background caching makes `rect` the exposed strip while panning, so
+  // the cache is keyed on the viewport rather than on `rect`.
+  if (scale != grid.scale || !grid.cells.contains(cellsOf(rect)))
+  {
+    QRectF const visibleRect = mapToScene(viewport()->rect()).boundingRect();
+
+    QRect cells = cellsOf(visibleRect.united(rect));
+
+    int const marginX = cells.width() / 2;
+    int const marginY = cells.height() / 2;
+
+    cells.adjust(-marginX, -marginY, marginX, marginY);
+
+    grid.cells = cells;
+    grid.scale = scale;
+    grid.lines.clear();
+
+    double const left   = cells.left() * gridStep;
+    double const right  = cells.right() * gridStep;
+    double const top    = cells.top() * gridStep;
+    double const bottom = cells.bottom() * gridStep;
+
+    // vertical lines
+    for (int xi = cells.left(); xi <= cells.right(); ++xi)
+    {
+      grid.lines.emplace_back(xi * gridStep, top, xi * gridStep, bottom);
+    }
+
+    // horizontal lines
+    for (int yi = cells.top(); yi <= cells.bottom(); ++yi)
+    {
+      grid.lines.emplace_back(left, yi * gridStep, right, yi * gridStep);
+    }
+  }
+
+  painter->drawLines(grid.lines.data(), static_cast<int>(grid.lines.size()));
 }
 
 
@@ -336,10 +677,70 @@ showEvent(QShowEvent *event)
   QGraphicsView::showEvent(event);
 
   scene()->setSceneRect(this->rect());
+
+  // The rect is reported even if it is the same as before hiding.
+  _visibleSceneRect = QRectF();
+
   centerScene();
 }
 
 
+void
+GraphicsView::
+hideEvent(QHideEvent *event)
+{
+  QGraphicsView::hideEvent(event);
+
+  _visibleSceneRect = QRectF();
+
+  if (auto s = nodeScene())
+    s->invalidateVisibleSceneRect();
+}
+
+
+void
+GraphicsView::
+scrollContentsBy(int dx, int dy)
+{
+  QGraphicsView::scrollContentsBy(dx, dy);
+
+  updateVisibleSceneRect();
+}
+
+
+void
+GraphicsView::
+resizeEvent(QResizeEvent *event)
+{
+  QGraphicsView::resizeEvent(event);
+
+  updateVisibleSceneRect();
+}
+
+
+void
+GraphicsView::
+updateVisibleSceneRect()
+{
+  if (!isVisible())
+    return;
+
+  QRectF const visibleRect = mapToScene(viewport()->rect()).boundingRect();
+
+  if (visibleRect == _visibleSceneRect)
+    return;
+
+  _visibleSceneRect = visibleRect;
+
+  if (auto s = nodeScene())
+  {
+    s->invalidateVisibleSceneRect();
+    s->scheduleWidgetEmbeddingUpdate();
+    s->updateStaleConnections(visibleRect);
+  }
+}
+
+
 BasicGraphicsScene *
 GraphicsView::
 nodeScene()
@@ -177,13 +177,16 @@ NodeConnectionInteraction::
 nodePortIndexUnderScenePoint(PortType portType,
                              QPointF const & scenePoint) const
 {
-  AbstractNodeGeometry & geometry = _scene.nodeGeometry();
-
-  QTransform sceneTransform = _ngo.sceneTransform();
+  NodeId const nodeId = _ngo.nodeId();
 
-  QPointF nodePoint = sceneTransform.inverted().map(scenePoint);
+  auto const port =
+    _scene.locatePort(scenePoint,
+                      portType,
+                      _scene.portSnapRadius(),
+                      [nodeId](NodeId const candidate, PortIndex)
+                      { return candidate == nodeId; });
 
-  return geometry.checkPortHit(_ngo.nodeId(), portType, nodePoint);
+  return port.portIndex;
 }
 
 
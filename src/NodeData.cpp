@@ -0,0 +1,87 @@
+#include "NodeData.hpp"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QVector>
+
+using QtNodes::InvalidNodeDataTypeHandle;
+using QtNodes::NodeDataTypeHandle;
+using QtNodes::NodeDataTypeRegistry;
+
+namespace
+{
+
+struct TypeTable
+{
+  QMutex mutex;
+
+  QHash<QString, NodeDataTypeHandle> handles;
+
+  QVector<QString> ids;
+};
+
+
+TypeTable &
+typeTable()
+{
+  static TypeTable table;
+
+  return table;
+}
+
+}
+
+
+NodeDataTypeHandle
+NodeDataTypeRegistry::
+intern(QString const & typeId)
+{
+  // Handles never change once assigned, so every thread keeps the ones it
+  // has seen and takes the lock only for ids new to it.
+  thread_local QHash<QString, NodeDataTypeHandle> seenHandles;
+
+  auto seen = seenHandles.constFind(typeId);
+
+  if (seen != seenHandles.constEnd())
+    return seen.value();
+
+  TypeTable & table = typeTable();
+
+  QMutexLocker locker(&table.mutex);
+
+  NodeDataTypeHandle handle = InvalidNodeDataTypeHandle;
+
+  auto it = table.handles.constFind(typeId);
+
+  if (it != table.handles.constEnd())
+  {
+    handle = it.value();
+  }
+  else
+  {
+    handle = table.ids.size();
+
+    table.ids.push_back(typeId);
+    table.handles.insert(typeId, handle);
+  }
+
+  seenHandles.insert(typeId, handle);
+
+  return handle;
+}
+
+
+QString
+NodeDataTypeRegistry::
+typeId(NodeDataTypeHandle const handle)
+{
+  TypeTable & table = typeTable();
+
+  QMutexLocker locker(&table.mutex);
+
+  if (handle >= static_cast<NodeDataTypeHandle>(table.ids.size()))
+    return QString();
+
+  return table.ids[handle];
+}
@@ -0,0 +1,76 @@
+#include "NodeDataChannel.hpp"
+
+#include <algorithm>
+
+namespace QtNodes
+{
+
+NodeDataChannel::
+NodeDataChannel(std::size_t capacity, QObject * parent)
+  : QObject(parent)
+  , _capacity(std::max<std::size_t>(capacity, 1))
+  , _closed(false)
+{}
+
+
+bool
+NodeDataChannel::
+tryPush(std::shared_ptr<NodeData> chunk)
+{
+  if (_closed || isFull())
+    return false;
+
+  _chunks.push_back(std::move(chunk));
+
+  Q_EMIT chunkAvailable();
+
+  return true;
+}
+
+
+std::shared_ptr<NodeData>
+NodeDataChannel::
+tryPop()
+{
+  if (_chunks.empty())
+    return nullptr;
+
+  bool const wasFull = isFull();
+
+  std::shared_ptr<NodeData> chunk = std::move(_chunks.front());
+  _chunks.pop_front();
+
+  if ((wasFull && !_closed) || atEnd())
+    Q_EMIT spaceAvailable();
+
+  return chunk;
+}
+
+
+void
+NodeDataChannel::
+close()
+{
+  if (_closed)
+    return;
+
+  _closed = true;
+
+  Q_EMIT closed();
+}
+
+
+bool
+NodeDataChannel::
+reopen()
+{
+  if (!atEnd())
+    return false;
+
+  _closed = false;
+
+  return true;
+}
+
+
+}
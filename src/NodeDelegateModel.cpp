@@ -2,6 +2,8 @@
 
 #include "StyleCollection.hpp"
 
+#include <algorithm>
+
 namespace QtNodes
 {
 
@@ -70,4 +72,103 @@ setNodeStyle(NodeStyle const & style)
 }
 
 
+bool
+NodeDelegateModel::
+pushChunk(PortIndex const port, std::shared_ptr<NodeData> chunk)
+{
+  if (!canPushChunk(port))
+    return false;
+
+  // The consumers have read the end of a closed stream, the chunk starts the
+  // next one.
+  for (auto const & channel : _outChannels.find(port)->second)
+  {
+    channel->reopen();
+    channel->tryPush(chunk);
+  }
+
+  return true;
+}
+
+
+bool
+NodeDelegateModel::
+canPushChunk(PortIndex const port) const
+{
+  auto it = _outChannels.find(port);
+  if (it == _outChannels.end())
+    return false;
+
+  return std::none_of(it->second.begin(), it->second.end(),
+                      [](auto const & channel)
+                      {
+                        return channel->isFull() ||
+                               (channel->isClosed() && !channel->isEmpty());
+                      });
+}
+
+
+void
+NodeDelegateModel::
+closeStream(PortIndex const port)
+{
+  auto it = _outChannels.find(port);
+  if (it == _outChannels.end())
+    return;
+
+  for (auto const & channel : it->second)
+  {
+    channel->close();
+  }
+}
+
+
+void
+NodeDelegateModel::
+attachOutChannel(PortIndex const port,
+                 std::shared_ptr<NodeDataChannel> channel)
+{
+  connect(channel.get(), &NodeDataChannel::spaceAvailable,
+          this,
+          [this, port]()
+          {
+            if (canPushChunk(port))
+              Q_EMIT streamSpaceAvailable(port);
+          });
+
+  _outChannels[port].push_back(std::move(channel));
+
+  // Producers wait for the first connection as for free space.
+  if (canPushChunk(port))
+    Q_EMIT streamSpaceAvailable(port);
+}
+
+
+void
+NodeDelegateModel::
+detachOutChannel(PortIndex const port,
+                 std::shared_ptr<NodeDataChannel> const & channel)
+{
+  auto it = _outChannels.find(port);
+  if (it == _outChannels.end())
+    return;
+
+  disconnect(channel.get(), nullptr, this, nullptr);
+
+  auto & channels = it->second;
+  channels.erase(std::remove(channels.begin(), channels.end(), channel),
+                 channels.end());
+
+  if (channels.empty())
+  {
+    _outChannels.erase(it);
+  }
+  else if (canPushChunk(port))
+  {
+    // The removed channel might have been the only full one.
+    Q_EMIT streamSpaceAvailable(port);
+  }
+}
+
+
 } // namespace QtNodes
@@ -45,3 +45,38 @@ categories() const
   return _categories;
 }
 
+
+
+void
+NodeDelegateModelRegistry::
+registerTypeConverter(NodeDataType const& from,
+                      NodeDataType const& to,
+                      TypeConverter       typeConverter)
+{
+  _registeredTypeConverters[typeConverterId(from, to)] = std::move(typeConverter);
+}
+
+
+bool
+NodeDelegateModelRegistry::
+hasTypeConverter(NodeDataType const& d1,
+                 NodeDataType const& d2) const
+{
+  return _registeredTypeConverters.count(typeConverterId(d1, d2)) > 0;
+}
+
+
+NodeDelegateModelRegistry::TypeConverter
+NodeDelegateModelRegistry::
+getTypeConverter(NodeDataType const& d1,
+                 NodeDataType const& d2) const
+{
+  auto it = _registeredTypeConverters.find(typeConverterId(d1, d2));
+
+  if (it != _registeredTypeConverters.end())
+  {
+    return it->second;
+  }
+
+  return TypeConverter();
+}
@@ -33,45 +33,112 @@ NodeGraphicsObject(BasicGraphicsScene& scene,
   setFlag(QGraphicsItem::ItemDoesntPropagateOpacityToChildren, true);
   setFlag(QGraphicsItem::ItemIsFocusable,                      true);
 
-  setLockedState();
-
   setCacheMode(QGraphicsItem::DeviceCoordinateCache);
 
+  setAcceptHoverEvents(true);
+
+  initializeNode();
+
+  connect(&_graphModel,
+          &AbstractGraphModel::nodeFlagsUpdated,
+          [this](NodeId const nodeId)
+          {
+            if (_nodeId == nodeId)
+              setLockedState();
+          });
+}
+
+
+void
+NodeGraphicsObject::
+initializeNode()
+{
+  setLockedState();
+
   QJsonObject nodeStyleJson =
     _graphModel.nodeData(_nodeId, NodeRole::Style).toJsonObject();
 
   NodeStyle nodeStyle(nodeStyleJson);
 
+  if (nodeStyle.Shadow == NodeStyle::ShadowMode::Effect)
   {
-    auto effect = new QGraphicsDropShadowEffect;
-    effect->setOffset(4, 4);
-    effect->setBlurRadius(20);
-    effect->setColor(nodeStyle.ShadowColor);
+    auto effect = qobject_cast<QGraphicsDropShadowEffect*>(graphicsEffect());
+
+    if (!effect)
+    {
+      effect = new QGraphicsDropShadowEffect;
+      effect->setOffset(4, 4);
+      effect->setBlurRadius(20);
+
+      setGraphicsEffect(effect);
+    }
 
-    setGraphicsEffect(effect);
+    effect->setColor(nodeStyle.ShadowColor);
+  }
+  else
+  {
+    // Deletes the effect if any; the painted shadow is done by the painter.
+    setGraphicsEffect(nullptr);
   }
 
   setOpacity(nodeStyle.Opacity);
 
-  setAcceptHoverEvents(true);
-
   setZValue(0);
 
-  embedQWidget();
+  // With lazy embedding the scene creates the proxy once the node is visible.
+  if (!nodeScene()->lazyWidgetEmbedding())
+    embedQWidget();
 
   nodeScene()->nodeGeometry().recomputeSize(_nodeId);
 
   QPointF const pos = _graphModel.nodeData<QPointF>(_nodeId, NodeRole::Position);
 
   setPos(pos);
+}
 
-  connect(&_graphModel,
-          &AbstractGraphModel::nodeFlagsUpdated,
-          [this](NodeId const nodeId)
-          {
-            if (_nodeId == nodeId)
-              setLockedState();
-          });
+
+void
+NodeGraphicsObject::
+detachFromNode()
+{
+  // The proxy owns the embedded widget of the deleted node.
+  delete _proxyWidget;
+  _proxyWidget = nullptr;
+
+  delete _releasedWidget;
+  _widgetSnapshot = QPixmap();
+
+  setSelected(false);
+
+  _nodeState.setHovered(false);
+  _nodeState.setResizing(false);
+  _nodeState.resetConnectionForReaction();
+
+  _nodeId = InvalidNodeId;
+}
+
+
+void
+NodeGraphicsObject::
+attachToNode(NodeId const nodeId)
+{
+  Q_ASSERT(nodeScene());
+
+  prepareGeometryChange();
+
+  _nodeId = nodeId;
+
+  initializeNode();
+
+  update();
+}
+
+
+NodeGraphicsObject::
+~NodeGraphicsObject()
+{
+  // Nobody else owns a widget taken out of its proxy.
+  delete _releasedWidget;
 }
 
 
@@ -129,6 +196,96 @@ embedQWidget()
 }
 
 
+void
+NodeGraphicsObject::
+ensureWidgetEmbedded()
+{
+  if (_proxyWidget)
+    return;
+
+  if (!_graphModel.nodeData(_nodeId, NodeRole::Widget).value<QWidget*>())
+    return;
+
+  prepareGeometryChange();
+
+  embedQWidget();
+
+  // The widget was hidden when it left its previous proxy.
+  if (_proxyWidget)
+    _proxyWidget->show();
+
+  _releasedWidget = nullptr;
+  _widgetSnapshot = QPixmap();
+
+  if (_proxyWidget)
+    nodeScene()->onNodeWidgetEmbedded(_nodeId);
+
+  update();
+
+  moveConnections();
+
+  // The node grows if the size hint of the widget was off.
+  nodeScene()->updateNodeIndex(*this);
+}
+
+
+void
+NodeGraphicsObject::
+releaseWidget()
+{
+  if (!_proxyWidget)
+    return;
+
+  QWidget * w = _proxyWidget->widget();
+
+  if (w)
+  {
+    _widgetSnapshot = w->grab();
+
+    // Detaches the widget, so it survives the proxy.
+    _proxyWidget->setWidget(nullptr);
+    w->hide();
+  }
+
+  delete _proxyWidget;
+  _proxyWidget = nullptr;
+
+  _releasedWidget = w;
+
+  update();
+}
+
+
+void
+NodeGraphicsObject::
+drawWidgetPlaceholder(QPainter * painter) const
+{
+  AbstractNodeGeometry & geometry = nodeScene()->nodeGeometry();
+
+  if (!_widgetSnapshot.isNull())
+  {
+    painter->drawPixmap(geometry.widgetPosition(_nodeId), _widgetSnapshot);
+    return;
+  }
+
+  // Asking for the widget itself would create it for offscreen nodes.
+  QSize const size = _graphModel.nodeData<QSize>(_nodeId, NodeRole::WidgetSize);
+  if (size.isEmpty())
+    return;
+
+  QPointF const pos = geometry.widgetPosition(_nodeId);
+
+  QJsonObject nodeStyleJson =
+    _graphModel.nodeData(_nodeId, NodeRole::Style).toJsonObject();
+
+  NodeStyle nodeStyle(nodeStyleJson);
+
+  painter->setPen(QPen(nodeStyle.FontColorFaded, 1.0, Qt::DashLine));
+  painter->setBrush(Qt::NoBrush);
+  painter->drawRect(QRectF(pos, size));
+}
+
+
 void
 NodeGraphicsObject::
 setLockedState()
@@ -196,6 +353,9 @@ paint(QPainter*                       painter,
   painter->setClipRect(option->exposedRect);
 
   nodeScene()->nodePainter().paint(painter, *this);
+
+  if (!_proxyWidget && nodeScene()->lazyWidgetEmbedding())
+    drawWidgetPlaceholder(painter);
 }
 
 
@@ -205,7 +365,12 @@ itemChange(GraphicsItemChange change, const QVariant& value)
 {
   if (change == ItemScenePositionHasChanged && scene())
   {
-    moveConnections();
+    nodeScene()->scheduleConnectionUpdate(_nodeId);
+    nodeScene()->updateNodeIndex(*this);
+  }
+  else if (change == ItemSelectedHasChanged && scene() && _nodeId != InvalidNodeId)
+  {
+    nodeScene()->onNodeSelectionChanged(_nodeId, value.toBool());
   }
 
   return QGraphicsObject::itemChange(change, value);
@@ -322,9 +487,12 @@ mouseMoveEvent(QGraphicsSceneMouseEvent* event)
 
       AbstractNodeGeometry & geometry = nodeScene()->nodeGeometry();
 
-      _proxyWidget->setMinimumSize(oldSize);
-      _proxyWidget->setMaximumSize(oldSize);
-      _proxyWidget->setPos(geometry.widgetPosition(_nodeId));
+      if (_proxyWidget)
+      {
+        _proxyWidget->setMinimumSize(oldSize);
+        _proxyWidget->setMaximumSize(oldSize);
+        _proxyWidget->setPos(geometry.widgetPosition(_nodeId));
+      }
 
       // Passes the new size to the model.
       geometry.recomputeSize(_nodeId);
@@ -333,6 +501,8 @@ mouseMoveEvent(QGraphicsSceneMouseEvent* event)
 
       moveConnections();
 
+      nodeScene()->updateNodeIndex(*this);
+
       event->accept();
     }
   }
@@ -363,8 +533,8 @@ mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
 
   QGraphicsObject::mouseReleaseEvent(event);
 
-  // position connections precisely after fast node move
-  moveConnections();
+  // Positions the connections of all the moved nodes precisely.
+  nodeScene()->flushConnectionUpdates();
 
   nodeScene()->nodeClicked(_nodeId);
 }
@@ -374,19 +544,10 @@ void
 NodeGraphicsObject::
 hoverEnterEvent(QGraphicsSceneHoverEvent* event)
 {
-  // bring all the colliding nodes to background
-  QList<QGraphicsItem*> overlapItems = collidingItems();
-
-  for (QGraphicsItem* item : overlapItems)
-  {
-    if (item->zValue() > 0.0)
-    {
-      item->setZValue(0.0);
-    }
-  }
+  // The widget must be ready for the interaction.
+  ensureWidgetEmbedded();
 
-  // bring this node forward
-  setZValue(1.0);
+  nodeScene()->raiseNode(_nodeId);
 
   _nodeState.setHovered(true);
 
@@ -0,0 +1,182 @@
+#include "NodeSpatialIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace
+{
+
+/// Keeps cell coordinates of far away rectangles within `int`.
+int
+toCell(qreal const coordinate, qreal const cellSize)
+{
+  qreal const cell = std::floor(coordinate / cellSize);
+
+  qreal const limit = std::numeric_limits<int>::max() / 2;
+
+  return static_cast<int>(std::max(-limit, std::min(limit, cell)));
+}
+
+}
+
+
+namespace QtNodes
+{
+
+NodeSpatialIndex::
+NodeSpatialIndex(qreal const cellSize)
+  : _cellSize(cellSize)
+{}
+
+
+void
+NodeSpatialIndex::
+insert(NodeId const nodeId, QRectF const & rect)
+{
+  auto it = _rects.find(nodeId);
+
+  if (it != _rects.end())
+  {
+    CellRange const oldRange = cellRange(it->second);
+    CellRange const newRange = cellRange(rect);
+
+    // Moving within the same cells is the common case while dragging.
+    if (oldRange.left == newRange.left && oldRange.top == newRange.top &&
+        oldRange.right == newRange.right && oldRange.bottom == newRange.bottom)
+    {
+      it->second = rect;
+      return;
+    }
+
+    remove(nodeId);
+  }
+
+  _rects[nodeId] = rect;
+
+  CellRange const range = cellRange(rect);
+
+  for (int y = range.top; y <= range.bottom; ++y)
+    for (int x = range.left; x <= range.right; ++x)
+      _cells[cellKey(x, y)].push_back(nodeId);
+}
+
+
+void
+NodeSpatialIndex::
+remove(NodeId const nodeId)
+{
+  auto it = _rects.find(nodeId);
+  if (it == _rects.end())
+    return;
+
+  CellRange const range = cellRange(it->second);
+
+  for (int y = range.top; y <= range.bottom; ++y)
+  {
+    for (int x = range.left; x <= range.right; ++x)
+    {
+      auto cellIt = _cells.find(cellKey(x, y));
+      if (cellIt == _cells.end())
+        continue;
+
+      std::vector<NodeId> & nodeIds = cellIt->second;
+
+      auto nodeIt = std::find(nodeIds.begin(), nodeIds.end(), nodeId);
+      if (nodeIt != nodeIds.end())
+      {
+        *nodeIt = nodeIds.back();
+        nodeIds.pop_back();
+      }
+
+      if (nodeIds.empty())
+        _cells.erase(cellIt);
+    }
+  }
+
+  _rects.erase(it);
+}
+
+
+void
+NodeSpatialIndex::
+clear()
+{
+  _rects.clear();
+  _cells.clear();
+}
+
+
+std::vector<NodeId>
+NodeSpatialIndex::
+query(QRectF const & rect) const
+{
+  std::vector<NodeId> result;
+
+  CellRange const range = cellRange(rect);
+
+  double const cellCount =
+    (static_cast<double>(range.right) - range.left + 1) *
+    (static_cast<double>(range.bottom) - range.top + 1);
+
+  if (cellCount > static_cast<double>(_rects.size()))
+  {
+    for (auto const & entry : _rects)
+    {
+      if (entry.second.intersects(rect))
+        result.push_back(entry.first);
+    }
+
+    return result;
+  }
+
+  for (int y = range.top; y <= range.bottom; ++y)
+  {
+    for (int x = range.left; x <= range.right; ++x)
+    {
+      auto cellIt = _cells.find(cellKey(x, y));
+      if (cellIt == _cells.end())
+        continue;
+
+      for (NodeId const nodeId : cellIt->second)
+      {
+        QRectF const & nodeRect = _rects.at(nodeId);
+
+        CellRange const nodeRange = cellRange(nodeRect);
+
+        // A node spanning several cells is reported by the first shared cell only.
+        if (x != std::max(nodeRange.left, range.left) ||
+            y != std::max(nodeRange.top, range.top))
+          continue;
+
+        if (nodeRect.intersects(rect))
+          result.push_back(nodeId);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+NodeSpatialIndex::CellRange
+NodeSpatialIndex::
+cellRange(QRectF const & rect) const
+{
+  return CellRange{toCell(rect.left(), _cellSize),
+                   toCell(rect.top(), _cellSize),
+                   toCell(rect.right(), _cellSize),
+                   toCell(rect.bottom(), _cellSize)};
+}
+
+
+std::uint64_t
+NodeSpatialIndex::
+cellKey(int const x, int const y)
+{
+  return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) |
+         static_cast<std::uint32_t>(y);
+}
+
+}
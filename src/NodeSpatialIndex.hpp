@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QtCore/QRectF>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Definitions.hpp"
+
+namespace QtNodes
+{
+
+/// Uniform grid of the node bounding rectangles in scene coordinates.
+/**
+ * Each node is registered in every cell its rectangle overlaps. A query
+ * visits only the cells covered by the queried rectangle, so selecting a
+ * small area of a huge graph touches a handful of nodes. A query covering
+ * more cells than there are nodes scans the nodes directly instead.
+ */
+class NodeSpatialIndex
+{
+public:
+  explicit NodeSpatialIndex(qreal const cellSize = 256.0);
+
+public:
+  /// Adds the node or moves it to the new rectangle.
+  void
+  insert(NodeId const nodeId, QRectF const & rect);
+
+  void
+  remove(NodeId const nodeId);
+
+  void
+  clear();
+
+  std::size_t
+  size() const { return _rects.size(); }
+
+  /// @returns nodes whose rectangles intersect `rect`, each one once.
+  std::vector<NodeId>
+  query(QRectF const & rect) const;
+
+private:
+  struct CellRange
+  {
+    int left;
+    int top;
+    int right;
+    int bottom;
+  };
+
+  CellRange
+  cellRange(QRectF const & rect) const;
+
+  static
+  std::uint64_t
+  cellKey(int const x, int const y);
+
+private:
+  qreal _cellSize;
+
+  std::unordered_map<NodeId, QRectF> _rects;
+
+  std::unordered_map<std::uint64_t, std::vector<NodeId>> _cells;
+};
+
+}
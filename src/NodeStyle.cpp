@@ -118,6 +118,16 @@ loadJson(QJsonObject const & json)
   NODE_STYLE_READ_FLOAT(obj, ConnectionPointDiameter);
 
   NODE_STYLE_READ_FLOAT(obj, Opacity);
+
+  // Optional, older style files do not have it.
+  QString const shadowMode = obj["ShadowMode"].toString();
+
+  if (shadowMode == "None")
+    Shadow = ShadowMode::None;
+  else if (shadowMode == "Effect")
+    Shadow = ShadowMode::Effect;
+  else if (shadowMode == "Painted")
+    Shadow = ShadowMode::Painted;
 }
 
 
@@ -147,6 +157,21 @@ toJson() const
 
   NODE_STYLE_WRITE_FLOAT(obj, Opacity);
 
+  switch (Shadow)
+  {
+    case ShadowMode::None:
+      obj["ShadowMode"] = "None";
+      break;
+
+    case ShadowMode::Effect:
+      obj["ShadowMode"] = "Effect";
+      break;
+
+    case ShadowMode::Painted:
+      obj["ShadowMode"] = "Painted";
+      break;
+  }
+
   QJsonObject root;
   root["NodeStyle"] = obj;
 
@@ -1,5 +1,7 @@
 #include "StyleCollection.hpp"
 
+#include "ConnectionStyleCache.hpp"
+
 using QtNodes::StyleCollection;
 using QtNodes::NodeStyle;
 using QtNodes::ConnectionStyle;
@@ -42,6 +44,8 @@ StyleCollection::
 setConnectionStyle(ConnectionStyle connectionStyle)
 {
   instance()._connectionStyle = connectionStyle;
+
+  QtNodes::ConnectionStyleCache::invalidate();
 }
 
 
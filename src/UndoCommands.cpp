@@ -2,120 +2,606 @@
 
 #include "Definitions.hpp"
 #include "BasicGraphicsScene.hpp"
+#include "ConnectionIdHash.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "NodeGraphicsObject.hpp"
-
-#include <QtCore/QJsonArray>
+#include "UndoMemoryBudget.hpp"
+
+#include <QtCore/QCborArray>
+#include <QtCore/QCborMap>
+#include <QtCore/QCborStreamReader>
+#include <QtCore/QCborStreamWriter>
+#include <QtCore/QCborValue>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
 #include <QtWidgets/QGraphicsObject>
 
+#include <QUndoStack>
+
+#include <algorithm>
+#include <limits>
 #include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace
+{
+
+using QtNodes::ConnectionId;
+using QtNodes::NodeId;
+using QtNodes::PortIndex;
+
+/// Content of a command moved to the UndoSpillFile.
+struct SpilledContent
+{
+  bool compressed = false;
+
+  std::vector<NodeId> nodeIds;
+
+  std::vector<ConnectionId> connectionIds;
+
+  QByteArray snapshot;
+};
+
+
+QByteArray
+writeSpillRecord(SpilledContent const & content)
+{
+  QByteArray record;
+
+  QDataStream out(&record, QIODevice::WriteOnly);
+
+  out << content.compressed;
+
+  out << static_cast<quint32>(content.nodeIds.size());
+  for (NodeId const nodeId : content.nodeIds)
+    out << static_cast<quint32>(nodeId);
+
+  out << static_cast<quint32>(content.connectionIds.size());
+  for (auto const & cid : content.connectionIds)
+  {
+    out << static_cast<quint32>(cid.outNodeId)
+        << static_cast<quint32>(cid.outPortIndex)
+        << static_cast<quint32>(cid.inNodeId)
+        << static_cast<quint32>(cid.inPortIndex);
+  }
+
+  out << content.snapshot;
+
+  return record;
+}
+
+
+/// Decodes a CBOR array of node objects written by the snapshot commands.
+std::vector<QJsonObject>
+readNodeSnapshot(QByteArray const & snapshot)
+{
+  std::vector<QJsonObject> nodeJsons;
+
+  QCborStreamReader reader(snapshot);
+
+  if (!reader.isArray())
+    return nodeJsons;
+
+  if (reader.isLengthKnown())
+    nodeJsons.reserve(static_cast<std::size_t>(reader.length()));
+
+  reader.enterContainer();
+  while (reader.hasNext())
+  {
+    nodeJsons.push_back(QCborValue::fromCbor(reader).toMap().toJsonObject());
+  }
+  reader.leaveContainer();
+
+  return nodeJsons;
+}
+
+
+/// @returns `false` if the record is empty or truncated.
+bool
+readSpillRecord(QByteArray const & record, SpilledContent & content)
+{
+  QDataStream in(record);
+
+  in >> content.compressed;
+
+  quint32 nodeCount = 0;
+  in >> nodeCount;
+
+  for (quint32 i = 0; i < nodeCount && in.status() == QDataStream::Ok; ++i)
+  {
+    quint32 nodeId = 0;
+    in >> nodeId;
+    content.nodeIds.push_back(static_cast<NodeId>(nodeId));
+  }
+
+  quint32 connectionCount = 0;
+  in >> connectionCount;
+
+  for (quint32 i = 0; i < connectionCount && in.status() == QDataStream::Ok; ++i)
+  {
+    quint32 outNodeId = 0, outPortIndex = 0, inNodeId = 0, inPortIndex = 0;
+    in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
+
+    content.connectionIds.push_back(ConnectionId{static_cast<NodeId>(outNodeId),
+                                                 static_cast<PortIndex>(outPortIndex),
+                                                 static_cast<NodeId>(inNodeId),
+                                                 static_cast<PortIndex>(inPortIndex)});
+  }
+
+  in >> content.snapshot;
+
+  // An empty or short read leaves the stream past its end.
+  return !record.isEmpty() && in.status() == QDataStream::Ok;
+}
+
+}
 
 
 namespace QtNodes
 {
 
+UndoCommand::
+UndoCommand(BasicGraphicsScene* scene)
+  : _scene(scene)
+  , _memory(scene->undoMemory())
+  , _reportedMemoryUsage(0)
+{
+  //
+}
+
+
+UndoCommand::
+~UndoCommand()
+{
+  _memory.updateUsage(_reportedMemoryUsage, 0);
+}
+
+
+void
+UndoCommand::
+updateMemoryUsage()
+{
+  std::size_t const usage = memoryUsage();
+
+  _memory.updateUsage(_reportedMemoryUsage, usage);
+
+  _reportedMemoryUsage = usage;
+}
+
+
+//------
+
+
+SnapshotCommand::
+SnapshotCommand(BasicGraphicsScene* scene)
+  : UndoCommand(scene)
+  , _compressed(false)
+{
+  //
+}
+
+
+SnapshotCommand::
+~SnapshotCommand()
+{
+  if (_spillFile)
+    _spillFile->release(_spillRecord);
+}
+
+
+bool
+SnapshotCommand::
+spill(std::shared_ptr<UndoSpillFile> file)
+{
+  if (isSpilled() || !file)
+    return false;
+
+  SpilledContent content;
+  content.compressed    = _compressed;
+  content.nodeIds       = _nodeIds;
+  content.connectionIds = _connectionIds;
+  content.snapshot      = _snapshot;
+
+  _spillRecord = file->write(writeSpillRecord(content));
+
+  if (!_spillRecord.isValid())
+    return false;
+
+  _spillFile = std::move(file);
+
+  _nodeIds = std::vector<NodeId>();
+  _connectionIds = std::vector<ConnectionId>();
+  _snapshot = QByteArray();
+
+  updateMemoryUsage();
+
+  return true;
+}
+
+
+bool
+SnapshotCommand::
+restore()
+{
+  if (!isSpilled())
+    return true;
+
+  SpilledContent content;
+
+  if (!readSpillRecord(_spillFile->read(_spillRecord), content))
+  {
+    qWarning() << "Could not read the undo history back from"
+               << _spillFile->fileName() << "- the undo history is cleared";
+
+    // The stack drops the command after this undo or redo, the rest of the
+    // history once the stack is done with it.
+    setObsolete(true);
+
+    QMetaObject::invokeMethod(&_scene->undoStack(),
+                              &QUndoStack::clear,
+                              Qt::QueuedConnection);
+
+    return false;
+  }
+
+  _spillFile->release(_spillRecord);
+  _spillFile.reset();
+  _spillRecord = UndoSpillFile::Record();
+
+  _compressed    = content.compressed;
+  _nodeIds       = std::move(content.nodeIds);
+  _connectionIds = std::move(content.connectionIds);
+  _snapshot      = std::move(content.snapshot);
+
+  updateMemoryUsage();
+
+  return true;
+}
+
+
+std::size_t
+SnapshotCommand::
+contentMemoryUsage() const
+{
+  return static_cast<std::size_t>(_snapshot.capacity()) +
+         _nodeIds.capacity() * sizeof(NodeId) +
+         _connectionIds.capacity() * sizeof(ConnectionId);
+}
+
+
+//------
+
+
 DeleteCommand::
 DeleteCommand(BasicGraphicsScene* scene)
-  : _scene(scene)
+  : SnapshotCommand(scene)
 {
   auto & graphModel = _scene->graphModel();
 
-  QJsonArray connJsonArray;
+  // A connection could be selected and attached to a selected node at once.
+  std::unordered_set<ConnectionId> knownConnections;
+
+  auto addConnection =
+    [this, &knownConnections](ConnectionId const & cid)
+    {
+      if (knownConnections.insert(cid).second)
+        _connectionIds.push_back(cid);
+    };
+
   // Delete the selected connections first, ensuring that they won't be
   // automatically deleted when selected nodes are deleted (deleting a
   // node deletes some connections as well)
-  for (QGraphicsItem * item : _scene->selectedItems())
+  for (auto const & cid : _scene->selectedConnectionIds())
   {
-    if (auto c = qgraphicsitem_cast<ConnectionGraphicsObject*>(item))
-    {
-      auto const& cid = c->connectionId();
-
-      connJsonArray.append(graphModel.saveConnection(cid));
-    }
+    addConnection(cid);
   }
 
-  QJsonArray nodesJsonArray;
   // Delete the nodes; this will delete many of the connections.
   // Selected connections were already deleted prior to this loop,
-  for (QGraphicsItem * item : _scene->selectedItems())
+  for (NodeId const nodeId : _scene->selectedNodeIds())
   {
-    if (auto n = qgraphicsitem_cast<NodeGraphicsObject*>(item))
+    // saving connections attached to the selected nodes
+    for (auto const & cid : graphModel.allConnectionIds(nodeId))
     {
-      // saving connections attached to the selected nodes
-      for (auto const & cid : graphModel.allConnectionIds(n->nodeId()))
-      {
-        connJsonArray.append(graphModel.saveConnection(cid));
-      }
-
-      nodesJsonArray.append(graphModel.saveNode(n->nodeId()));
+      addConnection(cid);
     }
+
+    _nodeIds.push_back(nodeId);
+  }
+
+  // Each item is converted and written separately, the whole JSON tree of
+  // the deleted part never exists in memory.
+  QCborStreamWriter writer(&_snapshot);
+
+  writer.startArray(static_cast<quint64>(_nodeIds.size()));
+  for (NodeId const nodeId : _nodeIds)
+  {
+    QCborValue::fromJsonValue(graphModel.saveNode(nodeId)).toCbor(writer);
   }
+  writer.endArray();
 
-  _sceneJson["nodes"] = nodesJsonArray;
-  _sceneJson["connections"] = connJsonArray;
+  _snapshot.squeeze();
+  _nodeIds.shrink_to_fit();
+  _connectionIds.shrink_to_fit();
+
+  updateMemoryUsage();
 }
 
+
 void
 DeleteCommand::
 undo()
 {
-  auto & graphModel = _scene->graphModel();
+  if (!restore())
+    return;
+
+  QByteArray const snapshot =
+    _compressed ? qUncompress(_snapshot) : _snapshot;
+
+  _scene->beginBatchInsertion();
+
+  _scene->graphModel().loadNodes(readNodeSnapshot(snapshot), _connectionIds);
+
+  _scene->endBatchInsertion();
+}
 
-  QJsonArray nodesJsonArray = _sceneJson["nodes"].toArray();
 
-  for (QJsonValueRef node : nodesJsonArray)
+void
+DeleteCommand::
+redo()
+{
+  if (!restore())
+    return;
+
+  auto & graphModel = _scene->graphModel();
+
+  for (auto const & cid : _connectionIds)
   {
-    graphModel.loadNode(node.toObject());
+    graphModel.deleteConnection(cid);
   }
 
-  QJsonArray connectionJsonArray = _sceneJson["connections"].toArray();
-
-  for (QJsonValueRef connection : connectionJsonArray)
+  for (NodeId const nodeId : _nodeIds)
   {
-    graphModel.loadConnection(connection.toObject());
+    graphModel.deleteNode(nodeId);
   }
 }
 
 
 void
 DeleteCommand::
-redo()
+compress()
+{
+  // A spilled snapshot keeps the state it had when written.
+  if (_compressed || isSpilled())
+    return;
+
+  _snapshot = qCompress(_snapshot);
+  _snapshot.squeeze();
+
+  _compressed = true;
+
+  updateMemoryUsage();
+}
+
+
+std::size_t
+DeleteCommand::
+memoryUsage() const
+{
+  return sizeof(DeleteCommand) + contentMemoryUsage();
+}
+
+
+//------
+
+
+QByteArray
+serializeSelection(BasicGraphicsScene & scene)
+{
+  auto & graphModel = scene.graphModel();
+
+  std::unordered_set<NodeId> const & selectedNodes = scene.selectedNodeIds();
+
+  std::vector<NodeId> const nodeIds(selectedNodes.begin(), selectedNodes.end());
+
+  std::vector<ConnectionId> connectionIds;
+
+  for (NodeId const nodeId : nodeIds)
+  {
+    for (auto const & cid : graphModel.allConnectionIds(nodeId))
+    {
+      // Each internal connection is seen from both of its nodes.
+      if (cid.outNodeId == nodeId && selectedNodes.count(cid.inNodeId) > 0)
+        connectionIds.push_back(cid);
+    }
+  }
+
+  QByteArray data;
+
+  QCborStreamWriter writer(&data);
+
+  writer.startArray(2);
+
+  writer.startArray(static_cast<quint64>(nodeIds.size()));
+  for (NodeId const nodeId : nodeIds)
+  {
+    QCborValue::fromJsonValue(graphModel.saveNode(nodeId)).toCbor(writer);
+  }
+  writer.endArray();
+
+  writer.startArray(static_cast<quint64>(connectionIds.size() * 4));
+  for (auto const & cid : connectionIds)
+  {
+    writer.append(static_cast<quint64>(cid.outNodeId));
+    writer.append(static_cast<quint64>(cid.outPortIndex));
+    writer.append(static_cast<quint64>(cid.inNodeId));
+    writer.append(static_cast<quint64>(cid.inPortIndex));
+  }
+  writer.endArray();
+
+  writer.endArray();
+
+  return data;
+}
+
+
+//------
+
+
+PasteCommand::
+PasteCommand(BasicGraphicsScene* scene,
+             QByteArray const &  selectionData,
+             QPointF const &     targetPos)
+  : SnapshotCommand(scene)
 {
   auto & graphModel = _scene->graphModel();
 
-  QJsonArray nodesJsonArray = _sceneJson["nodes"].toArray();
+  QCborArray const selection = QCborValue::fromCbor(selectionData).toArray();
+
+  QCborArray const nodes = selection.at(0).toArray();
+  QCborArray const connections = selection.at(1).toArray();
+
+  if (nodes.isEmpty())
+  {
+    updateMemoryUsage();
+    return;
+  }
+
+  std::vector<QJsonObject> nodeJsons;
+  nodeJsons.reserve(static_cast<std::size_t>(nodes.size()));
+
+  QPointF topLeft(std::numeric_limits<double>::max(),
+                  std::numeric_limits<double>::max());
+
+  for (auto const & node : nodes)
+  {
+    nodeJsons.push_back(node.toMap().toJsonObject());
+
+    QJsonObject const posJson = nodeJsons.back()["position"].toObject();
+
+    topLeft.setX(std::min(topLeft.x(), posJson["x"].toDouble()));
+    topLeft.setY(std::min(topLeft.y(), posJson["y"].toDouble()));
+  }
+
+  QPointF const offset = targetPos - topLeft;
+
+  // The copied ids may be taken by now, new ones are assigned to all nodes.
+  // No node uses the ids from newNodeId() upwards.
+  std::unordered_map<NodeId, NodeId> newIds;
+
+  NodeId nextId = graphModel.newNodeId();
+
+  _nodeIds.reserve(nodeJsons.size());
+
+  QCborStreamWriter writer(&_snapshot);
+
+  writer.startArray(static_cast<quint64>(nodeJsons.size()));
+
+  for (QJsonObject & nodeJson : nodeJsons)
+  {
+    NodeId const oldId = static_cast<NodeId>(nodeJson["id"].toInt());
+
+    newIds[oldId] = nextId;
+    _nodeIds.push_back(nextId);
+
+    nodeJson["id"] = static_cast<qint64>(nextId);
+
+    QJsonObject posJson = nodeJson["position"].toObject();
+    posJson["x"] = posJson["x"].toDouble() + offset.x();
+    posJson["y"] = posJson["y"].toDouble() + offset.y();
+    nodeJson["position"] = posJson;
+
+    QCborValue::fromJsonValue(nodeJson).toCbor(writer);
+
+    ++nextId;
+  }
+
+  writer.endArray();
+
+  _snapshot.squeeze();
 
-  for (QJsonValueRef node : nodesJsonArray)
+  for (qsizetype i = 0; i + 3 < connections.size(); i += 4)
   {
-    QJsonObject nodeJson = node.toObject();
-    graphModel.deleteNode(static_cast<NodeId>(nodeJson["id"].toInt()));
+    auto outIt = newIds.find(static_cast<NodeId>(connections.at(i).toInteger()));
+    auto inIt  = newIds.find(static_cast<NodeId>(connections.at(i + 2).toInteger()));
+
+    if (outIt == newIds.end() || inIt == newIds.end())
+      continue;
+
+    _connectionIds.push_back(
+      ConnectionId{outIt->second,
+                   static_cast<PortIndex>(connections.at(i + 1).toInteger()),
+                   inIt->second,
+                   static_cast<PortIndex>(connections.at(i + 3).toInteger())});
   }
 
-  QJsonArray connectionJsonArray = _sceneJson["connections"].toArray();
+  updateMemoryUsage();
+}
+
+
+void
+PasteCommand::
+undo()
+{
+  if (!restore())
+    return;
+
+  auto & graphModel = _scene->graphModel();
 
-  for (QJsonValueRef connection : connectionJsonArray)
+  // Connections are removed together with the nodes.
+  for (NodeId const nodeId : _nodeIds)
   {
-    QJsonObject connJson = connection.toObject();
+    graphModel.deleteNode(nodeId);
+  }
+}
 
-    ConnectionId connId{static_cast<NodeId>(connJson["outNodeId"].toInt()),
-                        static_cast<PortIndex>(connJson["outPortIndex"].toInt()),
-                        static_cast<NodeId>(connJson["intNodeId"].toInt()),
-                        static_cast<PortIndex>(connJson["inPortIndex"].toInt())};
 
-    graphModel.deleteConnection(connId);
+void
+PasteCommand::
+redo()
+{
+  if (!restore())
+    return;
+
+  _scene->beginBatchInsertion();
+
+  _scene->graphModel().loadNodes(readNodeSnapshot(_snapshot), _connectionIds);
+
+  _scene->endBatchInsertion();
+
+  // The pasted nodes replace the selection.
+  _scene->clearSelection();
+
+  for (NodeId const nodeId : _nodeIds)
+  {
+    if (auto ngo = _scene->nodeGraphicsObject(nodeId))
+      ngo->setSelected(true);
   }
 }
 
 
+std::size_t
+PasteCommand::
+memoryUsage() const
+{
+  return sizeof(PasteCommand) + contentMemoryUsage();
+}
+
+
+//------
 
 
 DisconnectCommand::
 DisconnectCommand(BasicGraphicsScene* scene,
                   ConnectionId const connId)
-  : _scene(scene)
+  : UndoCommand(scene)
   , _connId(connId)
 {
-  //
+  updateMemoryUsage();
 }
 
 void
@@ -140,10 +626,10 @@ redo()
 ConnectCommand::
 ConnectCommand(BasicGraphicsScene* scene,
                ConnectionId const connId)
-  : _scene(scene)
+  : UndoCommand(scene)
   , _connId(connId)
 {
-  //
+  updateMemoryUsage();
 }
 
 void
@@ -169,10 +655,11 @@ MoveNodeCommand::
 MoveNodeCommand(BasicGraphicsScene* scene,
                 NodeId const nodeId,
                 QPointF const &diff)
-  : _scene(scene)
+  : UndoCommand(scene)
   , _nodeId(nodeId)
   , _diff(diff)
 {
+  updateMemoryUsage();
 }
 
 void
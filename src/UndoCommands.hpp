@@ -1,18 +1,156 @@
 #pragma once
 
 #include "Definitions.hpp"
+#include "UndoSpillFile.hpp"
 
 #include <QUndoCommand>
+#include <QtCore/QByteArray>
 #include <QtCore/QPointF>
-#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace QtNodes
 {
 
 class BasicGraphicsScene;
+class UndoMemoryBudget;
 
+/// MIME type of the node selections put on the clipboard.
+inline QString
+selectionMimeType()
+{
+  return QStringLiteral("application/x-qtnodes-selection");
+}
 
-class DeleteCommand : public QUndoCommand
+/// Encodes the selected nodes and the connections between them as CBOR.
+/**
+ * The data is an array of the `saveNode` objects followed by a flat array
+ * of `outNodeId, outPortIndex, inNodeId, inPortIndex` quadruples.
+ * Connections leading to the nodes outside the selection are dropped.
+ */
+QByteArray
+serializeSelection(BasicGraphicsScene & scene);
+
+
+/// Base of the scene commands, accounting their memory.
+/**
+ * Each command reports its `memoryUsage()` to the UndoMemoryBudget of the
+ * scene when it is created, spilled, restored or destroyed. The budget keeps
+ * the running total instead of visiting the whole history. Commands holding
+ * graph snapshots override the spilling functions.
+ */
+class UndoCommand : public QUndoCommand
+{
+public:
+  explicit
+  UndoCommand(BasicGraphicsScene* scene);
+
+  ~UndoCommand() override;
+
+  /// Approximate number of bytes held by the command in memory.
+  virtual std::size_t memoryUsage() const = 0;
+
+  /// Compresses the content of an old command, nothing by default.
+  virtual void compress() {}
+
+  /// @returns `true` for the commands implementing `spill()`.
+  virtual bool spillable() const { return false; }
+
+  /// Moves the content of the command to the file.
+  /**
+   * @returns `false` and keeps the content in memory if the command can't
+   * be spilled or writing fails.
+   */
+  virtual bool spill(std::shared_ptr<UndoSpillFile>) { return false; }
+
+  virtual bool isSpilled() const { return false; }
+
+  /// Size of the record in the spill file, 0 if the command is in memory.
+  virtual qint64 spilledBytes() const { return 0; }
+
+protected:
+  /// Reports a changed `memoryUsage()` to the budget.
+  /**
+   * Called by the derived classes at the end of their constructors and
+   * whenever their content changes.
+   */
+  void updateMemoryUsage();
+
+protected:
+  BasicGraphicsScene* _scene;
+
+private:
+  UndoMemoryBudget & _memory;
+
+  std::size_t _reportedMemoryUsage;
+};
+
+
+/// Base of the commands holding node ids, connection ids and a snapshot.
+/**
+ * When the undo history exceeds its memory budget the whole content is
+ * moved to an UndoSpillFile. The derived commands call `restore()` at the
+ * start of `undo()` and `redo()` to read it back.
+ */
+class SnapshotCommand : public UndoCommand
+{
+public:
+  ~SnapshotCommand() override;
+
+  /// Moves the ids and the snapshot to the file.
+  bool spillable() const override { return true; }
+
+  bool spill(std::shared_ptr<UndoSpillFile> file) override;
+
+  bool isSpilled() const override { return _spillRecord.isValid(); }
+
+  qint64 spilledBytes() const override { return _spillRecord.size; }
+
+protected:
+  explicit
+  SnapshotCommand(BasicGraphicsScene* scene);
+
+  /// Reads the spilled content back into memory.
+  /**
+   * @returns `false` if the record can not be read. The command is left
+   * without content and does nothing then. It is marked obsolete and the
+   * whole undo stack is cleared afterwards, since the later commands may
+   * rely on the lost changes.
+   */
+  bool restore();
+
+  /// Bytes held by the ids and the snapshot.
+  std::size_t contentMemoryUsage() const;
+
+protected:
+  std::vector<NodeId> _nodeIds;
+
+  std::vector<ConnectionId> _connectionIds;
+
+  QByteArray _snapshot;
+
+  /// Set once `_snapshot` has been compressed with qCompress.
+  bool _compressed;
+
+private:
+  std::shared_ptr<UndoSpillFile> _spillFile;
+
+  UndoSpillFile::Record _spillRecord;
+};
+
+
+/// Deletes the selected nodes and connections.
+/**
+ * The deleted nodes are kept as one CBOR encoded snapshot of the `saveNode`
+ * output, which is much smaller than the equivalent QJsonObject tree. Redo
+ * only needs the ids and takes them from plain tables. The snapshot is
+ * decoded just in `undo()`, which restores the nodes and the connections
+ * with one `AbstractGraphModel::loadNodes` call in a scene batch.
+ */
+class DeleteCommand : public SnapshotCommand
 {
 public:
   DeleteCommand(BasicGraphicsScene* scene);
@@ -20,14 +158,44 @@ public:
   void undo() override;
   void redo() override;
 
-private:
-  BasicGraphicsScene* _scene;
+  /// Compresses the snapshot with qCompress. Done for old commands.
+  void compress() override;
+
+  bool isCompressed() const { return _compressed; }
+
+  std::size_t memoryUsage() const override;
+};
+
 
-  QJsonObject _sceneJson;
+/// Inserts nodes serialized by `serializeSelection` under new ids.
+/**
+ * The ids are remapped in the constructor to consecutive ids starting from
+ * `AbstractGraphModel::newNodeId()`.
+ * The snapshot is a CBOR array of the remapped node JSON objects. The nodes
+ * are inserted with `AbstractGraphModel::loadNodes` in one scene batch, see
+ * `BasicGraphicsScene::beginBatchInsertion`.
+ */
+class PasteCommand : public SnapshotCommand
+{
+public:
+  /**
+   * @param targetPos is the new position of the top-left corner of the
+   * bounding rectangle of the pasted node positions.
+   */
+  PasteCommand(BasicGraphicsScene* scene,
+               QByteArray const &  selectionData,
+               QPointF const &     targetPos);
+
+  void undo() override;
+  void redo() override;
+
+  bool isEmpty() const { return _nodeIds.empty() && !isSpilled(); }
+
+  std::size_t memoryUsage() const override;
 };
 
 
-class DisconnectCommand : public QUndoCommand
+class DisconnectCommand : public UndoCommand
 {
 public:
   DisconnectCommand(BasicGraphicsScene* scene,
@@ -36,14 +204,14 @@ public:
   void undo() override;
   void redo() override;
 
-private:
-  BasicGraphicsScene* _scene;
+  std::size_t memoryUsage() const override { return sizeof(*this); }
 
+private:
   ConnectionId _connId;
 };
 
 
-class ConnectCommand : public QUndoCommand
+class ConnectCommand : public UndoCommand
 {
 public:
   ConnectCommand(BasicGraphicsScene* scene,
@@ -52,14 +220,14 @@ public:
   void undo() override;
   void redo() override;
 
-private:
-  BasicGraphicsScene* _scene;
+  std::size_t memoryUsage() const override { return sizeof(*this); }
 
+private:
   ConnectionId _connId;
 };
 
 
-class MoveNodeCommand : public QUndoCommand
+class MoveNodeCommand : public UndoCommand
 {
 public:
   MoveNodeCommand(BasicGraphicsScene* scene,
@@ -73,8 +241,9 @@ public:
 
   bool mergeWith(QUndoCommand const *c) override;
 
+  std::size_t memoryUsage() const override { return sizeof(*this); }
+
 private:
-  BasicGraphicsScene* _scene;
   NodeId _nodeId;
   QPointF _diff;
 };
@@ -0,0 +1,124 @@
+#include "UndoMemoryBudget.hpp"
+
+#include "UndoCommands.hpp"
+#include "UndoSpillFile.hpp"
+
+#include <QUndoStack>
+
+#include <cstdlib>
+
+
+namespace
+{
+
+/// Commands this close to the undo index are never spilled.
+int const undoSpillDistance = 2;
+
+}
+
+
+namespace QtNodes
+{
+
+UndoMemoryBudget::
+UndoMemoryBudget(QUndoStack & undoStack)
+  : _undoStack(undoStack)
+  , _budget(0)
+  , _usage(0)
+  , _unspillableUsage(0)
+{
+  //
+}
+
+
+UndoMemoryBudget::
+~UndoMemoryBudget() = default;
+
+
+void
+UndoMemoryBudget::
+updateUsage(std::size_t const oldUsage, std::size_t const newUsage)
+{
+  _usage -= oldUsage;
+  _usage += newUsage;
+}
+
+
+void
+UndoMemoryBudget::
+setBudget(std::size_t const bytes)
+{
+  _budget = bytes;
+
+  _unspillableUsage = 0;
+
+  enforce();
+}
+
+
+BasicGraphicsScene::UndoMemoryStatistics
+UndoMemoryBudget::
+statistics() const
+{
+  BasicGraphicsScene::UndoMemoryStatistics statistics;
+
+  statistics.commandCount = _undoStack.count();
+  statistics.memoryUsage  = _usage;
+
+  for (int i = 0; i < _undoStack.count(); ++i)
+  {
+    auto command = dynamic_cast<UndoCommand const*>(_undoStack.command(i));
+
+    if (command && command->isSpilled())
+    {
+      ++statistics.spilledCommandCount;
+      statistics.spilledBytes += command->spilledBytes();
+    }
+  }
+
+  if (_spillFile)
+    statistics.spillFileSize = _spillFile->fileSize();
+
+  return statistics;
+}
+
+
+void
+UndoMemoryBudget::
+enforce()
+{
+  if (_budget == 0 || _usage <= _budget)
+    return;
+
+  // Nothing could be spilled at this usage before, e.g. while a merging
+  // MoveNodeCommand changes the index on every step of a drag.
+  if (_usage <= _unspillableUsage)
+    return;
+
+  // The commands next to the current index are the next ones to be undone
+  // or redone, and were possibly just read back. They stay in memory.
+  int const index = _undoStack.index();
+
+  for (int i = 0; i < _undoStack.count() && _usage > _budget; ++i)
+  {
+    if (std::abs(i - index) <= undoSpillDistance)
+      continue;
+
+    // The stack only gives const access to the commands it owns.
+    auto command = dynamic_cast<UndoCommand*>(const_cast<QUndoCommand*>(_undoStack.command(i)));
+
+    if (!command || !command->spillable() || command->isSpilled())
+      continue;
+
+    if (!_spillFile)
+      _spillFile = std::make_shared<UndoSpillFile>();
+
+    // The disk is full or not writable, nothing else would succeed.
+    if (!command->spill(_spillFile))
+      break;
+  }
+
+  _unspillableUsage = (_usage > _budget) ? _usage : 0;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "BasicGraphicsScene.hpp"
+
+#include <cstddef>
+#include <memory>
+
+class QUndoStack;
+
+namespace QtNodes
+{
+
+class UndoSpillFile;
+
+/// Memory accounting and spilling policy of the scene undo history.
+/**
+ * Each UndoCommand reports its memory usage here, so the running total is
+ * known without visiting the whole history. When the total exceeds the
+ * budget, the oldest spillable commands are moved to an UndoSpillFile.
+ */
+class UndoMemoryBudget
+{
+public:
+  explicit
+  UndoMemoryBudget(QUndoStack & undoStack);
+
+  ~UndoMemoryBudget();
+
+  UndoMemoryBudget(UndoMemoryBudget const &) = delete;
+
+  UndoMemoryBudget & operator=(UndoMemoryBudget const &) = delete;
+
+  /// Called by UndoCommand when its memory usage changes.
+  void
+  updateUsage(std::size_t const oldUsage, std::size_t const newUsage);
+
+  std::size_t
+  usage() const { return _usage; }
+
+  /// 0 means no limit.
+  void
+  setBudget(std::size_t const bytes);
+
+  std::size_t
+  budget() const { return _budget; }
+
+  BasicGraphicsScene::UndoMemoryStatistics
+  statistics() const;
+
+  /// Spills the oldest commands until the history fits into the budget.
+  void
+  enforce();
+
+private:
+  QUndoStack & _undoStack;
+
+  std::size_t _budget;
+
+  /// Running total of the memory reported by the UndoCommand instances.
+  std::size_t _usage;
+
+  /// Usage left over budget by the last spilling pass, 0 if it fit.
+  std::size_t _unspillableUsage;
+
+  /// Created when the first command is spilled.
+  std::shared_ptr<UndoSpillFile> _spillFile;
+};
+
+}
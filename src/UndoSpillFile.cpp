@@ -0,0 +1,152 @@
+#include "UndoSpillFile.hpp"
+
+#include <QtCore/QDir>
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace QtNodes
+{
+
+UndoSpillFile::
+UndoSpillFile()
+  : _file(QDir::tempPath() + QStringLiteral("/qtnodes-undo-XXXXXX"))
+  , _recordCount(0)
+  , _recordBytes(0)
+{}
+
+
+UndoSpillFile::Record
+UndoSpillFile::
+write(QByteArray const & data)
+{
+  Record record;
+
+  if (!_file.isOpen() && !_file.open())
+    return record;
+
+  qint64 const size = data.size();
+
+  // First fit among the holes, appended otherwise.
+  auto hole = std::find_if(_holes.begin(), _holes.end(),
+                           [size](std::pair<qint64 const, qint64> const & h)
+                           { return h.second >= size; });
+
+  qint64 const fileSize = _file.size();
+  qint64 const offset   = hole != _holes.end() ? hole->first : fileSize;
+
+  if (!_file.seek(offset) || _file.write(data) != size)
+  {
+    // Drops the partially written tail, a hole stays reusable.
+    if (offset == fileSize)
+      _file.resize(offset);
+
+    return record;
+  }
+
+  if (hole != _holes.end())
+  {
+    qint64 const rest = hole->second - size;
+
+    _holes.erase(hole);
+
+    if (rest > 0)
+      _holes.emplace(offset + size, rest);
+  }
+
+  record.offset = offset;
+  record.size   = size;
+
+  ++_recordCount;
+  _recordBytes += record.size;
+
+  return record;
+}
+
+
+QByteArray
+UndoSpillFile::
+read(Record const & record)
+{
+  if (!record.isValid() || !_file.isOpen() || !_file.seek(record.offset))
+    return QByteArray();
+
+  QByteArray data = _file.read(record.size);
+
+  if (data.size() != record.size)
+    return QByteArray();
+
+  return data;
+}
+
+
+void
+UndoSpillFile::
+release(Record const & record)
+{
+  if (!record.isValid())
+    return;
+
+  --_recordCount;
+  _recordBytes -= record.size;
+
+  if (_recordCount == 0)
+  {
+    _holes.clear();
+    _file.resize(0);
+    return;
+  }
+
+  qint64 offset = record.offset;
+  qint64 size   = record.size;
+
+  // Merges with the neighbouring holes.
+  auto next = _holes.lower_bound(offset);
+
+  if (next != _holes.end() && next->first == offset + size)
+  {
+    size += next->second;
+    next = _holes.erase(next);
+  }
+
+  if (next != _holes.begin())
+  {
+    auto previous = std::prev(next);
+
+    if (previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      size  += previous->second;
+      _holes.erase(previous);
+    }
+  }
+
+  if (offset + size >= _file.size())
+    _file.resize(offset);
+  else
+    _holes.emplace(offset, size);
+}
+
+
+qint64
+UndoSpillFile::
+holeBytes() const
+{
+  qint64 bytes = 0;
+
+  for (auto const & hole : _holes)
+    bytes += hole.second;
+
+  return bytes;
+}
+
+
+qint64
+UndoSpillFile::
+fileSize() const
+{
+  return _file.isOpen() ? _file.size() : 0;
+}
+
+}
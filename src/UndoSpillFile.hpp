@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QTemporaryFile>
+
+#include <map>
+
+namespace QtNodes
+{
+
+/// Temporary file receiving undo commands evicted from memory.
+/**
+ * Released records leave holes which are reused by later records of at most
+ * the same size. A hole reaching the end of the file is cut off, so the file
+ * never grows much past the live records even when commands are restored
+ * and spilled again and again.
+ */
+class UndoSpillFile
+{
+public:
+  struct Record
+  {
+    qint64 offset = -1;
+    qint64 size   = 0;
+
+    bool isValid() const { return offset >= 0; }
+  };
+
+public:
+  UndoSpillFile();
+
+  UndoSpillFile(UndoSpillFile const &) = delete;
+
+  UndoSpillFile & operator=(UndoSpillFile const &) = delete;
+
+  /// @returns an invalid record if the file could not be written.
+  Record
+  write(QByteArray const & data);
+
+  /// @returns an empty array if the record could not be read.
+  QByteArray
+  read(Record const & record);
+
+  /// The record is no longer needed by its command.
+  void
+  release(Record const & record);
+
+  /// Bytes occupied on the disk by the released records.
+  qint64
+  holeBytes() const;
+
+  int
+  recordCount() const { return _recordCount; }
+
+  /// Bytes of the live records.
+  qint64
+  recordBytes() const { return _recordBytes; }
+
+  /// Bytes occupied on the disk, released records included.
+  qint64
+  fileSize() const;
+
+  QString
+  fileName() const { return _file.fileName(); }
+
+private:
+  QTemporaryFile _file;
+
+  int _recordCount;
+
+  qint64 _recordBytes;
+
+  /// Offsets and sizes of the released ranges, adjacent ones merged.
+  std::map<qint64, qint64> _holes;
+};
+
+}
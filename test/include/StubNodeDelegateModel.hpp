@@ -0,0 +1,157 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QtNodes/NodeData>
+#include <QtNodes/NodeDelegateModel>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+/// Payload of the stub models, tagged with an arbitrary data type.
+class StubNodeData : public QtNodes::NodeData
+{
+public:
+  StubNodeData(QtNodes::NodeDataType type, int value)
+    : _type(std::move(type))
+    , _value(value)
+  {}
+
+  QtNodes::NodeDataType
+  type() const override { return _type; }
+
+  int
+  value() const { return _value; }
+
+private:
+  QtNodes::NodeDataType _type;
+
+  int _value;
+};
+
+/**
+ * Delegate with the same number of input and output ports, all of one data
+ * type. Remembers the data it receives and emits whatever `setOutData` is
+ * given.
+ */
+class StubNodeDelegateModel : public QtNodes::NodeDelegateModel
+{
+public:
+  StubNodeDelegateModel(QString               name,
+                        QtNodes::NodeDataType type,
+                        unsigned int          nPorts         = 1,
+                        unsigned int          streamCapacity = 0)
+    : _name(std::move(name))
+    , _type(std::move(type))
+    , _nPorts(nPorts)
+    , _streamCapacity(streamCapacity)
+    , _in(nPorts)
+    , _inChannels(nPorts)
+  {}
+
+  QString
+  caption() const override { return _name; }
+
+  QString
+  name() const override { return _name; }
+
+  unsigned int
+  nPorts(QtNodes::PortType) const override { return _nPorts; }
+
+  QtNodes::NodeDataType
+  dataType(QtNodes::PortType, QtNodes::PortIndex) const override
+  {
+    ++_dataTypeCount;
+
+    return _type;
+  }
+
+  unsigned int
+  portStreamCapacity(QtNodes::PortType, QtNodes::PortIndex) const override
+  {
+    return _streamCapacity;
+  }
+
+  void
+  setInData(std::shared_ptr<QtNodes::NodeData> nodeData,
+            QtNodes::PortIndex const           portIndex) override
+  {
+    _in[portIndex] = std::move(nodeData);
+
+    ++_inDataCount;
+  }
+
+  void
+  setInChannel(std::shared_ptr<QtNodes::NodeDataChannel> channel,
+               QtNodes::PortIndex const                  portIndex) override
+  {
+    _inChannels[portIndex] = std::move(channel);
+  }
+
+  std::shared_ptr<QtNodes::NodeData>
+  outData(QtNodes::PortIndex const) override { return _out; }
+
+  QWidget *
+  embeddedWidget() override { return nullptr; }
+
+  void
+  setOutData(std::shared_ptr<QtNodes::NodeData> nodeData)
+  {
+    _out = std::move(nodeData);
+
+    for (QtNodes::PortIndex i = 0; i < _nPorts; ++i)
+      Q_EMIT dataUpdated(i);
+  }
+
+  /// Changes the data type of all the ports.
+  void
+  setDataType(QtNodes::NodeDataType type) { _type = std::move(type); }
+
+  std::shared_ptr<QtNodes::NodeData> const &
+  inData(QtNodes::PortIndex const portIndex) const { return _in[portIndex]; }
+
+  std::shared_ptr<QtNodes::NodeDataChannel> const &
+  inChannel(QtNodes::PortIndex const portIndex) const { return _inChannels[portIndex]; }
+
+  /// Number of `setInData` calls on all the ports.
+  int
+  inDataCount() const { return _inDataCount; }
+
+  /// Number of `dataType` calls on all the ports.
+  int
+  dataTypeCount() const { return _dataTypeCount; }
+
+private:
+  QString _name;
+
+  QtNodes::NodeDataType _type;
+
+  unsigned int _nPorts;
+
+  unsigned int _streamCapacity;
+
+  std::shared_ptr<QtNodes::NodeData> _out;
+
+  std::vector<std::shared_ptr<QtNodes::NodeData>> _in;
+
+  std::vector<std::shared_ptr<QtNodes::NodeDataChannel>> _inChannels;
+
+  int _inDataCount = 0;
+
+  mutable int _dataTypeCount = 0;
+};
+
+/// Registers a StubNodeDelegateModel variant under `name`.
+inline void
+registerStubModel(QtNodes::NodeDelegateModelRegistry & registry,
+                  QString const &                      name,
+                  QtNodes::NodeDataType const &        type,
+                  unsigned int                         nPorts         = 1,
+                  unsigned int                         streamCapacity = 0)
+{
+  registry.registerModel<StubNodeDelegateModel>(
+    [name, type, nPorts, streamCapacity]()
+    {
+      return std::make_unique<StubNodeDelegateModel>(name, type, nPorts, streamCapacity);
+    });
+}
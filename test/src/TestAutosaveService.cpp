@@ -0,0 +1,134 @@
+#include "ApplicationSetup.hpp"
+#include "StubNodeDelegateModel.hpp"
+
+#include <QtNodes/AutosaveService>
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QSignalSpy>
+
+#include <memory>
+
+using QtNodes::AutosaveService;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModelRegistry;
+
+namespace
+{
+int const saveTimeout = 5000;
+
+std::shared_ptr<NodeDelegateModelRegistry>
+stubRegistry()
+{
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stub", NodeDataType{"int", "Integer"});
+
+  return registry;
+}
+
+/// Number of nodes in the saved document, -1 if it can't be read.
+int
+savedNodeCount(QString const & path)
+{
+  QFile file(path);
+
+  if (!file.open(QIODevice::ReadOnly))
+    return -1;
+
+  QJsonDocument const document = QJsonDocument::fromJson(file.readAll());
+
+  if (!document.isObject())
+    return -1;
+
+  return document.object()["nodes"].toArray().size();
+}
+}
+
+TEST_CASE("AutosaveService writes the graph only when it has changed", "[autosave]")
+{
+  auto app = applicationSetup();
+
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("autosave.flow");
+
+  DataFlowGraphModel model(stubRegistry());
+  model.addNode("Stub");
+
+  AutosaveService autosave(model);
+  autosave.setFilePath(path);
+
+  QSignalSpy saved(&autosave, &AutosaveService::saved);
+  QSignalSpy failed(&autosave, &AutosaveService::saveFailed);
+
+  autosave.saveNow();
+
+  CHECK(autosave.isSaving());
+  REQUIRE(saved.wait(saveTimeout));
+
+  CHECK_FALSE(autosave.isSaving());
+  CHECK(saved.takeFirst().at(0).toString() == path);
+  CHECK(savedNodeCount(path) == 1);
+
+  // The graph is identical to the saved one, nothing is started.
+  autosave.saveNow();
+
+  CHECK_FALSE(autosave.isSaving());
+
+  model.addNode("Stub");
+  autosave.saveNow();
+
+  CHECK(autosave.isSaving());
+  REQUIRE(saved.wait(saveTimeout));
+
+  CHECK(savedNodeCount(path) == 2);
+  CHECK(failed.isEmpty());
+}
+
+TEST_CASE("AutosaveService reports failed saves", "[autosave]")
+{
+  auto app = applicationSetup();
+
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  // QSaveFile does not create missing directories.
+  QString const path = dir.filePath("missing/autosave.flow");
+
+  DataFlowGraphModel model(stubRegistry());
+  model.addNode("Stub");
+
+  AutosaveService autosave(model);
+  autosave.setFilePath(path);
+
+  QSignalSpy saved(&autosave, &AutosaveService::saved);
+  QSignalSpy failed(&autosave, &AutosaveService::saveFailed);
+
+  autosave.saveNow();
+
+  REQUIRE(failed.wait(saveTimeout));
+
+  QList<QVariant> const arguments = failed.takeFirst();
+
+  CHECK(arguments.at(0).toString() == path);
+  CHECK_FALSE(arguments.at(1).toString().isEmpty());
+  CHECK_FALSE(QFile::exists(path));
+
+  // Nothing was saved, so the unchanged graph is tried again.
+  autosave.saveNow();
+
+  CHECK(autosave.isSaving());
+  REQUIRE(failed.wait(saveTimeout));
+
+  CHECK(saved.isEmpty());
+}
@@ -0,0 +1,625 @@
+#include "ApplicationSetup.hpp"
+#include "ConnectionLayer.hpp"
+#include "StubNodeDelegateModel.hpp"
+#include "UndoCommands.hpp"
+#include "UndoSpillFile.hpp"
+
+#include <QtNodes/BasicGraphicsScene>
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/NodeDelegateModelRegistry>
+#include <QtNodes/internal/ConnectionGraphicsObject.hpp>
+#include <QtNodes/internal/NodeGraphicsObject.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QFile>
+#include <QtCore/QPointF>
+#include <QtCore/QPointer>
+#include <QtWidgets/QGraphicsSceneHoverEvent>
+#include <QtWidgets/QGraphicsView>
+#include <QtWidgets/QWidget>
+
+#include <memory>
+#include <unordered_set>
+
+using QtNodes::BasicGraphicsScene;
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::DeleteCommand;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::NodeRole;
+using QtNodes::PasteCommand;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::UndoSpillFile;
+
+namespace
+{
+NodeDataType const IntType{"int", "Integer"};
+
+QSize const widgetSize(80, 40);
+
+std::shared_ptr<NodeDelegateModelRegistry>
+stubRegistry()
+{
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stub", IntType, 2);
+
+  return registry;
+}
+
+/// Stub delegate with a fixed-size widget, counting how many were created.
+class WidgetNodeDelegateModel : public StubNodeDelegateModel
+{
+public:
+  explicit
+  WidgetNodeDelegateModel(int & createdWidgets, QSize sizeHint = widgetSize)
+    : StubNodeDelegateModel("Widget", IntType)
+    , _createdWidgets(createdWidgets)
+    , _sizeHint(sizeHint)
+  {}
+
+  ~WidgetNodeDelegateModel()
+  {
+    // Embedded widgets belong to their proxies.
+    if (_widget && !_widget->graphicsProxyWidget())
+      delete _widget;
+  }
+
+  QWidget *
+  embeddedWidget() override
+  {
+    if (!_widget)
+    {
+      _widget = new QWidget();
+      _widget->setFixedSize(widgetSize);
+
+      ++_createdWidgets;
+    }
+
+    return _widget;
+  }
+
+  QSize
+  embeddedWidgetSizeHint() const override { return _sizeHint; }
+
+private:
+  int & _createdWidgets;
+
+  QSize _sizeHint;
+
+  QPointer<QWidget> _widget;
+};
+}
+
+TEST_CASE("BasicGraphicsScene creates lazily embedded widgets on demand", "[gui]")
+{
+  auto app = applicationSetup();
+
+  int createdWidgets = 0;
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registry->registerModel<WidgetNodeDelegateModel>(
+    [&createdWidgets]()
+    {
+      return std::make_unique<WidgetNodeDelegateModel>(createdWidgets);
+    });
+
+  DataFlowGraphModel model(registry);
+
+  BasicGraphicsScene scene(model);
+  scene.setLazyWidgetEmbedding(true);
+
+  NodeId const nodeId = model.addNode("Widget");
+
+  // The node is laid out from the size hint.
+  QSize const hintedSize = model.nodeData(nodeId, NodeRole::Size).toSize();
+
+  CHECK(createdWidgets == 0);
+  CHECK(hintedSize.width() >= widgetSize.width());
+  CHECK(hintedSize.height() >= widgetSize.height());
+
+  auto ngo = scene.nodeGraphicsObject(nodeId);
+
+  REQUIRE(ngo);
+  CHECK_FALSE(ngo->widgetEmbedded());
+
+  ngo->ensureWidgetEmbedded();
+
+  CHECK(createdWidgets == 1);
+  CHECK(ngo->widgetEmbedded());
+
+  // An accurate hint keeps the node from growing once the widget is there.
+  CHECK(model.nodeData(nodeId, NodeRole::Size).toSize() == hintedSize);
+
+  ngo->releaseWidget();
+  ngo->ensureWidgetEmbedded();
+
+  CHECK(createdWidgets == 1);
+}
+
+TEST_CASE("BasicGraphicsScene lays out nodes without a size hint from their widget", "[gui]")
+{
+  auto app = applicationSetup();
+
+  int createdWidgets = 0;
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registry->registerModel<WidgetNodeDelegateModel>(
+    [&createdWidgets]()
+    {
+      return std::make_unique<WidgetNodeDelegateModel>(createdWidgets, QSize());
+    });
+
+  DataFlowGraphModel model(registry);
+
+  BasicGraphicsScene scene(model);
+  scene.setLazyWidgetEmbedding(true);
+
+  NodeId const nodeId = model.addNode("Widget");
+
+  // Only the proxy is deferred.
+  CHECK(createdWidgets == 1);
+
+  QSize const size = model.nodeData(nodeId, NodeRole::Size).toSize();
+
+  CHECK(size.width() >= widgetSize.width());
+  CHECK(size.height() >= widgetSize.height());
+
+  auto ngo = scene.nodeGraphicsObject(nodeId);
+
+  REQUIRE(ngo);
+  CHECK_FALSE(ngo->widgetEmbedded());
+
+  ngo->ensureWidgetEmbedded();
+
+  CHECK(createdWidgets == 1);
+  CHECK(model.nodeData(nodeId, NodeRole::Size).toSize() == size);
+}
+
+TEST_CASE("DeleteCommand restores deleted nodes and connections", "[undo]")
+{
+  auto app = applicationSetup();
+
+  DataFlowGraphModel model(stubRegistry());
+
+  BasicGraphicsScene scene(model);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+  NodeId const c = model.addNode("Stub");
+
+  model.setNodeData(b, NodeRole::Position, QPointF(100, 50));
+
+  ConnectionId const ab{a, 0, b, 0};
+  ConnectionId const bc{b, 1, c, 1};
+
+  model.addConnection(ab);
+  model.addConnection(bc);
+
+  REQUIRE(scene.nodeGraphicsObject(b));
+  scene.nodeGraphicsObject(b)->setSelected(true);
+
+  DeleteCommand command(&scene);
+
+  auto checkRoundTrip =
+    [&]()
+    {
+      command.redo();
+
+      CHECK_FALSE(model.nodeExists(b));
+      CHECK_FALSE(model.connectionExists(ab));
+      CHECK_FALSE(model.connectionExists(bc));
+
+      CHECK(model.nodeExists(a));
+      CHECK(model.nodeExists(c));
+
+      command.undo();
+
+      CHECK(model.nodeExists(b));
+      CHECK(model.nodeData(b, NodeRole::Position).toPointF() == QPointF(100, 50));
+      CHECK(model.connectionExists(ab));
+      CHECK(model.connectionExists(bc));
+    };
+
+  SECTION("from the plain snapshot")
+  {
+    checkRoundTrip();
+  }
+
+  SECTION("from the compressed snapshot")
+  {
+    command.compress();
+
+    REQUIRE(command.isCompressed());
+
+    checkRoundTrip();
+  }
+
+  SECTION("from the spill file")
+  {
+    command.compress();
+
+    std::size_t const usage = scene.undoStackMemoryUsage();
+
+    auto file = std::make_shared<UndoSpillFile>();
+
+    REQUIRE(command.spill(file));
+
+    CHECK(command.isSpilled());
+    CHECK(file->recordCount() == 1);
+    CHECK(scene.undoStackMemoryUsage() < usage);
+
+    checkRoundTrip();
+
+    CHECK_FALSE(command.isSpilled());
+    CHECK(file->recordCount() == 0);
+  }
+
+  SECTION("from an unreadable spill file")
+  {
+    auto file = std::make_shared<UndoSpillFile>();
+
+    REQUIRE(command.spill(file));
+    REQUIRE(QFile::resize(file->fileName(), 0));
+
+    command.redo();
+
+    // The command gives up and asks the stack to drop it.
+    CHECK(command.isObsolete());
+    CHECK(model.nodeExists(b));
+    CHECK(model.connectionExists(ab));
+  }
+}
+
+TEST_CASE("PasteCommand inserts copies under new ids", "[undo]")
+{
+  auto app = applicationSetup();
+
+  DataFlowGraphModel model(stubRegistry());
+
+  BasicGraphicsScene scene(model);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+  NodeId const c = model.addNode("Stub");
+
+  model.setNodeData(a, NodeRole::Position, QPointF(0, 0));
+  model.setNodeData(b, NodeRole::Position, QPointF(100, 50));
+
+  model.addConnection(ConnectionId{a, 0, b, 0});
+  model.addConnection(ConnectionId{b, 1, c, 1});
+
+  scene.nodeGraphicsObject(a)->setSelected(true);
+  scene.nodeGraphicsObject(b)->setSelected(true);
+
+  QByteArray const selection = QtNodes::serializeSelection(scene);
+
+  PasteCommand command(&scene, selection, QPointF(500, 500));
+
+  REQUIRE_FALSE(command.isEmpty());
+
+  command.redo();
+
+  std::unordered_set<NodeId> const allNodes = model.allNodeIds();
+
+  REQUIRE(allNodes.size() == 5);
+
+  NodeId pastedA = QtNodes::InvalidNodeId;
+  NodeId pastedB = QtNodes::InvalidNodeId;
+
+  for (NodeId const nodeId : allNodes)
+  {
+    QPointF const pos = model.nodeData(nodeId, NodeRole::Position).toPointF();
+
+    if (pos == QPointF(500, 500))
+      pastedA = nodeId;
+    else if (pos == QPointF(600, 550))
+      pastedB = nodeId;
+  }
+
+  REQUIRE(pastedA != QtNodes::InvalidNodeId);
+  REQUIRE(pastedB != QtNodes::InvalidNodeId);
+
+  SECTION("the ids do not collide with the originals")
+  {
+    std::unordered_set<NodeId> const originals{a, b, c};
+
+    CHECK(originals.count(pastedA) == 0);
+    CHECK(originals.count(pastedB) == 0);
+  }
+
+  SECTION("only the connections between pasted nodes are copied")
+  {
+    CHECK(model.connectionExists(ConnectionId{pastedA, 0, pastedB, 0}));
+
+    CHECK(model.allConnectionIds(pastedA).size() == 1);
+    CHECK(model.allConnectionIds(pastedB).size() == 1);
+
+    CHECK(model.allConnectionIds(c).size() == 1);
+  }
+
+  SECTION("the pasted nodes replace the selection")
+  {
+    CHECK(scene.selectedNodeIds() == std::unordered_set<NodeId>{pastedA, pastedB});
+  }
+
+  SECTION("undo and redo keep the new ids")
+  {
+    command.undo();
+
+    CHECK(model.allNodeIds().size() == 3);
+    CHECK_FALSE(model.nodeExists(pastedA));
+
+    command.redo();
+
+    CHECK(model.nodeExists(pastedA));
+    CHECK(model.nodeExists(pastedB));
+    CHECK(model.connectionExists(ConnectionId{pastedA, 0, pastedB, 0}));
+  }
+}
+
+TEST_CASE("BasicGraphicsScene locates the port nearest to a point", "[gui]")
+{
+  auto app = applicationSetup();
+
+  DataFlowGraphModel model(stubRegistry());
+
+  BasicGraphicsScene scene(model);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  model.setNodeData(a, NodeRole::Position, QPointF(0, 0));
+  model.setNodeData(b, NodeRole::Position, QPointF(1000, 0));
+
+  auto anchor =
+    [&](NodeId const nodeId, PortType const portType, PortIndex const portIndex)
+    {
+      return scene.nodeGeometry().portScenePosition(
+        nodeId, portType, portIndex, scene.nodeGraphicsObject(nodeId)->sceneTransform());
+    };
+
+  qreal const radius = 5.0;
+
+  QPointF const target = anchor(a, PortType::In, 1);
+
+  SECTION("a port within the radius")
+  {
+    auto const location = scene.locatePort(target + QPointF(2, 1), PortType::In, radius);
+
+    CHECK(location.nodeId == a);
+    CHECK(location.portIndex == 1);
+    CHECK(location.scenePos == target);
+  }
+
+  SECTION("ports of the other type are ignored")
+  {
+    auto const location = scene.locatePort(target, PortType::Out, radius);
+
+    CHECK(location.nodeId == QtNodes::InvalidNodeId);
+  }
+
+  SECTION("nothing beyond the radius")
+  {
+    auto const location =
+      scene.locatePort(target + QPointF(-2 * radius, 0), PortType::In, radius);
+
+    CHECK(location.nodeId == QtNodes::InvalidNodeId);
+  }
+
+  SECTION("rejected ports are skipped")
+  {
+    auto const location =
+      scene.locatePort(target,
+                       PortType::In,
+                       radius,
+                       [](NodeId, PortIndex const portIndex) { return portIndex != 1; });
+
+    CHECK(location.nodeId == QtNodes::InvalidNodeId);
+  }
+
+  SECTION("the anchors follow a moved node")
+  {
+    // Warms the cached anchors up.
+    scene.locatePort(target, PortType::In, radius);
+
+    model.setNodeData(a, NodeRole::Position, QPointF(0, 500));
+
+    CHECK(scene.locatePort(target, PortType::In, radius).nodeId == QtNodes::InvalidNodeId);
+
+    auto const location =
+      scene.locatePort(target + QPointF(0, 500), PortType::In, radius);
+
+    CHECK(location.nodeId == a);
+    CHECK(location.portIndex == 1);
+  }
+}
+
+TEST_CASE("ConnectionLayer paints only the idle connections", "[gui]")
+{
+  auto app = applicationSetup();
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stub", IntType);
+
+  DataFlowGraphModel model(registry);
+  BasicGraphicsScene scene(model);
+
+  scene.setBatchedConnectionPainting(true);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  ConnectionId const connectionId{a, 0, b, 0};
+
+  model.addConnection(connectionId);
+
+  QtNodes::ConnectionLayer const * layer = scene.connectionLayer();
+  QtNodes::ConnectionGraphicsObject * cgo = scene.connectionGraphicsObject(connectionId);
+
+  REQUIRE(layer);
+  REQUIRE(cgo);
+
+  // The layer applies the changes of the connections in a posted call.
+  QCoreApplication::processEvents();
+
+  CHECK(layer->paintsConnection(*cgo));
+
+  SECTION("selected connections leave the layer until they are deselected")
+  {
+    cgo->setSelected(true);
+    QCoreApplication::processEvents();
+
+    CHECK_FALSE(layer->paintsConnection(*cgo));
+
+    cgo->setSelected(false);
+    QCoreApplication::processEvents();
+
+    CHECK(layer->paintsConnection(*cgo));
+  }
+
+  SECTION("hovered connections leave the layer until the cursor leaves")
+  {
+    QGraphicsSceneHoverEvent enter(QEvent::GraphicsSceneHoverEnter);
+    scene.sendEvent(cgo, &enter);
+    QCoreApplication::processEvents();
+
+    CHECK_FALSE(layer->paintsConnection(*cgo));
+
+    QGraphicsSceneHoverEvent leave(QEvent::GraphicsSceneHoverLeave);
+    scene.sendEvent(cgo, &leave);
+    QCoreApplication::processEvents();
+
+    CHECK(layer->paintsConnection(*cgo));
+  }
+
+  SECTION("deleted connections are dropped")
+  {
+    model.deleteConnection(connectionId);
+    QCoreApplication::processEvents();
+
+    CHECK(scene.connectionGraphicsObject(connectionId) == nullptr);
+    CHECK(layer->boundingRect().isEmpty());
+  }
+}
+
+TEST_CASE("BasicGraphicsScene reuses the objects of deleted nodes", "[gui]")
+{
+  auto app = applicationSetup();
+
+  DataFlowGraphModel model(stubRegistry());
+
+  BasicGraphicsScene scene(model);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  QPointer<QtNodes::NodeGraphicsObject> objectA = scene.nodeGraphicsObject(a);
+  QPointer<QtNodes::NodeGraphicsObject> objectB = scene.nodeGraphicsObject(b);
+
+  REQUIRE(objectA);
+  REQUIRE(objectB);
+
+  SECTION("pooled objects are bound to new nodes")
+  {
+    model.deleteNode(a);
+
+    REQUIRE(objectA);
+    CHECK(objectA->scene() == nullptr);
+
+    NodeId const c = model.addNode("Stub");
+
+    CHECK(scene.nodeGraphicsObject(c) == objectA.data());
+    CHECK(objectA->nodeId() == c);
+    CHECK(objectA->scene() == &scene);
+  }
+
+  SECTION("objects beyond the limit are deleted")
+  {
+    scene.setGraphicsObjectPoolLimit(1);
+
+    model.deleteNode(a);
+    model.deleteNode(b);
+
+    CHECK(objectA);
+    CHECK_FALSE(objectB);
+
+    // Lowering the limit trims the pool.
+    scene.setGraphicsObjectPoolLimit(0);
+
+    CHECK_FALSE(objectA);
+  }
+}
+
+TEST_CASE("BasicGraphicsScene repositions offscreen connections once they are shown", "[gui]")
+{
+  auto app = applicationSetup();
+
+  DataFlowGraphModel model(stubRegistry());
+
+  BasicGraphicsScene scene(model);
+
+  scene.setConnectionCulling(true);
+  scene.setConnectionUpdateInterval(0);
+
+  // The view shows the area around the origin only.
+  QGraphicsView view(&scene);
+  view.setSceneRect(QRectF(0, 0, 200, 200));
+  view.resize(200, 200);
+  view.show();
+
+  scene.invalidateVisibleSceneRect();
+
+  QRectF const offscreen(900, -500, 1000, 1000);
+
+  REQUIRE_FALSE(scene.visibleSceneRect().isEmpty());
+  REQUIRE_FALSE(scene.visibleSceneRect().intersects(offscreen));
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  model.setNodeData(a, NodeRole::Position, QPointF(1000, 0));
+  model.setNodeData(b, NodeRole::Position, QPointF(1400, 0));
+
+  ConnectionId const connectionId{a, 0, b, 0};
+
+  model.addConnection(connectionId);
+
+  auto cgo = scene.connectionGraphicsObject(connectionId);
+  auto ngo = scene.nodeGraphicsObject(b);
+
+  REQUIRE(cgo);
+  REQUIRE(ngo);
+
+  auto inPortPosition = [&]()
+  {
+    return scene.nodeGeometry().portScenePosition(b, PortType::In, 0, ngo->sceneTransform());
+  };
+
+  // Brings the connection up to date with both nodes.
+  scene.updateStaleConnections(offscreen);
+
+  CHECK(cgo->mapToScene(cgo->in()) == inPortPosition());
+
+  model.setNodeData(b, NodeRole::Position, QPointF(1400, 300));
+
+  QPointF const stalePosition = cgo->mapToScene(cgo->in());
+
+  CHECK(stalePosition != inPortPosition());
+
+  // A rect away from the connection leaves it stale.
+  scene.updateStaleConnections(QRectF(-1000, -1000, 200, 200));
+
+  CHECK(cgo->mapToScene(cgo->in()) == stalePosition);
+
+  scene.updateStaleConnections(offscreen);
+
+  CHECK(cgo->mapToScene(cgo->in()) == inPortPosition());
+}
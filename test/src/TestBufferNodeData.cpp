@@ -0,0 +1,136 @@
+#include <QtNodes/BufferNodeData>
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <memory>
+
+using QtNodes::BufferNodeData;
+using QtNodes::NodeData;
+using QtNodes::NodeDataType;
+
+namespace
+{
+NodeDataType const BytesType{"bytes", "Bytes"};
+
+std::shared_ptr<BufferNodeData>
+filledBuffer(char const value)
+{
+  auto buffer = std::make_shared<BufferNodeData>(BytesType, 16);
+
+  std::memset(buffer->data(), value, buffer->size());
+
+  return buffer;
+}
+
+bool
+filledWith(BufferNodeData const & buffer, char const value)
+{
+  auto bytes = buffer.constDataAs<char>();
+
+  for (std::size_t i = 0; i < buffer.size(); ++i)
+  {
+    if (bytes[i] != value)
+      return false;
+  }
+
+  return true;
+}
+}
+
+TEST_CASE("BufferNodeData copies share the memory until written", "[buffer]")
+{
+  auto buffer = filledBuffer('a');
+
+  CHECK_FALSE(buffer->isShared());
+  CHECK(reinterpret_cast<std::uintptr_t>(buffer->constData()) % buffer->alignment() == 0);
+
+  BufferNodeData copy(*buffer);
+
+  CHECK(buffer->isShared());
+  CHECK(copy.constData() == buffer->constData());
+
+  std::memset(copy.data(), 'b', copy.size());
+
+  CHECK(copy.constData() != buffer->constData());
+  CHECK(filledWith(*buffer, 'a'));
+  CHECK(filledWith(copy, 'b'));
+  CHECK_FALSE(buffer->isShared());
+}
+
+TEST_CASE("BufferNodeData views keep the memory shared", "[buffer]")
+{
+  auto buffer = filledBuffer('a');
+
+  BufferNodeData::View view = buffer->view();
+
+  CHECK(buffer->isShared());
+
+  std::memset(buffer->data(), 'b', buffer->size());
+
+  CHECK(view.dataAs<char>()[0] == 'a');
+  CHECK(buffer->constDataAs<char>()[0] == 'b');
+}
+
+TEST_CASE("BufferNodeData detach protects fan-out receivers", "[buffer]")
+{
+  // What an output port connected to two inputs hands to each of them.
+  std::shared_ptr<NodeData> upstream = filledBuffer('a');
+  std::shared_ptr<NodeData> first    = upstream;
+  std::shared_ptr<NodeData> second   = upstream;
+
+  void const * memory = std::static_pointer_cast<BufferNodeData>(upstream)->constData();
+
+  auto writable = BufferNodeData::detach(std::move(first));
+
+  REQUIRE(writable);
+  CHECK(first == nullptr);
+  CHECK(writable.get() != upstream.get());
+  CHECK(writable->constData() != memory);
+
+  std::memset(writable->data(), 'b', writable->size());
+
+  CHECK(filledWith(*std::static_pointer_cast<BufferNodeData>(second), 'a'));
+  CHECK(filledWith(*std::static_pointer_cast<BufferNodeData>(upstream), 'a'));
+  CHECK(filledWith(*writable, 'b'));
+}
+
+TEST_CASE("BufferNodeData detach reuses a sole owner", "[buffer]")
+{
+  auto buffer = filledBuffer('a');
+
+  BufferNodeData const * object = buffer.get();
+  void const *           memory = buffer->constData();
+
+  SECTION("exclusive object and memory are written in place")
+  {
+    auto writable = BufferNodeData::detach(std::move(buffer));
+
+    CHECK(writable.get() == object);
+    CHECK(writable->constData() == memory);
+  }
+
+  SECTION("exclusive object with shared memory gets a private block")
+  {
+    BufferNodeData retyped(NodeDataType{"other", "Other"}, *buffer);
+
+    auto writable = BufferNodeData::detach(std::move(buffer));
+
+    CHECK(writable.get() == object);
+    CHECK(writable->constData() != memory);
+    CHECK(retyped.constData() == memory);
+  }
+
+  SECTION("other data types are left alone")
+  {
+    struct OtherData : NodeData
+    {
+      NodeDataType type() const override { return BytesType; }
+    };
+
+    std::shared_ptr<NodeData> other = std::make_shared<OtherData>();
+
+    CHECK(BufferNodeData::detach(std::move(other)) == nullptr);
+    CHECK(other != nullptr);
+  }
+}
@@ -0,0 +1,147 @@
+#include <QtNodes/ConnectionIdMap>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using QtNodes::ConnectionId;
+using QtNodes::ConnectionIdMap;
+
+namespace
+{
+/// Share of the buckets in use and the longest bucket after hashing
+/// `bucketCount` generated ids into `bucketCount` buckets.
+struct BucketStatistics
+{
+  double usedShare;
+  int    maxLoad;
+};
+
+BucketStatistics
+bucketStatistics(std::size_t const                               bucketCount,
+                 std::function<ConnectionId(std::size_t)> const & generate)
+{
+  std::vector<int> loads(bucketCount, 0);
+
+  for (std::size_t k = 0; k < bucketCount; ++k)
+    ++loads[std::hash<ConnectionId>()(generate(k)) & (bucketCount - 1)];
+
+  BucketStatistics statistics{0.0, 0};
+
+  for (int const load : loads)
+  {
+    if (load > 0)
+      statistics.usedShare += 1.0 / bucketCount;
+
+    statistics.maxLoad = std::max(statistics.maxLoad, load);
+  }
+
+  return statistics;
+}
+}
+
+TEST_CASE("ConnectionIdMap insert, find and erase", "[connectionid]")
+{
+  ConnectionIdMap<std::unique_ptr<int>> map;
+
+  std::unordered_map<ConnectionId, int> reference;
+
+  for (unsigned int i = 0; i < 3000; ++i)
+  {
+    ConnectionId const id{i % 50, i % 3, (i * 7) % 50, i % 2};
+
+    map[id] = std::make_unique<int>(static_cast<int>(i));
+    reference[id] = static_cast<int>(i);
+  }
+
+  CHECK(map.size() == reference.size());
+
+  for (auto const & entry : reference)
+  {
+    auto it = map.find(entry.first);
+
+    REQUIRE(it != map.end());
+    CHECK(*it->second == entry.second);
+  }
+
+  std::size_t erased = 0;
+
+  for (auto const & entry : reference)
+  {
+    if (entry.second % 2 == 0)
+      erased += map.erase(entry.first);
+  }
+
+  CHECK(map.size() == reference.size() - erased);
+
+  std::size_t visited = 0;
+
+  for (auto const & entry : map)
+  {
+    ++visited;
+
+    CHECK(reference.at(entry.first) == *entry.second);
+    CHECK(*entry.second % 2 == 1);
+  }
+
+  CHECK(visited == map.size());
+
+  map.clear();
+
+  CHECK(map.empty());
+  CHECK(map.begin() == map.end());
+  CHECK(map.count(ConnectionId{0, 0, 0, 0}) == 0);
+}
+
+TEST_CASE("ConnectionId hash spreads structured ids", "[connectionid]")
+{
+  std::size_t const bucketCount = 1 << 14;
+
+  // Random hashing leaves about 1 - 1/e, i.e. 63 %, of the buckets in use.
+  auto checkSpread =
+    [&](std::function<ConnectionId(std::size_t)> const & generate)
+    {
+      BucketStatistics const statistics = bucketStatistics(bucketCount, generate);
+
+      CHECK(statistics.usedShare > 0.6);
+      CHECK(statistics.maxLoad <= 10);
+    };
+
+  SECTION("Chains of nodes")
+  {
+    checkSpread([](std::size_t k)
+                {
+                  unsigned int const node = static_cast<unsigned int>(k / 4);
+                  unsigned int const port = static_cast<unsigned int>(k % 4);
+
+                  return ConnectionId{node, port, node + 1, port};
+                });
+  }
+
+  SECTION("Fan-out from a few sources")
+  {
+    checkSpread([](std::size_t k)
+                {
+                  return ConnectionId{static_cast<unsigned int>(k % 16),
+                                      0,
+                                      static_cast<unsigned int>(k / 16 + 16),
+                                      static_cast<unsigned int>(k % 4)};
+                });
+  }
+
+  SECTION("Dense grid")
+  {
+    checkSpread([](std::size_t k)
+                {
+                  return ConnectionId{static_cast<unsigned int>(k / 128),
+                                      static_cast<unsigned int>(k % 2),
+                                      static_cast<unsigned int>(k % 128),
+                                      static_cast<unsigned int>(k / 2 % 2)};
+                });
+  }
+}
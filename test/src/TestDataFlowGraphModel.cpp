@@ -0,0 +1,702 @@
+#include "StubNodeDelegateModel.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/NodeDataChannel>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QThread>
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::PortType;
+
+namespace
+{
+NodeDataType const IntType{"int", "Integer"};
+
+std::shared_ptr<NodeDelegateModelRegistry>
+stubRegistry()
+{
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stub", IntType, 3);
+
+  return registry;
+}
+
+QJsonObject
+stubNodeJson(NodeId const nodeId)
+{
+  QJsonObject internalData;
+  internalData["model-name"] = "Stub";
+
+  QJsonObject position;
+  position["x"] = 0.0;
+  position["y"] = 0.0;
+
+  QJsonObject nodeJson;
+  nodeJson["id"]            = static_cast<qint64>(nodeId);
+  nodeJson["internal-data"] = internalData;
+  nodeJson["position"]      = position;
+
+  return nodeJson;
+}
+}
+
+TEST_CASE("DataFlowGraphModel stores connections by both nodes", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+  NodeId const c = model.addNode("Stub");
+
+  ConnectionId const ab0{a, 0, b, 0};
+  ConnectionId const ab1{a, 1, b, 2};
+  ConnectionId const ac0{a, 0, c, 1};
+
+  model.addConnection(ab0);
+  model.addConnection(ab1);
+  model.addConnection(ac0);
+
+  // Adding a connection twice stores it once.
+  model.addConnection(ab0);
+
+  CHECK(model.allConnectionIds(a) == std::unordered_set<ConnectionId>{ab0, ab1, ac0});
+  CHECK(model.allConnectionIds(b) == std::unordered_set<ConnectionId>{ab0, ab1});
+  CHECK(model.allConnectionIds(c) == std::unordered_set<ConnectionId>{ac0});
+
+  CHECK(model.connections(a, PortType::Out, 0) == std::unordered_set<ConnectionId>{ab0, ac0});
+  CHECK(model.connections(a, PortType::Out, 1) == std::unordered_set<ConnectionId>{ab1});
+  CHECK(model.connections(a, PortType::In, 0).empty());
+  CHECK(model.connections(b, PortType::In, 2) == std::unordered_set<ConnectionId>{ab1});
+
+  SECTION("connectionExists needs an exact match")
+  {
+    CHECK(model.connectionExists(ab0));
+    CHECK_FALSE(model.connectionExists(ConnectionId{a, 0, b, 1}));
+    CHECK_FALSE(model.connectionExists(ConnectionId{a, 0, c, 0}));
+  }
+
+  SECTION("deleteConnection removes both edges")
+  {
+    CHECK(model.deleteConnection(ab0));
+    CHECK_FALSE(model.deleteConnection(ab0));
+
+    CHECK_FALSE(model.connectionExists(ab0));
+    CHECK(model.connections(a, PortType::Out, 0) == std::unordered_set<ConnectionId>{ac0});
+    CHECK(model.connections(b, PortType::In, 0).empty());
+  }
+
+  SECTION("deleteNode removes the edges stored by the other nodes")
+  {
+    CHECK(model.deleteNode(b));
+
+    CHECK(model.allConnectionIds(a) == std::unordered_set<ConnectionId>{ac0});
+    CHECK(model.allConnectionIds(c) == std::unordered_set<ConnectionId>{ac0});
+  }
+}
+
+TEST_CASE("DataFlowGraphModel ignores connections to missing nodes", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  NodeId const a = model.addNode("Stub");
+
+  int created = 0;
+  QObject::connect(&model, &DataFlowGraphModel::connectionCreated,
+                   [&created](ConnectionId const) { ++created; });
+
+  model.addConnection(ConnectionId{a, 0, a + 100, 0});
+
+  CHECK(created == 0);
+  CHECK(model.allConnectionIds(a).empty());
+}
+
+TEST_CASE("DataFlowGraphModel propagates data along the edges", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+  NodeId const c = model.addNode("Stub");
+
+  model.addConnection(ConnectionId{a, 0, b, 0});
+  model.addConnection(ConnectionId{a, 0, c, 2});
+
+  auto source = model.delegateModel<StubNodeDelegateModel>(a);
+  auto data   = std::make_shared<StubNodeData>(IntType, 7);
+
+  source->setOutData(data);
+
+  CHECK(model.delegateModel<StubNodeDelegateModel>(b)->inData(0) == data);
+  CHECK(model.delegateModel<StubNodeDelegateModel>(c)->inData(2) == data);
+
+  model.deleteConnection(ConnectionId{a, 0, b, 0});
+
+  CHECK(model.delegateModel<StubNodeDelegateModel>(b)->inData(0) == nullptr);
+  CHECK(model.delegateModel<StubNodeDelegateModel>(c)->inData(2) == data);
+}
+
+TEST_CASE("DataFlowGraphModel delivers all input data through setInPortData", "[model]")
+{
+  struct ObservingModel : DataFlowGraphModel
+  {
+    using DataFlowGraphModel::DataFlowGraphModel;
+
+    void
+    setInPortData(NodeId const                       nodeId,
+                  QtNodes::PortIndex const           portIndex,
+                  std::shared_ptr<QtNodes::NodeData> data) override
+    {
+      ++delivered;
+
+      DataFlowGraphModel::setInPortData(nodeId, portIndex, std::move(data));
+    }
+
+    int delivered = 0;
+  };
+
+  ObservingModel model(stubRegistry());
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  model.addConnection(ConnectionId{a, 0, b, 0});
+
+  int const afterConnect = model.delivered;
+
+  auto data = std::make_shared<StubNodeData>(IntType, 2);
+
+  model.delegateModel<StubNodeDelegateModel>(a)->setOutData(data);
+
+  CHECK(model.delivered == afterConnect + 1);
+
+  auto const value = QVariant::fromValue<std::shared_ptr<QtNodes::NodeData>>(data);
+
+  CHECK(model.setPortData(b, PortType::In, 1, value));
+  CHECK_FALSE(model.setPortData(b, PortType::Out, 0, value));
+
+  CHECK(model.delivered == afterConnect + 2);
+  CHECK(model.delegateModel<StubNodeDelegateModel>(b)->inData(1) == data);
+}
+
+TEST_CASE("DataFlowGraphModel hands out node ids without reserving them", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  NodeId const id = model.newNodeId();
+
+  CHECK(model.newNodeId() == id);
+  CHECK(model.addNode("Stub") == id);
+  CHECK(model.newNodeId() == id + 1);
+
+  // Restored ids move the counter past them.
+  model.loadNode(stubNodeJson(id + 10));
+
+  CHECK(model.newNodeId() == id + 11);
+}
+
+TEST_CASE("DataFlowGraphModel loads a group of nodes at once", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  int nodesCreated = 0;
+  int connectionsCreated = 0;
+
+  QObject::connect(&model, &DataFlowGraphModel::nodeCreated,
+                   [&nodesCreated](NodeId const) { ++nodesCreated; });
+  QObject::connect(&model, &DataFlowGraphModel::connectionCreated,
+                   [&connectionsCreated](ConnectionId const) { ++connectionsCreated; });
+
+  NodeId const a = 5;
+  NodeId const b = 8;
+
+  // Fan-out of one output port to all the inputs of `b`.
+  std::vector<ConnectionId> const connectionIds{ConnectionId{a, 0, b, 0},
+                                                ConnectionId{a, 0, b, 1},
+                                                ConnectionId{a, 0, b, 2},
+                                                ConnectionId{a, 0, b + 1, 0}};
+
+  model.loadNodes({stubNodeJson(a), stubNodeJson(b)}, connectionIds);
+
+  CHECK(model.allNodeIds() == std::unordered_set<NodeId>{a, b});
+  CHECK(nodesCreated == 2);
+
+  // The connection to the missing node is dropped.
+  CHECK(connectionsCreated == 3);
+  CHECK(model.allConnectionIds(b).size() == 3);
+
+  // Adding the connections one by one would deliver 1 + 2 + 3 times.
+  CHECK(model.delegateModel<StubNodeDelegateModel>(b)->inDataCount() == 3);
+
+  auto data = std::make_shared<StubNodeData>(IntType, 3);
+  model.delegateModel<StubNodeDelegateModel>(a)->setOutData(data);
+
+  CHECK(model.delegateModel<StubNodeDelegateModel>(b)->inData(2) == data);
+}
+
+TEST_CASE("DataFlowGraphModel converts data between port types", "[model]")
+{
+  NodeDataType const DoubleType{"double", "Double"};
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Int", IntType);
+  registerStubModel(*registry, "Double", DoubleType);
+  registerStubModel(*registry, "IntStream", IntType, 1, 4);
+  registerStubModel(*registry, "DoubleStream", DoubleType, 1, 4);
+
+  int conversions = 0;
+
+  registry->registerTypeConverter(
+    IntType, DoubleType,
+    [&conversions, DoubleType](std::shared_ptr<QtNodes::NodeData> data)
+    -> std::shared_ptr<QtNodes::NodeData>
+    {
+      ++conversions;
+
+      auto const value = std::static_pointer_cast<StubNodeData>(data)->value();
+
+      return std::make_shared<StubNodeData>(DoubleType, value * 10);
+    });
+
+  DataFlowGraphModel model(registry);
+
+  NodeId const intNode    = model.addNode("Int");
+  NodeId const doubleNode = model.addNode("Double");
+
+  SECTION("converters make ports connectable in one direction")
+  {
+    CHECK(model.connectionPossible(ConnectionId{intNode, 0, doubleNode, 0}));
+    CHECK_FALSE(model.connectionPossible(ConnectionId{doubleNode, 0, intNode, 0}));
+  }
+
+  SECTION("chunks of streaming ports are never converted")
+  {
+    NodeId const intStream    = model.addNode("IntStream");
+    NodeId const intStream2   = model.addNode("IntStream");
+    NodeId const doubleStream = model.addNode("DoubleStream");
+
+    CHECK(model.connectionPossible(ConnectionId{intStream, 0, intStream2, 0}));
+    CHECK_FALSE(model.connectionPossible(ConnectionId{intStream, 0, doubleStream, 0}));
+  }
+
+  SECTION("each data object is converted once")
+  {
+    NodeId const doubleNode2 = model.addNode("Double");
+
+    model.addConnection(ConnectionId{intNode, 0, doubleNode, 0});
+
+    auto source = model.delegateModel<StubNodeDelegateModel>(intNode);
+    auto target = model.delegateModel<StubNodeDelegateModel>(doubleNode);
+
+    source->setOutData(std::make_shared<StubNodeData>(IntType, 4));
+
+    CHECK(conversions == 1);
+
+    auto converted = std::static_pointer_cast<StubNodeData>(target->inData(0));
+
+    REQUIRE(converted);
+    CHECK(converted->type().id == DoubleType.id);
+    CHECK(converted->value() == 40);
+
+    // Sends the same object over all the connections of the port again.
+    model.addConnection(ConnectionId{intNode, 0, doubleNode2, 0});
+
+    CHECK(conversions == 2);
+    CHECK(target->inData(0) == converted);
+
+    // A new object is converted even if it ends up at the same address.
+    source->setOutData(std::make_shared<StubNodeData>(IntType, 5));
+
+    CHECK(conversions == 4);
+    CHECK(std::static_pointer_cast<StubNodeData>(target->inData(0))->value() == 50);
+
+    source->setOutData(nullptr);
+
+    CHECK(conversions == 4);
+    CHECK(target->inData(0) == nullptr);
+  }
+
+  SECTION("data is passed through if no converter is registered")
+  {
+    // Loaded connections are not checked by connectionPossible().
+    model.addConnection(ConnectionId{doubleNode, 0, intNode, 0});
+
+    auto data = std::make_shared<StubNodeData>(DoubleType, 6);
+
+    model.delegateModel<StubNodeDelegateModel>(doubleNode)->setOutData(data);
+
+    CHECK(conversions == 0);
+    CHECK(model.delegateModel<StubNodeDelegateModel>(intNode)->inData(0) == data);
+  }
+}
+
+TEST_CASE("DataFlowGraphModel resolves the port types once per connection", "[model]")
+{
+  struct CountingModel : DataFlowGraphModel
+  {
+    using DataFlowGraphModel::DataFlowGraphModel;
+
+    QVariant
+    portData(NodeId             nodeId,
+             PortType           portType,
+             QtNodes::PortIndex portIndex,
+             QtNodes::PortRole  role) const override
+    {
+      if (role == QtNodes::PortRole::DataType)
+        ++typeQueries;
+
+      return DataFlowGraphModel::portData(nodeId, portType, portIndex, role);
+    }
+
+    mutable int typeQueries = 0;
+  };
+
+  NodeDataType const DoubleType{"double", "Double"};
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Int", IntType);
+  registerStubModel(*registry, "Double", DoubleType);
+
+  registry->registerTypeConverter(
+    IntType, DoubleType,
+    [DoubleType](std::shared_ptr<QtNodes::NodeData> data)
+    -> std::shared_ptr<QtNodes::NodeData>
+    {
+      auto const value = std::static_pointer_cast<StubNodeData>(data)->value();
+
+      return std::make_shared<StubNodeData>(DoubleType, value * 10);
+    });
+
+  CountingModel model(registry);
+
+  NodeId const intNode    = model.addNode("Int");
+  NodeId const doubleNode = model.addNode("Double");
+
+  model.addConnection(ConnectionId{intNode, 0, doubleNode, 0});
+
+  int const afterConnect = model.typeQueries;
+
+  auto source = model.delegateModel<StubNodeDelegateModel>(intNode);
+  auto target = model.delegateModel<StubNodeDelegateModel>(doubleNode);
+
+  SECTION("propagation does not query the types")
+  {
+    for (int i = 0; i < 3; ++i)
+      source->setOutData(std::make_shared<StubNodeData>(IntType, i));
+
+    CHECK(model.typeQueries == afterConnect);
+    CHECK(std::static_pointer_cast<StubNodeData>(target->inData(0))->value() == 20);
+  }
+
+  SECTION("nodeUpdated makes the model look the types up again")
+  {
+    source->setDataType(DoubleType);
+
+    Q_EMIT model.nodeUpdated(intNode);
+
+    auto data = std::make_shared<StubNodeData>(DoubleType, 3);
+
+    source->setOutData(data);
+
+    CHECK(model.typeQueries == afterConnect + 2);
+    CHECK(target->inData(0) == data);
+  }
+
+  SECTION("a reconnection resolves the types again")
+  {
+    model.deleteConnection(ConnectionId{intNode, 0, doubleNode, 0});
+
+    source->setDataType(DoubleType);
+
+    Q_EMIT model.nodeUpdated(intNode);
+
+    model.addConnection(ConnectionId{intNode, 0, doubleNode, 0});
+
+    auto data = std::make_shared<StubNodeData>(DoubleType, 3);
+
+    source->setOutData(data);
+
+    CHECK(target->inData(0) == data);
+  }
+}
+
+TEST_CASE("DataFlowGraphModel caches the port types of the delegates", "[model]")
+{
+  DataFlowGraphModel model(stubRegistry());
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  auto delegateA = model.delegateModel<StubNodeDelegateModel>(a);
+  auto delegateB = model.delegateModel<StubNodeDelegateModel>(b);
+
+  ConnectionId const ab{a, 0, b, 0};
+
+  REQUIRE(model.connectionPossible(ab));
+
+  int const countA = delegateA->dataTypeCount();
+  int const countB = delegateB->dataTypeCount();
+
+  SECTION("repeated checks reuse the interned types")
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      CHECK(model.connectionPossible(ab));
+
+      auto const type =
+        model.portData(a, PortType::Out, 0, QtNodes::PortRole::DataType)
+        .value<NodeDataType>();
+
+      CHECK(type.handle() == IntType.handle());
+    }
+
+    CHECK(delegateA->dataTypeCount() == countA);
+    CHECK(delegateB->dataTypeCount() == countB);
+  }
+
+  SECTION("nodeUpdated drops the cached types")
+  {
+    delegateA->setDataType(NodeDataType{"double", "Double"});
+
+    Q_EMIT model.nodeUpdated(a);
+
+    CHECK_FALSE(model.connectionPossible(ab));
+    CHECK(delegateA->dataTypeCount() > countA);
+    CHECK(delegateB->dataTypeCount() == countB);
+  }
+}
+
+TEST_CASE("NodeDataType copies keep the interned handle", "[model]")
+{
+  NodeDataType type{"copied", "Copied"};
+
+  QtNodes::NodeDataTypeHandle const handle = type.handle();
+
+  NodeDataType const copy = type;
+  CHECK(copy.handle() == handle);
+
+  NodeDataType const moved = std::move(type);
+  CHECK(moved.handle() == handle);
+
+  NodeDataType assigned;
+  assigned.id = "copied";
+  CHECK(assigned.handle() == handle);
+  CHECK(assigned.handle() == handle);
+}
+
+TEST_CASE("NodeDataType ids get one handle across threads", "[model]")
+{
+  int const nIds     = 100;
+  int const nThreads = 8;
+
+  // Ids no other test interns, so the threads race to register them.
+  auto idAt = [](int const i) { return QString("threaded-%1").arg(i); };
+
+  std::vector<std::vector<QtNodes::NodeDataTypeHandle>> handles(nThreads);
+  std::vector<std::unique_ptr<QThread>> threads;
+
+  for (int t = 0; t < nThreads; ++t)
+  {
+    threads.emplace_back(QThread::create(
+      [&handles, &idAt, t]()
+      {
+        auto & threadHandles = handles[t];
+        threadHandles.resize(nIds);
+
+        // Half of the threads walk the ids backwards.
+        for (int n = 0; n < nIds; ++n)
+        {
+          int const i = (t % 2 == 0) ? n : nIds - 1 - n;
+
+          threadHandles[i] = NodeDataType{idAt(i), "Threaded"}.handle();
+        }
+      }));
+
+    threads.back()->start();
+  }
+
+  for (auto & thread : threads)
+    REQUIRE(thread->wait());
+
+  std::unordered_set<QtNodes::NodeDataTypeHandle> distinct;
+
+  for (int i = 0; i < nIds; ++i)
+  {
+    QtNodes::NodeDataTypeHandle const handle = handles[0][i];
+
+    for (auto const & threadHandles : handles)
+      CHECK(threadHandles[i] == handle);
+
+    CHECK(NodeDataType{idAt(i), "Threaded"}.handle() == handle);
+    CHECK(QtNodes::NodeDataTypeRegistry::typeId(handle) == idAt(i));
+
+    distinct.insert(handle);
+  }
+
+  CHECK(distinct.size() == static_cast<std::size_t>(nIds));
+}
+
+TEST_CASE("NodeData::sameType compares the type ids only", "[model]")
+{
+  StubNodeData const a(NodeDataType{"int", "Integer"}, 1);
+  StubNodeData const b(NodeDataType{"int", "Another name"}, 2);
+  StubNodeData const c(NodeDataType{"double", "Integer"}, 1);
+
+  CHECK(a.sameType(a));
+  CHECK(a.sameType(b));
+  CHECK(b.sameType(a));
+  CHECK_FALSE(a.sameType(c));
+}
+
+TEST_CASE("DataFlowGraphModel carries chunks between streaming ports", "[model]")
+{
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stream", IntType, 1, 2);
+
+  DataFlowGraphModel model(registry);
+
+  NodeId const a = model.addNode("Stream");
+  NodeId const b = model.addNode("Stream");
+
+  auto source = model.delegateModel<StubNodeDelegateModel>(a);
+  auto target = model.delegateModel<StubNodeDelegateModel>(b);
+
+  int spaceAvailable = 0;
+  QObject::connect(source, &QtNodes::NodeDelegateModel::streamSpaceAvailable,
+                   [&spaceAvailable](QtNodes::PortIndex const) { ++spaceAvailable; });
+
+  auto chunk = [](int const value) { return std::make_shared<StubNodeData>(IntType, value); };
+
+  auto const first  = chunk(1);
+  auto const second = chunk(2);
+
+  // Nobody would receive the chunk.
+  CHECK_FALSE(source->canPushChunk(0));
+  CHECK_FALSE(source->pushChunk(0, first));
+
+  ConnectionId const ab{a, 0, b, 0};
+
+  model.addConnection(ab);
+
+  CHECK(spaceAvailable == 1);
+
+  std::shared_ptr<QtNodes::NodeDataChannel> const channel = target->inChannel(0);
+
+  REQUIRE(channel);
+  CHECK(channel->capacity() == 2);
+
+  CHECK(source->pushChunk(0, first));
+  CHECK(source->pushChunk(0, second));
+  CHECK_FALSE(source->pushChunk(0, chunk(3)));
+  CHECK(channel->size() == 2);
+
+  CHECK(channel->tryPop() == first);
+  CHECK(spaceAvailable == 2);
+
+  // Snapshots do not travel over streaming connections.
+  source->setOutData(chunk(4));
+  CHECK(target->inData(0) == nullptr);
+
+  source->closeStream(0);
+
+  // The consumer has not read the end of the stream yet.
+  CHECK_FALSE(source->pushChunk(0, chunk(5)));
+  CHECK(channel->tryPop() == second);
+  CHECK(channel->atEnd());
+  CHECK(spaceAvailable == 3);
+
+  // The next chunk starts a second stream on the same connection.
+  auto const next = chunk(6);
+
+  CHECK(source->pushChunk(0, next));
+  CHECK_FALSE(channel->isClosed());
+  CHECK(channel->tryPop() == next);
+
+  source->closeStream(0);
+
+  CHECK(channel->atEnd());
+
+  model.deleteConnection(ab);
+
+  CHECK(target->inChannel(0) == nullptr);
+  CHECK_FALSE(source->canPushChunk(0));
+}
+
+TEST_CASE("DataFlowGraphModel re-saves only the nodes with new data", "[model]")
+{
+  struct SaveCountingModel : StubNodeDelegateModel
+  {
+    explicit
+    SaveCountingModel(int & saves)
+      : StubNodeDelegateModel("Stub", IntType)
+      , saves(saves)
+    {}
+
+    QJsonObject
+    save() const override
+    {
+      ++saves;
+
+      return StubNodeDelegateModel::save();
+    }
+
+    int & saves;
+  };
+
+  int saves = 0;
+
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registry->registerModel<SaveCountingModel>(
+    [&saves]() { return std::make_unique<SaveCountingModel>(saves); });
+
+  DataFlowGraphModel model(registry);
+
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+
+  model.addConnection(ConnectionId{a, 0, b, 0});
+
+  model.snapshot();
+
+  CHECK(saves == 2);
+
+  model.snapshot();
+
+  CHECK(saves == 2);
+
+  // Both the sender and the receiver are saved once per snapshot.
+  auto source = model.delegateModel<StubNodeDelegateModel>(a);
+
+  source->setOutData(std::make_shared<StubNodeData>(IntType, 1));
+  source->setOutData(std::make_shared<StubNodeData>(IntType, 2));
+
+  model.snapshot();
+
+  CHECK(saves == 4);
+
+  model.deleteNode(b);
+  model.snapshot();
+
+  CHECK(saves == 4);
+
+  model.invalidateSnapshot(a);
+  model.snapshot();
+
+  CHECK(saves == 5);
+}
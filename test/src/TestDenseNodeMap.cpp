@@ -0,0 +1,183 @@
+#include <QtNodes/internal/DenseNodeMap.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <map>
+#include <random>
+#include <set>
+
+using QtNodes::DenseNodeMap;
+using QtNodes::NodeId;
+
+namespace
+{
+/// Checks that `map` holds exactly the entries of `expected`.
+void
+checkSame(DenseNodeMap<int> const & map, std::map<NodeId, int> const & expected)
+{
+  REQUIRE(map.size() == expected.size());
+
+  std::set<NodeId> visited;
+
+  for (auto const & entry : map)
+  {
+    CHECK(visited.insert(entry.id).second);
+
+    auto it = expected.find(entry.id);
+    REQUIRE(it != expected.end());
+    CHECK(entry.value == it->second);
+  }
+
+  for (auto const & pair : expected)
+  {
+    REQUIRE(map.find(pair.first) != nullptr);
+    CHECK(*map.find(pair.first) == pair.second);
+  }
+}
+}
+
+TEST_CASE("DenseNodeMap insert, find and erase", "[densenodemap]")
+{
+  DenseNodeMap<int> map;
+
+  for (NodeId id = 0; id < 100; ++id)
+    map.insert(id, static_cast<int>(id) * 2);
+
+  CHECK(map.size() == 100);
+  CHECK(map.find(100) == nullptr);
+  CHECK_FALSE(map.contains(100));
+
+  map.insert(5, -1);
+
+  CHECK(map.size() == 100);
+  CHECK(*map.find(5) == -1);
+
+  CHECK(map.erase(5));
+  CHECK_FALSE(map.erase(5));
+  CHECK_FALSE(map.contains(5));
+  CHECK(map.size() == 99);
+
+  map.clear();
+
+  CHECK(map.empty());
+  CHECK(map.find(0) == nullptr);
+}
+
+TEST_CASE("DenseNodeMap erase moves the last entry into the gap", "[densenodemap]")
+{
+  DenseNodeMap<int> map;
+  std::map<NodeId, int> expected;
+
+  for (NodeId id = 0; id < 10; ++id)
+  {
+    map.insert(id, static_cast<int>(id));
+    expected[id] = static_cast<int>(id);
+  }
+
+  // The first entry is replaced by the last one.
+  CHECK(map.erase(0));
+  expected.erase(0);
+
+  CHECK(map.begin()->id == 9);
+  checkSame(map, expected);
+
+  // Erasing the last entry itself moves nothing.
+  NodeId const last = (map.end() - 1)->id;
+  CHECK(map.erase(last));
+  expected.erase(last);
+
+  checkSame(map, expected);
+
+  for (NodeId id = 1; id < 10; ++id)
+  {
+    map.erase(id);
+    expected.erase(id);
+
+    checkSame(map, expected);
+  }
+
+  CHECK(map.empty());
+}
+
+TEST_CASE("DenseNodeMap keeps far ids out of the slot table", "[densenodemap]")
+{
+  DenseNodeMap<int> map;
+  std::map<NodeId, int> expected;
+
+  // Restored graphs may come with large gaps between the ids.
+  NodeId const farIds[] = {5000, 1000000, 0xFFFFFFF0u};
+
+  for (NodeId const id : farIds)
+  {
+    map.insert(id, static_cast<int>(id % 1000));
+    expected[id] = static_cast<int>(id % 1000);
+  }
+
+  checkSame(map, expected);
+
+  SECTION("far ids move into the table once it reaches them")
+  {
+    // The table doubles while the ids grow and ends up covering 5000.
+    for (NodeId id = 0; id < 4200; ++id)
+    {
+      map.insert(id, static_cast<int>(id));
+      expected[id] = static_cast<int>(id);
+    }
+
+    checkSame(map, expected);
+
+    CHECK(map.erase(5000));
+    expected.erase(5000);
+
+    checkSame(map, expected);
+  }
+
+  SECTION("swap-erase updates the index of a far entry")
+  {
+    map.insert(1, 1);
+    expected[1] = 1;
+
+    // The near entry stored last takes the place of a far one.
+    CHECK(map.erase(5000));
+    expected.erase(5000);
+
+    checkSame(map, expected);
+
+    // A far entry takes the place of another far one.
+    CHECK(map.erase(1000000));
+    expected.erase(1000000);
+
+    checkSame(map, expected);
+  }
+}
+
+TEST_CASE("DenseNodeMap matches std::map under random operations", "[densenodemap]")
+{
+  DenseNodeMap<int> map;
+  std::map<NodeId, int> expected;
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> operation(0, 9);
+  std::uniform_int_distribution<NodeId> nearId(0, 3000);
+  std::uniform_int_distribution<NodeId> farId(0, 0xFFFFFFFEu);
+
+  for (int i = 0; i < 20000; ++i)
+  {
+    int const op = operation(random);
+    NodeId const id = (op == 0) ? farId(random) : nearId(random);
+
+    if (op < 6)
+    {
+      map.insert(id, i);
+      expected[id] = i;
+    }
+    else
+    {
+      bool const existed = expected.erase(id) != 0;
+      CHECK(map.erase(id) == existed);
+    }
+  }
+
+  checkSame(map, expected);
+}
@@ -0,0 +1,302 @@
+#include "StubNodeDelegateModel.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/GraphJournal>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <catch2/catch.hpp>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTemporaryDir>
+
+#include <memory>
+#include <unordered_set>
+
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::GraphJournal;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::NodeRole;
+
+namespace
+{
+std::shared_ptr<NodeDelegateModelRegistry>
+stubRegistry()
+{
+  auto registry = std::make_shared<NodeDelegateModelRegistry>();
+
+  registerStubModel(*registry, "Stub", NodeDataType{"int", "Integer"}, 2);
+
+  return registry;
+}
+
+/// Three nodes in a chain.
+void
+buildGraph(DataFlowGraphModel & model)
+{
+  NodeId const a = model.addNode("Stub");
+  NodeId const b = model.addNode("Stub");
+  NodeId const c = model.addNode("Stub");
+
+  model.setNodeData(a, NodeRole::Position, QPointF(0, 0));
+  model.setNodeData(b, NodeRole::Position, QPointF(200, 0));
+  model.setNodeData(c, NodeRole::Position, QPointF(400, 50));
+
+  model.addConnection(ConnectionId{a, 0, b, 0});
+  model.addConnection(ConnectionId{b, 1, c, 0});
+}
+
+std::unordered_set<ConnectionId>
+allConnections(DataFlowGraphModel const & model)
+{
+  std::unordered_set<ConnectionId> result;
+
+  for (NodeId const nodeId : model.allNodeIds())
+  {
+    auto const connections = model.allConnectionIds(nodeId);
+    result.insert(connections.begin(), connections.end());
+  }
+
+  return result;
+}
+
+void
+checkSameGraph(DataFlowGraphModel const & expected, DataFlowGraphModel const & actual)
+{
+  REQUIRE(actual.allNodeIds() == expected.allNodeIds());
+
+  for (NodeId const nodeId : expected.allNodeIds())
+  {
+    CHECK(actual.nodeData(nodeId, NodeRole::Position).toPointF() ==
+          expected.nodeData(nodeId, NodeRole::Position).toPointF());
+  }
+
+  CHECK(allConnections(actual) == allConnections(expected));
+}
+
+QByteArray
+readFile(QString const & path)
+{
+  QFile file(path);
+
+  return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void
+writeFile(QString const & path, QByteArray const & content, QIODevice::OpenMode mode)
+{
+  QFile file(path);
+
+  REQUIRE(file.open(mode));
+  REQUIRE(file.write(content) == content.size());
+}
+}
+
+TEST_CASE("GraphJournal restores the graph from the log", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+
+  DataFlowGraphModel original(stubRegistry());
+  {
+    GraphJournal journal(original);
+    REQUIRE(journal.open(path));
+
+    buildGraph(original);
+    REQUIRE(journal.flush());
+
+    // A second frame with a move, a removal and a new node.
+    NodeId const first = *original.allNodeIds().begin();
+    original.setNodeData(first, NodeRole::Position, QPointF(-50, 75));
+    original.deleteConnection(*allConnections(original).begin());
+    original.addNode("Stub");
+
+    REQUIRE(journal.flush());
+
+    // Nothing changed, nothing is appended.
+    qint64 const size = journal.journalSize();
+    REQUIRE(journal.flush());
+    CHECK(journal.journalSize() == size);
+  }
+
+  // Only the log has been written so far.
+  CHECK_FALSE(QFile::exists(path));
+
+  DataFlowGraphModel restored(stubRegistry());
+  GraphJournal journal(restored);
+
+  REQUIRE(journal.open(path));
+
+  checkSameGraph(original, restored);
+}
+
+TEST_CASE("GraphJournal drops a frame torn by a crash", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+
+  DataFlowGraphModel original(stubRegistry());
+
+  qint64 validSize = 0;
+  QString journalPath;
+  {
+    GraphJournal journal(original);
+    REQUIRE(journal.open(path));
+
+    buildGraph(original);
+    REQUIRE(journal.flush());
+
+    validSize   = journal.journalSize();
+    journalPath = journal.journalPath();
+  }
+
+  QByteArray tornFrame;
+  {
+    QDataStream out(&tornFrame, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+
+    SECTION("payload cut short")
+    {
+      out << quint32(100) << quint16(0);
+      out.writeRawData("\x01\x00\x00", 3);
+    }
+
+    SECTION("payload not matching its checksum")
+    {
+      out << quint32(5) << quint16(0xBEEF);
+      out.writeRawData("\x01\x00\x00\x00\x07", 5);
+    }
+  }
+
+  writeFile(journalPath, tornFrame, QIODevice::Append);
+
+  DataFlowGraphModel restored(stubRegistry());
+  GraphJournal journal(restored);
+
+  REQUIRE(journal.open(path));
+
+  checkSameGraph(original, restored);
+
+  // New frames go right after the last valid one.
+  CHECK(journal.journalSize() == validSize);
+}
+
+TEST_CASE("GraphJournal replays a log left by an interrupted compaction", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+
+  DataFlowGraphModel original(stubRegistry());
+
+  QString journalPath;
+  QByteArray mergedLog;
+  {
+    GraphJournal journal(original);
+    REQUIRE(journal.open(path));
+
+    journalPath = journal.journalPath();
+
+    buildGraph(original);
+    REQUIRE(journal.flush());
+
+    mergedLog = readFile(journalPath);
+
+    REQUIRE(journal.compact());
+    CHECK(QFile::exists(path));
+    CHECK(journal.journalSize() < mergedLog.size());
+  }
+
+  // As if the crash came after writing the base file but before emptying
+  // the log.
+  writeFile(journalPath, mergedLog, QIODevice::WriteOnly | QIODevice::Truncate);
+
+  DataFlowGraphModel restored(stubRegistry());
+  GraphJournal journal(restored);
+
+  REQUIRE(journal.open(path));
+
+  checkSameGraph(original, restored);
+}
+
+TEST_CASE("GraphJournal refuses a damaged base file", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+
+  QByteArray const damaged("{\"nodes\": [{\"id\": 1,");
+
+  writeFile(path, damaged, QIODevice::WriteOnly);
+
+  DataFlowGraphModel model(stubRegistry());
+  GraphJournal journal(model);
+
+  CHECK_FALSE(journal.open(path));
+  CHECK_FALSE(journal.isOpen());
+  CHECK(model.allNodeIds().empty());
+
+  // Neither the document nor a log has been touched.
+  CHECK(readFile(path) == damaged);
+  CHECK_FALSE(QFile::exists(path + ".journal"));
+  CHECK(journal.documentPath().isEmpty());
+}
+
+TEST_CASE("GraphJournal refuses a log which is not a journal", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+  QString const journalPath = path + ".journal";
+
+  QByteArray const foreign("not a graph journal");
+
+  writeFile(journalPath, foreign, QIODevice::WriteOnly);
+
+  DataFlowGraphModel model(stubRegistry());
+  GraphJournal journal(model);
+
+  CHECK_FALSE(journal.open(path));
+  CHECK_FALSE(journal.isOpen());
+  CHECK(journal.documentPath().isEmpty());
+  CHECK(model.allNodeIds().empty());
+
+  CHECK(readFile(journalPath) == foreign);
+}
+
+TEST_CASE("GraphJournal leaves the model alone when the log cannot be opened", "[journal]")
+{
+  QTemporaryDir dir;
+  REQUIRE(dir.isValid());
+
+  QString const path = dir.filePath("graph.flow");
+
+  {
+    DataFlowGraphModel original(stubRegistry());
+    buildGraph(original);
+
+    writeFile(path, QJsonDocument(original.save()).toJson(), QIODevice::WriteOnly);
+  }
+
+  DataFlowGraphModel model(stubRegistry());
+  GraphJournal journal(model);
+
+  // A directory in place of the log cannot be opened for writing.
+  REQUIRE(QDir(dir.path()).mkdir("graph.flow.journal"));
+
+  CHECK_FALSE(journal.open(path));
+  CHECK_FALSE(journal.isOpen());
+  CHECK(model.allNodeIds().empty());
+}
@@ -0,0 +1,90 @@
+#include "NodeSpatialIndex.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using QtNodes::NodeId;
+using QtNodes::NodeSpatialIndex;
+
+namespace
+{
+std::vector<NodeId>
+sorted(std::vector<NodeId> ids)
+{
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+/// Three nodes around the origin and enough distant ones to make the
+/// queries below walk the grid cells rather than all the nodes.
+void
+fillIndex(NodeSpatialIndex & index)
+{
+  index.insert(1, QRectF(10, 10, 50, 50));
+  index.insert(2, QRectF(150, 10, 50, 50));
+
+  // Spans four cells.
+  index.insert(3, QRectF(80, 80, 100, 100));
+
+  for (NodeId nodeId = 4; nodeId <= 10; ++nodeId)
+  {
+    index.insert(nodeId, QRectF(1000 + nodeId * 200, 1000, 50, 50));
+  }
+}
+}
+
+TEST_CASE("NodeSpatialIndex finds the nodes intersecting a rect", "[index]")
+{
+  NodeSpatialIndex index(100.0);
+
+  fillIndex(index);
+
+  REQUIRE(index.size() == 10);
+
+  SECTION("a single cell")
+  {
+    CHECK(sorted(index.query(QRectF(0, 0, 60, 60))) == std::vector<NodeId>{1});
+  }
+
+  SECTION("the cell of a node spanning several ones")
+  {
+    CHECK(sorted(index.query(QRectF(170, 170, 5, 5))) == std::vector<NodeId>{3});
+  }
+
+  SECTION("nodes in several cells are reported once")
+  {
+    CHECK(sorted(index.query(QRectF(0, 0, 250, 250))) == std::vector<NodeId>{1, 2, 3});
+  }
+
+  SECTION("a rect covering more cells than there are nodes")
+  {
+    CHECK(index.query(QRectF(-1e6, -1e6, 2e6, 2e6)).size() == 10);
+  }
+
+  SECTION("empty space")
+  {
+    CHECK(index.query(QRectF(500, 500, 10, 10)).empty());
+  }
+}
+
+TEST_CASE("NodeSpatialIndex follows moved and removed nodes", "[index]")
+{
+  NodeSpatialIndex index(100.0);
+
+  fillIndex(index);
+
+  index.insert(1, QRectF(500, 500, 50, 50));
+  index.remove(2);
+
+  CHECK(index.size() == 9);
+
+  CHECK(sorted(index.query(QRectF(0, 0, 250, 250))) == std::vector<NodeId>{3});
+  CHECK(sorted(index.query(QRectF(520, 520, 10, 10))) == std::vector<NodeId>{1});
+
+  index.clear();
+
+  CHECK(index.size() == 0);
+  CHECK(index.query(QRectF(0, 0, 250, 250)).empty());
+}
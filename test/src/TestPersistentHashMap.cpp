@@ -0,0 +1,134 @@
+#include <QtNodes/PersistentHashMap>
+
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <map>
+#include <set>
+
+using QtNodes::PersistentHashMap;
+
+namespace
+{
+/// Sends every key to the same few buckets to exercise the collision nodes.
+struct PoorHash
+{
+  std::size_t
+  operator()(int const key) const
+  {
+    return static_cast<std::size_t>(key % 3);
+  }
+};
+}
+
+TEST_CASE("PersistentHashMap insert, find and erase", "[persistent]")
+{
+  PersistentHashMap<int, int> map;
+
+  for (int i = 0; i < 5000; ++i)
+    map.insert(i, i * 2);
+
+  CHECK(map.size() == 5000);
+
+  for (int i = 0; i < 5000; ++i)
+  {
+    REQUIRE(map.find(i) != nullptr);
+    CHECK(*map.find(i) == i * 2);
+  }
+
+  CHECK(map.find(5000) == nullptr);
+
+  for (int i = 0; i < 5000; i += 2)
+    CHECK(map.erase(i));
+
+  CHECK_FALSE(map.erase(0));
+  CHECK(map.size() == 2500);
+
+  for (int i = 0; i < 5000; ++i)
+    CHECK(map.contains(i) == (i % 2 == 1));
+}
+
+TEST_CASE("PersistentHashMap copies are independent versions", "[persistent]")
+{
+  PersistentHashMap<int, int> older;
+
+  for (int i = 0; i < 1000; ++i)
+    older.insert(i, i);
+
+  PersistentHashMap<int, int> newer = older;
+
+  CHECK(newer.isSharedWith(older));
+
+  newer.insert(10, -10);
+  newer.erase(20);
+  newer.insert(1000, 1000);
+
+  CHECK_FALSE(newer.isSharedWith(older));
+
+  CHECK(*older.find(10) == 10);
+  CHECK(older.contains(20));
+  CHECK_FALSE(older.contains(1000));
+
+  CHECK(*newer.find(10) == -10);
+  CHECK_FALSE(newer.contains(20));
+  CHECK(newer.contains(1000));
+
+  SECTION("assigning an equal value keeps the version")
+  {
+    PersistentHashMap<int, int> same = older;
+    same.insert(5, 5);
+
+    CHECK(same.isSharedWith(older));
+  }
+
+  SECTION("diff reports only the changes")
+  {
+    std::set<int> added;
+    std::set<int> removed;
+    std::map<int, std::pair<int, int>> changed;
+
+    newer.diff(older,
+               [&](int key, int) { added.insert(key); },
+               [&](int key, int) { removed.insert(key); },
+               [&](int key, int oldValue, int newValue)
+               { changed[key] = std::make_pair(oldValue, newValue); });
+
+    CHECK(added == std::set<int>{1000});
+    CHECK(removed == std::set<int>{20});
+    REQUIRE(changed.size() == 1);
+    CHECK(changed[10] == std::make_pair(10, -10));
+  }
+}
+
+TEST_CASE("PersistentHashMap with colliding hashes", "[persistent]")
+{
+  PersistentHashMap<int, int, PoorHash> map;
+
+  for (int i = 0; i < 100; ++i)
+    map.insert(i, i);
+
+  PersistentHashMap<int, int, PoorHash> older = map;
+
+  for (int i = 0; i < 100; i += 3)
+    map.erase(i);
+
+  map.insert(7, 70);
+
+  CHECK(map.size() == 66);
+  CHECK(*map.find(7) == 70);
+  CHECK_FALSE(map.contains(3));
+  CHECK(older.size() == 100);
+
+  int added = 0;
+  int removed = 0;
+  int changed = 0;
+
+  map.diff(older,
+           [&](int, int) { ++added; },
+           [&](int, int) { ++removed; },
+           [&](int, int, int) { ++changed; });
+
+  CHECK(added == 0);
+  CHECK(removed == 34);
+  CHECK(changed == 1);
+}
@@ -0,0 +1,106 @@
+#include <QtNodes/internal/SmallVector.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using QtNodes::SmallVector;
+
+namespace
+{
+template<typename T, std::size_t N>
+std::vector<T>
+toStd(SmallVector<T, N> const & values)
+{
+  return std::vector<T>(values.begin(), values.end());
+}
+}
+
+TEST_CASE("SmallVector keeps up to N values inline", "[smallvector]")
+{
+  SmallVector<int, 2> values;
+
+  CHECK(values.empty());
+
+  values.push_back(1);
+  int const * inlineData = values.data();
+
+  values.push_back(2);
+
+  CHECK(values.size() == 2);
+  CHECK(values.data() == inlineData);
+  CHECK(toStd(values) == std::vector<int>{1, 2});
+}
+
+TEST_CASE("SmallVector moves to the heap and back", "[smallvector]")
+{
+  SmallVector<int, 2> values;
+  values.push_back(1);
+  values.push_back(2);
+
+  int const * inlineData = values.data();
+
+  values.push_back(3);
+
+  CHECK(values.data() != inlineData);
+  CHECK(toStd(values) == std::vector<int>{1, 2, 3});
+
+  values.erase(values.begin() + 1);
+
+  CHECK(values.data() == inlineData);
+  CHECK(toStd(values) == std::vector<int>{1, 3});
+}
+
+TEST_CASE("SmallVector insert and erase keep the order", "[smallvector]")
+{
+  SmallVector<int, 2> values;
+  std::vector<int>    expected;
+
+  // Sorted insertion as done for the node edges, crossing the inline limit.
+  for (int const value : {5, 1, 4, 2, 3, 0})
+  {
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    CHECK(*values.insert(it, value) == value);
+
+    expected.insert(std::lower_bound(expected.begin(), expected.end(), value), value);
+    CHECK(toStd(values) == expected);
+  }
+
+  while (!values.empty())
+  {
+    std::size_t const middle = values.size() / 2;
+
+    auto next = values.erase(values.begin() + middle);
+    expected.erase(expected.begin() + middle);
+
+    CHECK(toStd(values) == expected);
+    CHECK(next == values.begin() + middle);
+  }
+}
+
+TEST_CASE("SmallVector copies are independent", "[smallvector]")
+{
+  SmallVector<int, 2> small;
+  small.push_back(1);
+
+  SmallVector<int, 2> large;
+  for (int i = 0; i < 4; ++i)
+    large.push_back(i);
+
+  SmallVector<int, 2> smallCopy = small;
+  SmallVector<int, 2> largeCopy = large;
+
+  smallCopy[0] = 10;
+  largeCopy[3] = 30;
+
+  CHECK(toStd(small) == std::vector<int>{1});
+  CHECK(toStd(large) == std::vector<int>{0, 1, 2, 3});
+  CHECK(toStd(smallCopy) == std::vector<int>{10});
+  CHECK(toStd(largeCopy) == std::vector<int>{0, 1, 2, 30});
+
+  large.clear();
+
+  CHECK(large.empty());
+  CHECK(largeCopy.size() == 4);
+}
@@ -0,0 +1,135 @@
+#include "UndoSpillFile.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+using QtNodes::UndoSpillFile;
+
+namespace
+{
+QByteArray
+recordData(int const size, char const fill)
+{
+  return QByteArray(size, fill);
+}
+}
+
+TEST_CASE("UndoSpillFile reads the records back", "[undo]")
+{
+  UndoSpillFile file;
+
+  auto const a = file.write(recordData(100, 'a'));
+  auto const b = file.write(recordData(50, 'b'));
+
+  REQUIRE(a.isValid());
+  REQUIRE(b.isValid());
+
+  CHECK(file.read(a) == recordData(100, 'a'));
+  CHECK(file.read(b) == recordData(50, 'b'));
+
+  CHECK(file.recordCount() == 2);
+  CHECK(file.recordBytes() == 150);
+  CHECK(file.fileSize() == 150);
+
+  CHECK(file.read(UndoSpillFile::Record()).isEmpty());
+}
+
+TEST_CASE("UndoSpillFile reuses released records", "[undo]")
+{
+  UndoSpillFile file;
+
+  auto const a = file.write(recordData(100, 'a'));
+  auto const b = file.write(recordData(100, 'b'));
+  auto const c = file.write(recordData(100, 'c'));
+
+  file.release(b);
+
+  CHECK(file.fileSize() == 300);
+  CHECK(file.holeBytes() == 100);
+
+  // Fits into the hole left by `b`.
+  auto const d = file.write(recordData(60, 'd'));
+
+  CHECK(d.offset == b.offset);
+  CHECK(file.fileSize() == 300);
+  CHECK(file.holeBytes() == 40);
+
+  // Too large for the rest of the hole.
+  auto const e = file.write(recordData(50, 'e'));
+
+  CHECK(e.offset == 300);
+
+  CHECK(file.read(a) == recordData(100, 'a'));
+  CHECK(file.read(c) == recordData(100, 'c'));
+  CHECK(file.read(d) == recordData(60, 'd'));
+  CHECK(file.read(e) == recordData(50, 'e'));
+
+  SECTION("adjacent holes merge")
+  {
+    file.release(a);
+    file.release(d);
+
+    CHECK(file.holeBytes() == 200);
+
+    auto const f = file.write(recordData(200, 'f'));
+
+    CHECK(f.offset == 0);
+    CHECK(file.holeBytes() == 0);
+    CHECK(file.read(c) == recordData(100, 'c'));
+  }
+
+  SECTION("a hole at the end of the file is cut off")
+  {
+    file.release(e);
+
+    CHECK(file.fileSize() == 300);
+
+    file.release(c);
+
+    // Merged with the rest of the hole of `b` and cut off as well.
+    CHECK(file.fileSize() == 160);
+    CHECK(file.holeBytes() == 0);
+  }
+
+  SECTION("releasing the last record empties the file")
+  {
+    file.release(a);
+    file.release(c);
+    file.release(d);
+    file.release(e);
+
+    CHECK(file.recordCount() == 0);
+    CHECK(file.fileSize() == 0);
+    CHECK(file.holeBytes() == 0);
+  }
+}
+
+TEST_CASE("UndoSpillFile stays bounded over restore and spill cycles", "[undo]")
+{
+  UndoSpillFile file;
+
+  std::vector<UndoSpillFile::Record> records;
+
+  for (int i = 0; i < 10; ++i)
+    records.push_back(file.write(recordData(100 + i, char('a' + i))));
+
+  qint64 const initialSize = file.fileSize();
+
+  // An undo reads a command back, the budget spills it again later.
+  for (int cycle = 0; cycle < 100; ++cycle)
+  {
+    std::size_t const i = static_cast<std::size_t>(cycle % 10);
+
+    QByteArray const data = file.read(records[i]);
+    CHECK(data == recordData(100 + static_cast<int>(i), char('a' + i)));
+
+    file.release(records[i]);
+    records[i] = file.write(data);
+
+    REQUIRE(records[i].isValid());
+  }
+
+  CHECK(file.fileSize() <= initialSize + 109);
+  CHECK(file.recordBytes() + file.holeBytes() == file.fileSize());
+}